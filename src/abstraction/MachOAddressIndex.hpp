@@ -0,0 +1,151 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+*/
+#ifndef __MACH_O_ADDRESS_INDEX__
+#define __MACH_O_ADDRESS_INDEX__
+
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+
+
+namespace mach_o {
+namespace address_index {
+
+struct Entry
+{
+	uint64_t		address;
+	const char*		name;
+	uint32_t		order;			// position in which the symbol was added
+	uint8_t			sectIndex;
+	bool			thumbDef;
+
+	bool			operator<(const Entry& other) const {
+						if ( address != other.address )
+							return (address < other.address);
+						return (order < other.order);
+					}
+};
+
+//
+// Maps addresses in an image back to the symbols at or before them.  The symbol table
+// is copied once into an array sorted by address, so each lookup is a binary search
+// instead of a scan of every nlist.  When several symbols have the same address, the
+// one added first is returned, which is what a scan in symbol table order would find.
+//
+template <typename P>
+class AddressIndex
+{
+public:
+	typedef std::pair<const Entry*, const Entry*>	Range;
+
+						AddressIndex() : fSorted(true) { }
+
+	// adds the non-stab N_SECT symbols in [start, end), call finalize() when done adding
+	void				addSymbols(const macho_nlist<P>* start, const macho_nlist<P>* end, const char* strings);
+	void				finalize();
+	bool				empty() const			{ return fEntries.empty(); }
+	size_t				count() const			{ return fEntries.size(); }
+
+	// symbol with the highest address <= addr, if sectIndex is not zero only symbols in that section count
+	const Entry*		closest(uint64_t addr, uint8_t sectIndex=0) const;
+	// all symbols at exactly addr, first added first
+	Range				exact(uint64_t addr) const;
+
+private:
+	static bool			lessThanAddress(const Entry& entry, uint64_t addr)	{ return (entry.address < addr); }
+	static bool			addressLessThan(uint64_t addr, const Entry& entry)	{ return (addr < entry.address); }
+
+	std::vector<Entry>	fEntries;
+	bool				fSorted;
+};
+
+
+template <typename P>
+void AddressIndex<P>::addSymbols(const macho_nlist<P>* start, const macho_nlist<P>* end, const char* strings)
+{
+	fEntries.reserve(fEntries.size() + (end - start));
+	for (const macho_nlist<P>* s = start; s < end; ++s) {
+		const uint8_t type = s->n_type();
+		if ( ((type & N_STAB) != 0) || ((type & N_TYPE) != N_SECT) )
+			continue;
+		Entry entry;
+		entry.address	= s->n_value();
+		entry.name		= &strings[s->n_strx()];
+		entry.order		= (uint32_t)fEntries.size();
+		entry.sectIndex	= s->n_sect();
+		entry.thumbDef	= ((s->n_desc() & N_ARM_THUMB_DEF) != 0);
+		fEntries.push_back(entry);
+	}
+	fSorted = false;
+}
+
+template <typename P>
+void AddressIndex<P>::finalize()
+{
+	if ( !fSorted )
+		std::sort(fEntries.begin(), fEntries.end());
+	fSorted = true;
+}
+
+template <typename P>
+const Entry* AddressIndex<P>::closest(uint64_t addr, uint8_t sectIndex) const
+{
+	assert(fSorted && "finalize() not called");
+	const Entry* const begin = fEntries.data();
+	const Entry* it = std::upper_bound(begin, begin + fEntries.size(), addr, &addressLessThan);
+	// sections don't overlap, so stepping back over other sections' symbols is rare
+	while ( (it != begin) && (sectIndex != 0) && (it[-1].sectIndex != sectIndex) )
+		--it;
+	if ( it == begin )
+		return NULL;
+	// back up to the first one added at that address
+	const Entry* best = &it[-1];
+	for (const Entry* e = best; (e != begin) && (e[-1].address == best->address); --e) {
+		if ( (sectIndex == 0) || (e[-1].sectIndex == sectIndex) )
+			best = &e[-1];
+	}
+	return best;
+}
+
+template <typename P>
+typename AddressIndex<P>::Range AddressIndex<P>::exact(uint64_t addr) const
+{
+	assert(fSorted && "finalize() not called");
+	const Entry* const begin = fEntries.data();
+	const Entry* const end = begin + fEntries.size();
+	const Entry* first = std::lower_bound(begin, end, addr, &lessThanAddress);
+	const Entry* last = std::upper_bound(first, end, addr, &addressLessThan);
+	return Range(first, last);
+}
+
+
+} // namespace address_index
+} // namespace mach_o
+
+
+#endif // __MACH_O_ADDRESS_INDEX__
@@ -0,0 +1,150 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+
+#ifndef __CACHE_DIRECTORY_HPP__
+#define __CACHE_DIRECTORY_HPP__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+
+namespace ld {
+namespace cache_directory {
+
+//
+// The on disk caches (-object_parse_cache, -tbd_cache_path) keep one flat file per entry
+// in a directory.  Entries are written whole and renamed into place, so concurrent links
+// only ever see complete entries, and a cache that cannot be read or written is just a
+// miss.
+//
+
+// A piece of an entry's content, entries are written from several buffers in order
+struct Piece {
+	const void*		data;
+	size_t			size;
+};
+
+// Maps <dir>/<name> read-only.  Returns NULL if there is no such entry.  The entry's
+// modification time is set to now, which is what prune() ages entries by, because
+// many volumes do not update access times.
+inline void* mapEntry(const char* dir, const char* name, size_t& size)
+{
+	char path[PATH_MAX];
+	snprintf(path, PATH_MAX, "%s/%s", dir, name);
+	int fd = ::open(path, O_RDONLY, 0);
+	if ( fd == -1 )
+		return NULL;
+	void* result = NULL;
+	struct stat statBuffer;
+	if ( (::fstat(fd, &statBuffer) == 0) && (statBuffer.st_size > 0) ) {
+		void* p = ::mmap(NULL, statBuffer.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+		if ( p != (void*)(-1) ) {
+			result = p;
+			size = statBuffer.st_size;
+			::futimes(fd, NULL);
+		}
+	}
+	::close(fd);
+	return result;
+}
+
+// Writes the pieces to <dir>/<name>, creating dir if needed.  Returns false if nothing was stored.
+inline bool storeEntry(const char* dir, const char* name, const std::vector<Piece>& pieces)
+{
+	// write to a temp file and rename, so concurrent links never see a partial entry
+	char tempPath[PATH_MAX];
+	snprintf(tempPath, PATH_MAX, "%s/%s.XXXXXX", dir, name);
+	int fd = ::mkstemp(tempPath);
+	if ( (fd == -1) && (errno == ENOENT) ) {
+		::mkdir(dir, 0755);
+		snprintf(tempPath, PATH_MAX, "%s/%s.XXXXXX", dir, name);
+		fd = ::mkstemp(tempPath);
+	}
+	if ( fd == -1 )
+		return false;	// caching is best effort
+	bool ok = true;
+	for (const Piece& piece : pieces) {
+		if ( (piece.size != 0) && (::write(fd, piece.data, piece.size) != (ssize_t)piece.size) ) {
+			ok = false;
+			break;
+		}
+	}
+	::close(fd);
+	char path[PATH_MAX];
+	snprintf(path, PATH_MAX, "%s/%s", dir, name);
+	if ( !ok || (::rename(tempPath, path) != 0) ) {
+		::unlink(tempPath);
+		return false;
+	}
+	return true;
+}
+
+// Removes the least recently used entries (oldest modification time) until the directory holds at most maxSize bytes
+inline void prune(const char* dirPath, uint64_t maxSize)
+{
+	struct CacheFile { std::string path; uint64_t size; time_t lastUse; };
+	std::vector<CacheFile> files;
+	uint64_t totalSize = 0;
+	DIR* dir = ::opendir(dirPath);
+	if ( dir == NULL )
+		return;
+	while ( struct dirent* entry = ::readdir(dir) ) {
+		if ( entry->d_name[0] == '.' )
+			continue;
+		std::string path = std::string(dirPath) + "/" + entry->d_name;
+		struct stat statBuffer;
+		if ( (::stat(path.c_str(), &statBuffer) != 0) || !S_ISREG(statBuffer.st_mode) )
+			continue;
+		files.push_back({ path, (uint64_t)statBuffer.st_size, statBuffer.st_mtime });
+		totalSize += statBuffer.st_size;
+	}
+	::closedir(dir);
+	if ( totalSize <= maxSize )
+		return;
+	std::sort(files.begin(), files.end(), [](const CacheFile& l, const CacheFile& r) { return l.lastUse < r.lastUse; });
+	for (const CacheFile& file : files) {
+		if ( totalSize <= maxSize )
+			break;
+		if ( ::unlink(file.path.c_str()) == 0 )
+			totalSize -= file.size;
+	}
+}
+
+} // namespace cache_directory
+} // namespace ld
+
+#endif // __CACHE_DIRECTORY_HPP__
@@ -0,0 +1,108 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __CHAINED_FIXUPS_HPP__
+#define __CHAINED_FIXUPS_HPP__
+
+#include <stdint.h>
+#include <assert.h>
+#include <dispatch/dispatch.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+
+
+namespace ld {
+namespace chained_fixups {
+
+//
+// Once every fixup location is known, each page's chain only depends on the fixups on
+// that page, so pages are sorted and linked in parallel.  The helpers work on any page
+// type with a fixupOffsets vector, so ld-bench can time them without an OutputFile.
+//
+
+// Sorts the fixup offsets of every page.  Locations are bucketed by page as they are
+// found, so this sorts each segment's locations without merging anything.
+template <typename PageInfo>
+void sortPages(const std::vector<PageInfo*>& pages)
+{
+	PageInfo* const* pageArray = pages.data();
+	dispatch_apply(pages.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+		std::sort(pageArray[i]->fixupOffsets.begin(), pageArray[i]->fixupOffsets.end());
+	});
+}
+
+// Sets the "next" field of each fixup on a page so it reaches the following one.  offsets
+// must be sorted.  DYLD_CHAINED_PTR_32 is not handled here, its chains may need to co-opt
+// non-pointers or add extra starts.
+inline void chainPage(uint8_t* pageBuffer, const std::vector<uint16_t>& offsets, uint16_t pointerFormat)
+{
+	uint8_t* prevLoc = nullptr;
+	for (uint16_t pageOffset : offsets) {
+		uint8_t* loc = pageBuffer + pageOffset;
+		if ( prevLoc != nullptr ) {
+			uint64_t delta = loc - prevLoc;
+			switch ( pointerFormat ) {
+				case DYLD_CHAINED_PTR_ARM64E:
+				case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+				case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
+					((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/8;
+					assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 8) == delta && "next out of range");
+					break;
+				case DYLD_CHAINED_PTR_ARM64E_KERNEL:
+				case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
+					((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/4;
+					assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 4) == delta && "next out of range");
+					break;
+				case DYLD_CHAINED_PTR_64:
+				case DYLD_CHAINED_PTR_64_OFFSET:
+					((dyld_chained_ptr_64_rebase*)prevLoc)->next = delta/4;
+					assert((((dyld_chained_ptr_64_rebase*)prevLoc)->next * 4) == delta && "next out of range");
+					break;
+				default:
+					assert(0 && "unknown pointer format");
+			}
+		}
+		prevLoc = loc;
+	}
+}
+
+// Fills in the page_start table of a dyld_chained_starts_in_segment, one entry per page
+template <typename PageInfo>
+void pageStarts(const std::vector<PageInfo>& pages, uint16_t starts[])
+{
+	const PageInfo* pageArray = pages.data();
+	dispatch_apply(pages.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+		const std::vector<uint16_t>& offsets = pageArray[i].fixupOffsets;
+		starts[i] = offsets.empty() ? DYLD_CHAINED_PTR_START_NONE : offsets.front();
+	});
+}
+
+
+} // namespace chained_fixups
+} // namespace ld
+
+#endif // __CHAINED_FIXUPS_HPP__
@@ -42,6 +42,8 @@
 #include <mach-o/fat.h>
 #include <sys/sysctl.h>
 #include <libkern/OSAtomic.h>
+#include <dispatch/dispatch.h>
+#include <sched.h>
 
 #include <string>
 #include <map>
@@ -223,7 +225,7 @@ const char* InputFiles::extractFileInfo(const uint8_t* p, unsigned len, const ch
 }
 
 
-ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib)
+ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib, bool logPath)
 {
 	bool fromSDK = _options.fromSDK(info.path);
 	// handle inlined framework first.
@@ -234,6 +236,9 @@ ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib
 		auto file = textstub::dylib::parse(info.path, interface, info.modTime, info.ordinal, _options, indirectDylib, fromSDK);
 		if (!file)
 			throwf("could not parse inlined dylib file: %s(%s)", interface->getInstallName().c_str(), info.path);
+		// write out path for -t option
+		if ( logPath && _options.logAllFiles() )
+			printf("%s\n", info.path);
 		return file;
 	}
 	// map in whole file
@@ -356,6 +361,9 @@ ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib
 	objOpts.internalSDK 		= _options.internalSDK();
 	objOpts.forceHidden			= false;
 	objOpts.platformMismatchesAreWarning = _options.platformMismatchesAreWarning();
+	objOpts.parseCacheDir		= _options.objectParseCachePath();
+	objOpts.parseCacheMaxSize	= _options.objectParseCacheMaxSize();
+	objOpts.literalPool			= &_literalPool;
 
 	ld::relocatable::File* objResult = mach_o::relocatable::parse(p, len, info.path, info.modTime, info.ordinal, objOpts);
 	if ( objResult != NULL ) {
@@ -379,12 +387,13 @@ ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib
 		case Options::kDynamicExecutable:
 		case Options::kDynamicLibrary:
 		case Options::kDynamicBundle:	
+			// the dylib parsers leave -t logging to us, so preloadIndirectDylibs() can defer it
 			dylibResult = mach_o::dylib::parse(p, len, info.path, info.modTime, _options, info.ordinal, info.options.fBundleLoader, indirectDylib, fromSDK);
+			if ( dylibResult == NULL )
+				dylibResult = textstub::dylib::parse(p, len, info.path, info.modTime, _options, info.ordinal, info.options.fBundleLoader, indirectDylib, fromSDK);
 			if ( dylibResult != NULL ) {
-				return dylibResult;
-			}
-			dylibResult = textstub::dylib::parse(p, len, info.path, info.modTime, _options, info.ordinal, info.options.fBundleLoader, indirectDylib, fromSDK);
-			if ( dylibResult != NULL ) {
+				if ( logPath && _options.logAllFiles() )
+					printf("%s\n", info.path);
 				return dylibResult;
 			}
 			break;
@@ -593,6 +602,29 @@ ld::dylib::File* InputFiles::findDylib(const char* installPath, const ld::dylib:
 
 		// search for dylib using -F and -L paths and expanding @ paths
 		Options::FileInfo info = _options.findIndirectDylib(installPath, fromDylib);
+
+		// use dylib already loaded by preloadIndirectDylibs() if this is the lookup it predicted
+		InstallNameToPreloadedDylib::iterator ppos = _preloadedDylibs.find(installPath);
+		if ( ppos != _preloadedDylibs.end() ) {
+			PreloadedDylib preload = ppos->second;
+			_preloadedDylibs.erase(ppos);
+			// TBDs processed since the prediction may provide this install name inline, so the search must still agree
+			if ( (preload.fromDylib == fromDylib) && (preload.info.ordinal == _indirectDylibOrdinal.nextIndirectDylibOrdinal())
+				&& !info.isInlined && (strcmp(preload.info.path, info.path) == 0) ) {
+				_indirectDylibOrdinal = preload.info.ordinal;
+				// preloading parsed quietly, log the path where serial loading would have
+				if ( _options.logAllFiles() )
+					printf("%s\n", preload.info.path);
+				if ( preload.errorMessage != NULL )
+					throwf("in '%s', %s", preload.info.path, preload.errorMessage);
+				addDylib(preload.dylib, preload.info);
+				this->logDylib(preload.dylib, true, speculative);
+				return preload.dylib;
+			}
+			// mispredicted, nothing else will look for this install name at this level
+			delete preload.dylib;
+		}
+
 		_indirectDylibOrdinal = _indirectDylibOrdinal.nextIndirectDylibOrdinal();
 		info.ordinal = _indirectDylibOrdinal;
 		info.options.fIndirectDylib = true;
@@ -786,11 +818,14 @@ void InputFiles::createIndirectDylibs()
 		std::sort(unprocessedDylibs.begin(), unprocessedDylibs.end(), [](const ld::dylib::File* lhs, const ld::dylib::File* rhs) {
 			return strcmp(lhs->path(), rhs->path()) < 0;
 		});
+		// parse this level of indirect dylibs concurrently, then connect them up in order
+		preloadIndirectDylibs(unprocessedDylibs);
 		for (std::vector<ld::dylib::File*>::iterator it=unprocessedDylibs.begin(); it != unprocessedDylibs.end(); it++) {
 			dylibsProcessed.insert(*it);
 			(*it)->processIndirectLibraries(this, _options.implicitlyLinkIndirectPublicDylibs());
 		}
 	}
+	discardPreloadedDylibs();
 
 	// go back over original dylibs and mark sub frameworks as re-exported
 	if ( _options.outputKind() == Options::kDynamicLibrary ) {
@@ -813,6 +848,92 @@ void InputFiles::createIndirectDylibs()
 	
 }
 
+// Loads the dylibs that processIndirectLibraries() on these dylibs will look for.  Searching
+// and ordinal assignment are done serially in the order findDylib() will be called, so ordinals
+// match serial loading.  Only mapping and parsing the found files is done in parallel.
+void InputFiles::preloadIndirectDylibs(const std::vector<ld::dylib::File*>& dylibs)
+{
+	// -dylib_file may use two ordinals for one lookup, so ordinals can't be predicted
+	if ( !_options.dylibOverrides().empty() )
+		return;
+
+	// anything left from the previous level was mispredicted and will never match
+	discardPreloadedDylibs();
+
+	typedef std::pair<const char*, const ld::dylib::File*> Lookup;
+	std::vector<Lookup> lookups;
+	std::vector<Lookup>* lookupsPtr = &lookups;
+	std::set<std::string> inlinedNames;
+	std::set<std::string>* inlinedNamesPtr = &inlinedNames;
+	for (ld::dylib::File* dylib : dylibs) {
+		dylib->forEachIndirectDylibToFind(^(const char* installPath) {
+			lookupsPtr->push_back(Lookup(installPath, dylib));
+		});
+		dylib->forEachInlinedDylib(^(const char* installPath) {
+			inlinedNamesPtr->insert(installPath);
+		});
+	}
+
+	std::vector<PreloadedDylib*> toLoad;
+	std::set<std::string> loadedSerially;
+	ld::File::Ordinal ordinal = _indirectDylibOrdinal;
+	for (const Lookup& lookup : lookups) {
+		if ( (_installPathToDylibs.count(lookup.first) != 0) || (_preloadedDylibs.count(lookup.first) != 0)
+			|| (loadedSerially.count(lookup.first) != 0) )
+			continue;
+		// this level's TBDs register their inlined dylibs as they are processed, and the search
+		// prefers those to files, so leave these to findDylib() but still count their ordinals
+		if ( (inlinedNames.count(lookup.first) != 0) || _options.hasInlinedTAPIFile(lookup.first) ) {
+			loadedSerially.insert(lookup.first);
+			ordinal = ordinal.nextIndirectDylibOrdinal();
+			continue;
+		}
+		Options::FileInfo info;
+		try {
+			info = _options.findIndirectDylib(lookup.first, lookup.second);
+		}
+		catch (const char* msg) {
+			// findDylib() will throw before taking an ordinal, so later predictions are unaffected
+			continue;
+		}
+		ordinal = ordinal.nextIndirectDylibOrdinal();
+		info.ordinal = ordinal;
+		info.options.fIndirectDylib = true;
+		PreloadedDylib& preload = _preloadedDylibs[lookup.first];
+		preload.fromDylib		= lookup.second;
+		preload.info			= info;
+		preload.dylib			= NULL;
+		preload.errorMessage	= NULL;
+		toLoad.push_back(&preload);
+	}
+	if ( toLoad.empty() )
+		return;
+
+	PreloadedDylib** preloads = &toLoad[0];
+	dispatch_apply(toLoad.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+		PreloadedDylib* preload = preloads[index];
+		try {
+			ld::File* reader = this->makeFile(preload->info, true, false);
+			preload->dylib = dynamic_cast<ld::dylib::File*>(reader);
+			if ( preload->dylib == NULL ) {
+				delete reader;
+				throwf("indirect dylib at %s is not a dylib", preload->info.path);
+			}
+		}
+		catch (const char* msg) {
+			preload->errorMessage = msg;
+		}
+	});
+}
+
+// Frees preloaded dylibs that no findDylib() call took
+void InputFiles::discardPreloadedDylibs()
+{
+	for (auto& entry : _preloadedDylibs)
+		delete entry.second.dylib;
+	_preloadedDylibs.clear();
+}
+
 void InputFiles::createOpaqueFileSections()
 {
 	// extra command line sections always at end
@@ -932,39 +1053,42 @@ void InputFiles::checkDylibClientRestrictions(ld::dylib::File* dylib)
 InputFiles::InputFiles(Options& opts) 
  : _totalObjectSize(0), _totalArchiveSize(0), 
    _totalObjectLoaded(0), _totalArchivesLoaded(0), _totalDylibsLoaded(0),
+   _totalArchiveMembersReleased(0), _totalArchiveBytesReleased(0),
 	_options(opts), _bundleLoader(NULL), 
+#if HAVE_PTHREADS
+	_parseQueue(opts.getInputFiles().size()),
+#endif
 	_exception(NULL), 
 	_indirectDylibOrdinal(ld::File::Ordinal::indirectDylibBase()),
 	_linkerOptionOrdinal(ld::File::Ordinal::linkeOptionBase())
 {
 //	fStartCreateReadersTime = mach_absolute_time();
-#if HAVE_PTHREADS
-	pthread_mutex_init(&_parseLock, NULL);
-	pthread_cond_init(&_parseWorkReady, NULL);
-	pthread_cond_init(&_newFileAvailable, NULL);
-	_neededFileSlot = -1;
-#endif
 	const std::vector<Options::FileInfo>& files = _options.getInputFiles();
 	if ( files.size() == 0 )
 		throw "no object files specified";
 
 	_inputFiles.reserve(files.size());
 #if HAVE_PTHREADS
+	_parsed.reset(new std::atomic<bool>[files.size()]);
+	_parseWorkReady = dispatch_semaphore_create(0);
+	_newFileAvailable = dispatch_semaphore_create(0);
+	_neededFileSlot = -1;
+	_prefetchPosition = 0;
+	_unclaimedInputFiles = (uint32_t)files.size();
 	unsigned int inputFileSlot = 0;
-	_availableInputFiles = 0;
-	_parseCursor = 0;
 #endif
 	Options::FileInfo* entry;
 	for (std::vector<Options::FileInfo>::const_iterator it = files.begin(); it != files.end(); ++it) {
 		entry = (Options::FileInfo*)&(*it);
 #if HAVE_PTHREADS
-		// Assign input file slots to all the FileInfos.
-		// Also chain all FileInfos into one big list to set up for worker threads to do parsing.
+		// Assign input file slots to all the FileInfos, and queue the ones that are
+		// already there in command line order for the worker threads to parse.
 		entry->inputFileSlot = inputFileSlot;
 		entry->readyToParse = !entry->fromFileList || !_options.pipelineEnabled();
-		if (entry->readyToParse)
-			_availableInputFiles++;
 		_inputFiles.push_back(NULL);
+		_parsed[inputFileSlot] = false;
+		if (entry->readyToParse)
+			queueForParsing(inputFileSlot);
 		inputFileSlot++;
 #else
 		// In the non-threaded case just parse the file now.
@@ -973,28 +1097,30 @@ InputFiles::InputFiles(Options& opts)
 	}
 	
 #if HAVE_PTHREADS
-	_remainingInputFiles = files.size();
-	
-	// initialize info for parsing input files on worker threads
-	unsigned int ncpus;
-	int mib[2];
-	size_t len = sizeof(ncpus);
-	mib[0] = CTL_HW;
-	mib[1] = HW_NCPU;
-	if (sysctl(mib, 2, &ncpus, &len, NULL, 0) != 0) {
-		ncpus = 1;
+	// start all the parse threads now, so none are still starting up when the resolver needs files
+	_workerCount = _options.threadCount();
+	if ( _workerCount == 0 ) {
+		unsigned int ncpus;
+		int mib[2];
+		size_t len = sizeof(ncpus);
+		mib[0] = CTL_HW;
+		mib[1] = HW_NCPU;
+		if (sysctl(mib, 2, &ncpus, &len, NULL, 0) != 0) {
+			ncpus = 1;
+		}
+		_workerCount = ncpus;
 	}
-	_availableWorkers = MIN(ncpus, files.size()); // max # workers we permit
-	_idleWorkers = 0;
+	_workerCount = (uint32_t)MIN(_workerCount, files.size());
+	_nextWorkerIndex = 0;
+	_parseWorkerCounters.reset(new ParseWorkerCounters[_workerCount]());
 	
 	if (_options.pipelineEnabled()) {
 		// start up a thread to listen for available input files
 		startThread(InputFiles::waitForInputFiles);
 	}
 
-	// Start up one parser thread. More start on demand as parsed input files get consumed.
-	startThread(InputFiles::parseWorkerThread);
-	_availableWorkers--;
+	for (uint32_t i=0; i < _workerCount; ++i)
+		startThread(InputFiles::parseWorkerThread);
 #else
 	if (_options.pipelineEnabled()) {
 		throwf("pipelined linking not supported on this platform");
@@ -1015,69 +1141,123 @@ void InputFiles::startThread(void (*threadFunc)(InputFiles *)) const {
 	pthread_attr_destroy(&attr);
 }
 
+// Starts the kernel reading a file that a parser thread will soon map, so the parser doesn't
+// block on I/O.  Archives are mostly skipped over, so only the start of a big file is read early.
+static void prefetchInputFile(const char* path)
+{
+	const off_t kMaxPrefetchSize = 16*1024*1024;
+	int fd = ::open(path, O_RDONLY, 0);
+	if ( fd == -1 )
+		return;
+	struct stat stat_buf;
+	if ( ::fstat(fd, &stat_buf) == 0 ) {
+		struct radvisory advice;
+		advice.ra_offset = 0;
+		advice.ra_count = (int)std::min(stat_buf.st_size, kMaxPrefetchSize);
+		::fcntl(fd, F_RDADVISE, &advice);
+	}
+	::close(fd);
+}
+
+// Hands an input file to the parse threads.  The queue holds every input file, so it never fills up.
+void InputFiles::queueForParsing(uint32_t slot)
+{
+	if ( !_parseQueue.push(slot) )
+		throw "internal error: parse queue full";
+	dispatch_semaphore_signal(_parseWorkReady);
+}
+
+// First error wins.  Wakes everyone blocked on parsing so they see it.
+void InputFiles::setParseException(const char* msg)
+{
+	const char* expected = NULL;
+	_exception.compare_exchange_strong(expected, msg);
+	for (uint32_t i=0; i < _workerCount; ++i)
+		dispatch_semaphore_signal(_parseWorkReady);
+	dispatch_semaphore_signal(_newFileAvailable);
+}
+
 // Work loop for input file parsing threads
 void InputFiles::parseWorkerThread() {
-	ld::File *file;
-	const char *exception = NULL;
-	pthread_mutex_lock(&_parseLock);
 	const std::vector<Options::FileInfo>& files = _options.getInputFiles();
+	ParseWorkerCounters& stats = _parseWorkerCounters[_nextWorkerIndex++];
 	if (_s_logPThreads) printf("worker starting\n");
-	do {
-		if (_availableInputFiles == 0) {
-			_idleWorkers++;
-			pthread_cond_wait(&_parseWorkReady, &_parseLock);
-			_idleWorkers--;
-		} else {
-			int slot = _parseCursor;
-			while (slot < (int)files.size() && (_inputFiles[slot] != NULL || !files[slot].readyToParse))
-				slot++;
-			assert(slot < (int)files.size());
-			Options::FileInfo& entry = (Options::FileInfo&)files[slot];
-			_parseCursor = slot+1;
-			_availableInputFiles--;
-			entry.readyToParse = false; // to avoid multiple threads finding this file
-			pthread_mutex_unlock(&_parseLock);
-			if (_s_logPThreads) printf("parsing index %u\n", slot);
-			try {
-				file = makeFile(entry, false);
+	for (;;) {
+		uint64_t idleStart = mach_absolute_time();
+		dispatch_semaphore_wait(_parseWorkReady, DISPATCH_TIME_FOREVER);
+		uint32_t slot;
+		uint64_t position;
+		bool haveWork = false;
+		while ( _exception.load() == NULL ) {
+			if ( _parseQueue.pop(slot, position) ) {
+				haveWork = true;
+				break;
 			}
-			catch (const char *msg) {
-				if ( ((strstr(msg, "architecture") != NULL)  || (strstr(msg, "attempting to link") != NULL)) && !_options.errorOnOtherArchFiles() ) {
-					if ( _options.ignoreOtherArchInputFiles() ) {
-						// ignore, because this is about an architecture not in use
-					}
-					else {
-						warning("ignoring file %s, %s", entry.path, msg);
-					}
-				} 
-				else if ( strstr(msg, "ignoring unexpected") != NULL ) {
-					warning("%s, %s", entry.path, msg);
+			// woken to exit, or a push we were signaled for has claimed its position but not filled it yet
+			if ( _unclaimedInputFiles.load() == 0 )
+				break;
+			sched_yield();
+		}
+		uint64_t parseStart = mach_absolute_time();
+		stats.idleTime += parseStart - idleStart;
+		if ( !haveWork )
+			break;
+		if ( _unclaimedInputFiles.fetch_sub(1) == 1 ) {
+			// that was the last file, so wake every worker to exit, this one included once it is done
+			for (uint32_t i=0; i < _workerCount; ++i)
+				dispatch_semaphore_signal(_parseWorkReady);
+		}
+		const Options::FileInfo& entry = files[slot];
+		// hint the next few queued files, up to -input_prefetch_limit past this one
+		const uint64_t prefetchEnd = position + 1 + _options.inputPrefetchLimit();
+		uint64_t prefetchStart = _prefetchPosition.load();
+		while ( prefetchStart < prefetchEnd ) {
+			if ( _prefetchPosition.compare_exchange_weak(prefetchStart, prefetchEnd) ) {
+				for (uint64_t p = std::max(prefetchStart, position+1); p < prefetchEnd; ++p) {
+					uint32_t prefetchSlot;
+					if ( _parseQueue.peek(p, prefetchSlot) )
+						prefetchInputFile(files[prefetchSlot].path);
+				}
+				break;
+			}
+		}
+		if (_s_logPThreads) printf("parsing index %u\n", slot);
+		ld::File* file;
+		const char* exception = NULL;
+		try {
+			file = makeFile(entry, false);
+		}
+		catch (const char *msg) {
+			if ( ((strstr(msg, "architecture") != NULL)  || (strstr(msg, "attempting to link") != NULL)) && !_options.errorOnOtherArchFiles() ) {
+				if ( _options.ignoreOtherArchInputFiles() ) {
+					// ignore, because this is about an architecture not in use
 				}
 				else {
-					asprintf((char**)&exception, "%s file '%s'", msg, entry.path);
+					warning("ignoring file %s, %s", entry.path, msg);
 				}
-				file = new IgnoredFile(entry.path, entry.modTime, entry.ordinal, ld::File::Other);
-			}
-			pthread_mutex_lock(&_parseLock);
-			if (_remainingInputFiles > 0)
-				_remainingInputFiles--;
-			if (_s_logPThreads) printf("done with index %u, %d remaining\n", slot, _remainingInputFiles);
-			if (exception) {
-				// We are about to die, so set to zero to stop other threads from doing unneeded work.
-				_remainingInputFiles = 0;
-				_exception = exception;
 			} 
+			else if ( strstr(msg, "ignoring unexpected") != NULL ) {
+				warning("%s, %s", entry.path, msg);
+			}
 			else {
-				_inputFiles[slot] = file;
-				if (_neededFileSlot == slot)
-					pthread_cond_signal(&_newFileAvailable);
+				asprintf((char**)&exception, "%s file '%s'", msg, entry.path);
 			}
+			file = new IgnoredFile(entry.path, entry.modTime, entry.ordinal, ld::File::Other);
 		}
-	} while (_remainingInputFiles);
+		stats.parseTime += mach_absolute_time() - parseStart;
+		stats.filesParsed++;
+		if (_s_logPThreads) printf("done with index %u\n", slot);
+		if (exception) {
+			// We are about to die, so stop other threads from doing unneeded work.
+			setParseException(exception);
+			break;
+		} 
+		_inputFiles[slot] = file;
+		_parsed[slot].store(true);
+		if (_neededFileSlot.load() == (int)slot)
+			dispatch_semaphore_signal(_newFileAvailable);
+	}
 	if (_s_logPThreads) printf("worker exiting\n");
-	pthread_cond_broadcast(&_parseWorkReady);
-	pthread_cond_signal(&_newFileAvailable);
-	pthread_mutex_unlock(&_parseLock);
 }
 
 
@@ -1086,6 +1266,18 @@ void InputFiles::parseWorkerThread(InputFiles *inputFiles) {
 }
 #endif
 
+std::vector<InputFiles::ParseWorkerStatistics> InputFiles::parseWorkerStatistics() const
+{
+	std::vector<ParseWorkerStatistics> result;
+#if HAVE_PTHREADS
+	for (uint32_t i=0; i < _workerCount; ++i) {
+		const ParseWorkerCounters& counters = _parseWorkerCounters[i];
+		result.push_back({ counters.filesParsed.load(), counters.parseTime.load(), counters.idleTime.load() });
+	}
+#endif
+	return result;
+}
+
 
 ld::File* InputFiles::addDylib(ld::dylib::File* reader, const Options::FileInfo& info)
 {
@@ -1186,22 +1378,12 @@ void InputFiles::waitForInputFiles()
 			Options::FileInfo* inputInfo = (Options::FileInfo*)it->second;
 			if (!inputInfo->checkFileExists(_options))
 				throwf("pipelined linking error - file does not exist: %s\n", inputInfo->path);
-			pthread_mutex_lock(&_parseLock);
-			if (_idleWorkers)
-				pthread_cond_signal(&_parseWorkReady);
-			inputInfo->readyToParse = true;
-			if (_parseCursor > inputInfo->inputFileSlot)
-				_parseCursor = inputInfo->inputFileSlot;
-			_availableInputFiles++;
-			if (_s_logPThreads) printf("pipeline listener: %s slot=%d, _parseCursor=%d, _availableInputFiles = %d remaining = %ld\n", path_buf, inputInfo->inputFileSlot, _parseCursor, _availableInputFiles, fileMap.size()-1);
-			pthread_mutex_unlock(&_parseLock);
+			if (_s_logPThreads) printf("pipeline listener: %s slot=%d, remaining = %ld\n", path_buf, inputInfo->inputFileSlot, fileMap.size()-1);
+			queueForParsing(inputInfo->inputFileSlot);
 			fileMap.erase(it);
 		}
 	} catch (const char *msg) {
-		pthread_mutex_lock(&_parseLock);
-		_exception = msg;
-		pthread_cond_signal(&_newFileAvailable);
-		pthread_mutex_unlock(&_parseLock);
+		setParseException(msg);
 	}
 }
 
@@ -1220,32 +1402,25 @@ void InputFiles::forEachInitialAtom(ld::File::AtomHandler& handler, ld::Internal
 	for (fileIndex=0; fileIndex<_inputFiles.size(); fileIndex++) {
 		ld::File *file;
 #if HAVE_PTHREADS
-		pthread_mutex_lock(&_parseLock);
-		
 		// this loop waits for the needed file to be ready (parsed by worker thread)
-		while (_inputFiles[fileIndex] == NULL && _exception == NULL) {
-			// We are starved for input. If there are still files to parse and we have
-			// not maxed out the worker thread count start a new worker thread.
-			if (_availableInputFiles > 0 && _availableWorkers > 0) {
-				if (_s_logPThreads) printf("starting worker\n");
-				startThread(InputFiles::parseWorkerThread);
-				_availableWorkers--;
-			}
-			_neededFileSlot = fileIndex;
+		while ( !_parsed[fileIndex].load() && (_exception.load() == NULL) ) {
+			_neededFileSlot.store((int)fileIndex);
+			// a worker that finished this file before seeing _neededFileSlot did not signal
+			if ( _parsed[fileIndex].load() || (_exception.load() != NULL) )
+				break;
 			if (_s_logPThreads) printf("consumer blocking for %lu: %s\n", fileIndex, files[fileIndex].path);
-			pthread_cond_wait(&_newFileAvailable, &_parseLock);
+			dispatch_semaphore_wait(_newFileAvailable, DISPATCH_TIME_FOREVER);
 		}
 
-		if (_exception) {
+		if (_exception.load() != NULL) {
 			// <rdar://problem/16525216> the tool is erroring out.  wait for other threads to finish so we don't destruct global objects out from under them
 			sleep(1);
-			throw _exception;
+			throw _exception.load();
 		}
 
 		// The input file is parsed. Assimilate it and call its atom iterator.
 		if (_s_logPThreads) printf("consuming slot %lu\n", fileIndex);
 		file = _inputFiles[fileIndex];
-		pthread_mutex_unlock(&_parseLock);
 #else
 		file = _inputFiles[fileIndex];
 #endif
@@ -1290,13 +1465,15 @@ void InputFiles::forEachInitialAtom(ld::File::AtomHandler& handler, ld::Internal
 			file->forEachAtom(handler);
 		}
 		catch (const char* msg) {
-			asprintf((char**)&_exception, "%s file '%s'", msg, file->path());
+			char* exception;
+			asprintf(&exception, "%s file '%s'", msg, file->path());
+			_exception = exception;
 		}
 	}
-	if (_exception) {
+	if (_exception.load() != NULL) {
 		// <rdar://problem/16525216> the tool is erroring out.  wait for other threads to finish so we don't destruct global objects out from under them
 		sleep(1);
-		throw _exception;
+		throw _exception.load();
 	}
 
 	markExplicitlyLinkedDylibs();
@@ -1540,6 +1717,26 @@ void InputFiles::dylibs(ld::Internal& state)
 	}
 }
 
+void InputFiles::parsedArchiveMembers(std::unordered_set<const ld::File*>& members) const
+{
+	for (const LibraryInfo& lib : _searchLibraries) {
+		if ( !lib.isDylib() ) {
+			lib.archive()->forEachParsedMember(^(const ld::File* member) {
+				members.insert(member);
+			});
+		}
+	}
+}
+
+void InputFiles::releaseUnusedArchiveMembers(const std::unordered_set<const ld::File*>& liveFiles)
+{
+	for (const LibraryInfo& lib : _searchLibraries) {
+		if ( !lib.isDylib() )
+			lib.archive()->releaseUnusedMembers(liveFiles, _totalArchiveMembersReleased, _totalArchiveBytesReleased);
+	}
+}
+
+
 void InputFiles::archives(ld::Internal& state)
 {
 	for (const std::string& path :  _archiveFilePaths) {
@@ -44,12 +44,17 @@
 #include <mach-o/dyld.h>
 #if HAVE_PTHREADS
 #include <pthread.h>
+#include <dispatch/dispatch.h>
 #endif
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include "Options.h"
 #include "ld.hpp"
+#include "LiteralPool.hpp"
+#include "WorkQueue.hpp"
 
 namespace ld {
 namespace tool {
@@ -76,6 +81,13 @@ public:
 
 	void						addLinkerOptionLibraries(ld::Internal& state, ld::File::AtomHandler& handler);
 	void						createIndirectDylibs();
+	// adds every archive member that releaseUnusedArchiveMembers() could free
+	void						parsedArchiveMembers(std::unordered_set<const ld::File*>& members) const;
+	// frees archive members none of whose atoms are in liveFiles
+	void						releaseUnusedArchiveMembers(const std::unordered_set<const ld::File*>& liveFiles);
+
+	// cstrings interned by the parser threads, for the SymbolTable to coalesce
+	ld::LiteralPool&			literalPool()				{ return _literalPool; }
 
 	// for -print_statistics
 	volatile int64_t			_totalObjectSize;
@@ -83,12 +95,22 @@ public:
 	volatile int32_t			_totalObjectLoaded;
 	volatile int32_t			_totalArchivesLoaded;
 	volatile int32_t			_totalDylibsLoaded;
-	
+	uint32_t					_totalArchiveMembersReleased;
+	uint64_t					_totalArchiveBytesReleased;
+
+	// for -print_statistics, times are in mach_absolute_time() units
+	struct ParseWorkerStatistics {
+		uint32_t				filesParsed;
+		uint64_t				parseTime;
+		uint64_t				idleTime;
+	};
+	// a snapshot, workers that have not exited yet may still be counting idle time
+	std::vector<ParseWorkerStatistics>	parseWorkerStatistics() const;
 	
 private:
 	void						inferArchitecture(Options& opts, const char** archName);
 	const char* 				extractFileInfo(const uint8_t* p, unsigned len, const char* path, ld::Platform& platform);
-	ld::File*					makeFile(const Options::FileInfo& info, bool indirectDylib);
+	ld::File*					makeFile(const Options::FileInfo& info, bool indirectDylib, bool logPath=true);
 	ld::File*					addDylib(ld::dylib::File* f,        const Options::FileInfo& info);
 	void						logTraceInfo (const char* format, ...) const;
 	void						logDylib(ld::File*, bool indirect, bool speculative);
@@ -98,6 +120,8 @@ private:
 	void						createOpaqueFileSections();
 	bool						libraryAlreadyLoaded(const char* path);
 	bool						frameworkAlreadyLoaded(const char* path, const char* frameworkName);
+	void						preloadIndirectDylibs(const std::vector<ld::dylib::File*>& dylibs);
+	void						discardPreloadedDylibs();
 
 	// for pipelined linking
     void						waitForInputFiles();
@@ -107,34 +131,56 @@ private:
 	void						parseWorkerThread();
 	static void					parseWorkerThread(InputFiles *inputFiles);
 	void						startThread(void (*threadFunc)(InputFiles *)) const;
+	void						queueForParsing(uint32_t slot);
+	void						setParseException(const char* msg);
 
 	typedef std::map<std::string, ld::dylib::File*>	InstallNameToDylib;
 
+	// indirect dylib parsed ahead of the findDylib() call predicted to need it
+	struct PreloadedDylib {
+		const ld::dylib::File*	fromDylib;
+		Options::FileInfo		info;
+		ld::dylib::File*		dylib;
+		const char*				errorMessage;
+	};
+	typedef std::map<std::string, PreloadedDylib>	InstallNameToPreloadedDylib;
+
 	const Options&				_options;
 	std::vector<ld::File*>		_inputFiles;
 	mutable std::set<class ld::File*>	_archiveFilesLogged;
 	mutable std::vector<std::string>	_archiveFilePaths;
 	InstallNameToDylib			_installPathToDylibs;
+	InstallNameToPreloadedDylib	_preloadedDylibs;
 	std::set<ld::dylib::File*>	_allDylibs;
 	ld::dylib::File*			_bundleLoader;
+	ld::LiteralPool				_literalPool;
     struct strcompclass {
         bool operator() (const char *a, const char *b) const { return ::strcmp(a, b) < 0; }
     };
 
 	// for threaded input file processing
 #if HAVE_PTHREADS
-	pthread_mutex_t				_parseLock;
-	pthread_cond_t				_parseWorkReady;		// used by parse threads to block for work
-	pthread_cond_t				_newFileAvailable;		// used by main thread to block for parsed input files
-	int							_availableWorkers;		// number of remaining unstarted parse threads
-	int							_idleWorkers;			// number of running parse threads that are idle
-	int							_neededFileSlot;		// input file the resolver is currently blocked waiting for
-	int							_parseCursor;			// slot to begin searching for a file to parse
-	int							_availableInputFiles;	// number of input fileinfos with readyToParse==true
+	ld::WorkQueue<uint32_t>		_parseQueue;			// slots of input files ready to parse, in the order they became ready
+	std::unique_ptr<std::atomic<bool>[]>	_parsed;	// per slot, set once _inputFiles[slot] is filled in
+	dispatch_semaphore_t		_parseWorkReady;		// signaled once per queued file, and to wake workers to exit
+	dispatch_semaphore_t		_newFileAvailable;		// used by main thread to block for parsed input files
+	uint32_t					_workerCount;			// number of parse threads, all started up front
+	std::atomic<uint32_t>		_nextWorkerIndex;		// hands each parse thread its slot in _parseWorkerCounters
+	std::atomic<int>			_neededFileSlot;		// input file the resolver is currently blocked waiting for
+	std::atomic<uint64_t>		_prefetchPosition;		// next queue position to give a read-ahead hint for
+	std::atomic<uint32_t>		_unclaimedInputFiles;	// number of input files no parse thread has taken yet
 #endif
-	const char *				_exception;				// passes an exception message from parse thread to main thread
-	int							_remainingInputFiles;	// number of input files still to parse
-	
+	std::atomic<const char*>	_exception;				// passes an exception message from parse thread to main thread
+#if HAVE_PTHREADS
+	// each parse thread updates its own slot, atomically since -print_statistics reads them while workers may still run
+	struct ParseWorkerCounters {
+		std::atomic<uint32_t>	filesParsed;
+		std::atomic<uint64_t>	parseTime;
+		std::atomic<uint64_t>	idleTime;
+	};
+	std::unique_ptr<ParseWorkerCounters[]>	_parseWorkerCounters;
+#endif
+
 	ld::File::Ordinal			_indirectDylibOrdinal;
 	ld::File::Ordinal			_linkerOptionOrdinal;
     
@@ -40,6 +40,7 @@
 #include "ld.hpp"
 #include "Architectures.hpp"
 #include "MachOFileAbstraction.hpp"
+#include "ChainedFixups.hpp"
 #include "libcodedirectory.h"
 
 #ifndef CS_LINKER_SIGNED
@@ -229,7 +230,7 @@ void RebaseInfoAtom<A>::encode() const
 	if (info.empty())
 		return;
 
-	std::sort(info.begin(), info.end());
+	this->_writer.sortRebaseInfo();
 	
 	// use encoding based on target minOS
 	if ( _options.useLinkedListBinding() && !this->_writer._hasUnalignedFixup ) {
@@ -471,7 +472,7 @@ void BindingInfoAtom<A>::encodeV1() const
 {
 	// sort by library, symbol, type, then address
 	std::vector<OutputFile::BindingInfo>& info = this->_writer._bindingInfo;
-	std::sort(info.begin(), info.end());
+	this->_writer.sortBindingInfo();
 
 	// convert to temp encoding that can be more easily optimized
 	std::vector<binding_tmp> mid;
@@ -664,7 +665,7 @@ void BindingInfoAtom<A>::encodeV2() const
 	std::vector<OutputFile::RebaseInfo>& rebaseInfo = this->_writer._rebaseInfo;
 	const static bool log = false;
 
-	std::sort(bindInfo.begin(), bindInfo.end());
+	this->_writer.sortBindingInfo();
 
 	// convert to temp encoding that can be more easily optimized
 	std::vector<binding_tmp> mid;
@@ -733,24 +734,7 @@ void BindingInfoAtom<A>::encodeV2() const
 	// Now that we have the bind ordinal table populate, set the page starts.
 
 	std::vector<int64_t>& threadedRebaseBindIndices = this->_writer._threadedRebaseBindIndices;
-	threadedRebaseBindIndices.reserve(bindInfo.size() + rebaseInfo.size());
-
-	for (int64_t i = 0, e = rebaseInfo.size(); i != e; ++i)
-		threadedRebaseBindIndices.push_back(-i);
-
-	for (int64_t i = 0, e = bindInfo.size(); i != e; ++i)
-		threadedRebaseBindIndices.push_back(i + 1);
-
-	// Now sort the entries by address.
-	std::sort(threadedRebaseBindIndices.begin(), threadedRebaseBindIndices.end(),
-			  [&rebaseInfo, &bindInfo](int64_t indexA, int64_t indexB) {
-				  if (indexA == indexB)
-					  return false;
-				  uint64_t addressA = indexA <= 0 ? rebaseInfo[-indexA]._address : bindInfo[indexA - 1]._address;
-				  uint64_t addressB = indexB <= 0 ? rebaseInfo[-indexB]._address : bindInfo[indexB - 1]._address;
-				  assert(addressA != addressB);
-				  return addressA < addressB;
-			  });
+	this->_writer.buildThreadedRebaseBindIndices();
 
 	curSegStart = 0;
 	curSegEnd = 0;
@@ -899,19 +883,6 @@ private:
 	typedef typename A::P::E					E;
 	typedef typename A::P::uint_t				pint_t;
 
-	struct WeakBindingSorter
-	{	
-		 bool operator()(const OutputFile::BindingInfo& left, const OutputFile::BindingInfo& right)
-		 {
-			// sort by symbol, type, address
-			if ( left._symbolName != right._symbolName )
-				return ( strcmp(left._symbolName, right._symbolName) < 0 );
-			if ( left._type != right._type )
-				return  (left._type < right._type);
-			return  (left._address < right._address);
-		 }
-	};
-	
 	struct binding_tmp
 	{
 		binding_tmp(uint8_t op, uint64_t p1, uint64_t p2=0, const char* s=NULL) 
@@ -939,7 +910,7 @@ void WeakBindingInfoAtom<A>::encode() const
 		this->_encoded = true;
 		return;
 	}
-	std::sort(info.begin(), info.end(), WeakBindingSorter());
+	this->_writer.sortWeakBindingInfo();
 	
 	// convert to temp encoding that can be more easily optimized
 	std::vector<binding_tmp> mid;
@@ -1289,11 +1260,9 @@ void ChainedInfoAtom<A>::encode() const
 			dyld_chained_starts_in_image* segHeader = (dyld_chained_starts_in_image*)(this->_encodedData.start()+segsHeaderOffset);
 			segHeader->seg_info_offset[segIndex] = this->_encodedData.size() - segsHeaderOffset;
 			this->_encodedData.append_mem(&aSeg, offsetof(dyld_chained_starts_in_segment, page_start) );
-			std::vector<uint16_t> 	segChainOverflows;
-			for (OutputFile::ChainedFixupPageInfo& pageInfo : segInfo.pages) {
-				uint16_t startOffset = pageInfo.fixupOffsets.empty() ? DYLD_CHAINED_PTR_START_NONE : pageInfo.fixupOffsets.front();
-				this->_encodedData.append_mem(&startOffset, sizeof(startOffset));
-			}
+			std::vector<uint16_t> 	pageStarts(segInfo.pages.size());
+			ld::chained_fixups::pageStarts(segInfo.pages, &pageStarts[0]);
+			this->_encodedData.append_mem(&pageStarts[0], pageStarts.size()*sizeof(uint16_t));
 			if ( segInfo.pointerFormat == DYLD_CHAINED_PTR_32 ) {
 				// zero out chain overflow area
 				long padBytes = (startBytesPerPage-2) * segInfo.pages.size();
@@ -0,0 +1,135 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __LITERAL_POOL_HPP__
+#define __LITERAL_POOL_HPP__
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <unordered_map>
+
+#include "ld.hpp"
+
+
+namespace ld {
+
+//
+// Interns __cstring literals from all input files.  Every distinct string gets a small
+// index, shared by all atoms with that content, so the SymbolTable can coalesce cstrings
+// with an array lookup instead of hashing and comparing each one on the resolver thread.
+// The pool is split into shards that each have their own lock, so parser threads can add
+// the strings of the files they are parsing at the same time.  Indexes depend on which
+// thread gets to the pool first, so they may only be used to tell whether two strings
+// are equal, never to order anything.
+//
+class LiteralPool
+{
+public:
+	static const uint32_t	kShardCount = 64;
+
+							LiteralPool() : _count(0) {
+								for (uint32_t i=0; i < kShardCount; ++i)
+									pthread_mutex_init(&_shards[i].lock, NULL);
+							}
+							~LiteralPool() {
+								for (uint32_t i=0; i < kShardCount; ++i)
+									pthread_mutex_destroy(&_shards[i].lock);
+							}
+
+	// size includes the terminating zero, hash must be from ld::hashCString()
+	uint32_t				intern(const char* string, size_t size, size_t hash);
+	uint32_t				internCString(const char* string) {
+								size_t length;
+								size_t hash = hashCString(string, length);
+								return intern(string, length+1, hash);
+							}
+	// one more than the highest index handed out so far
+	uint32_t				count() const		{ return _count.load(std::memory_order_relaxed); }
+	uint64_t				memoryUsage() const;
+
+private:
+	struct Key {
+		const char*		string;
+		size_t			size;
+		size_t			hash;
+	};
+	struct KeyFuncs {
+		size_t			operator()(const Key& key) const { return key.hash; }
+		bool			operator()(const Key& left, const Key& right) const {
+							return (left.size == right.size) && (memcmp(left.string, right.string, left.size) == 0);
+						}
+	};
+	typedef std::unordered_map<Key, uint32_t, KeyFuncs, KeyFuncs> KeyToIndex;
+
+	struct Shard {
+		pthread_mutex_t		lock;
+		KeyToIndex			indexes;
+	};
+
+	// low bits pick the bucket within a shard, so use high bits to pick the shard
+	static uint32_t			shardIndex(size_t hash)	{ return (uint32_t)((hash >> 26) % kShardCount); }
+
+	Shard					_shards[kShardCount];
+	std::atomic<uint32_t>	_count;
+};
+
+
+inline uint32_t LiteralPool::intern(const char* string, size_t size, size_t hash)
+{
+	Shard& shard = _shards[shardIndex(hash)];
+	Key key = { string, size, hash };
+	pthread_mutex_lock(&shard.lock);
+	KeyToIndex::iterator pos = shard.indexes.find(key);
+	uint32_t index;
+	if ( pos != shard.indexes.end() ) {
+		index = pos->second;
+	}
+	else {
+		index = _count.fetch_add(1, std::memory_order_relaxed);
+		// grow four-fold instead of rehashing at every doubling when there are millions of strings
+		if ( shard.indexes.size() >= shard.indexes.bucket_count() )
+			shard.indexes.reserve(shard.indexes.size() * 4);
+		shard.indexes[key] = index;
+	}
+	pthread_mutex_unlock(&shard.lock);
+	return index;
+}
+
+inline uint64_t LiteralPool::memoryUsage() const
+{
+	uint64_t result = sizeof(LiteralPool);
+	for (uint32_t i=0; i < kShardCount; ++i) {
+		const KeyToIndex& indexes = _shards[i].indexes;
+		result += indexes.bucket_count()*sizeof(void*) + indexes.size()*(sizeof(KeyToIndex::value_type) + 2*sizeof(void*));
+	}
+	return result;
+}
+
+
+} // namespace ld
+
+#endif // __LITERAL_POOL_HPP__
@@ -25,6 +25,8 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <dirent.h>
+#include <ctype.h>
 #include <mach/vm_prot.h>
 #include <sys/sysctl.h>
 #include <mach-o/dyld.h>
@@ -32,6 +34,8 @@
 #include <errno.h>
 #include <string.h>
 #include <spawn.h>
+#include <pthread.h>
+#include <dispatch/dispatch.h>
 #include <cxxabi.h>
 #include <Availability.h>
 #include <tapi/tapi.h>
@@ -154,7 +158,7 @@ Options::Options(int argc, const char* argv[])
 	  fClientName(NULL),
 	  fUmbrellaName(NULL), fInitFunctionName(NULL), fDotOutputFile(NULL), fExecutablePath(NULL),
 	  fBundleLoader(NULL), fDtraceScriptName(NULL), fMapPath(NULL),
-	  fDyldInstallPath("/usr/lib/dyld"), fLtoCachePath(NULL), fTempLtoObjectPath(NULL), fOverridePathlibLTO(NULL), fLtoCpu(NULL),
+	  fDyldInstallPath("/usr/lib/dyld"), fLtoCachePath(NULL), fObjectParseCachePath(NULL), fObjectParseCacheMaxSize(256*1024*1024), fTBDCachePath(NULL), fTBDCacheMaxSize(256*1024*1024), fInputPrefetchLimit(16), fThreadCount(0), fStatisticsJSONPath(NULL), fSearchProbes(0), fSearchProbesRuledOut(0), fSearchDirectoriesListed(0), fTempLtoObjectPath(NULL), fOverridePathlibLTO(NULL), fLtoCpu(NULL),
 	  fKextObjectsEnable(-1),fKextObjectsDirPath(NULL),fToolchainPath(NULL),fOrderFilePath(NULL),
 	  fZeroPageSize(ULLONG_MAX), fStackSize(0), fStackAddr(0), fSourceVersion(0), fSDKVersion(0), fExecutableStack(false), 
 	  fNonExecutableHeap(false), fDisableNonExecutableHeap(false),
@@ -200,7 +204,7 @@ Options::Options(int argc, const char* argv[])
 	  fSharedRegionEncodingV2(false), fUseDataConstSegment(false),
 	  fUseDataConstSegmentForceOn(false), fUseDataConstSegmentForceOff(false), fUseTextExecSegment(false),
 	  fBundleBitcode(false), fHideSymbols(false), fVerifyBitcode(false),
-	  fReverseMapUUIDRename(false), fDeDupe(true), fVerboseDeDupe(false), fMakeInitializersIntoOffsets(false),
+	  fReverseMapUUIDRename(false), fDeDupe(true), fVerboseDeDupe(false), fTailMergeCStrings(false), fMakeInitializersIntoOffsets(false),
 	  fUseLinkedListBinding(false), fMakeChainedFixups(false), fMakeChainedFixupsSection(false), fNoLazyBinding(false), fDebugVariant(false),
 	  fReverseMapPath(NULL), fLTOCodegenOnly(false),
 	  fIgnoreAutoLink(false), fAllowDeadDups(false), fAllowWeakImports(true), fInitializersTreatment(Options::kInvalid),
@@ -213,6 +217,7 @@ Options::Options(int argc, const char* argv[])
 	  fDependencyInfoPath(NULL), fBuildContextName(NULL), fTraceFileDescriptor(-1), fMaxDefaultCommonAlign(0),
 	  fUnalignedPointerTreatment(kUnalignedPointerIgnore), fPreferTAPIFile(false), fOSOPrefixPath(NULL)
 {
+	pthread_mutex_init(&fFileSearchLock, NULL);
 	this->expandResponseFiles(argc, argv);
 	this->checkForClassic(argc, argv);
 	this->parsePreCommandLineEnvironmentSettings();
@@ -230,6 +235,7 @@ Options::~Options()
 {
 	if ( fTraceFileDescriptor != -1 )
 		::close(fTraceFileDescriptor);
+	pthread_mutex_destroy(&fFileSearchLock);
 }
 
 bool Options::errorBecauseOfWarnings() const
@@ -793,12 +799,108 @@ bool Options::checkForFile(const char* format, const char* dir, const char* root
 {
 	char possiblePath[strlen(dir)+strlen(rootName)+strlen(format)+8];
 	sprintf(possiblePath, format,  dir, rootName);
-	bool found = result.checkFileExists(*this, possiblePath);
+	return checkSearchPath(possiblePath, result);
+}
+
+bool Options::checkSearchPath(const char* path, FileInfo& result) const
+{
+	pthread_mutex_lock(&fFileSearchLock);
+	++fSearchProbes;
+	const bool mayExist = searchDirectoryMayContain(path);
+	pthread_mutex_unlock(&fFileSearchLock);
+	bool found = false;
+	if ( mayExist )
+		found = result.checkFileExists(*this, path);
+	else
+		addDependency(Options::depNotFound, path);
 	if ( fTraceDylibSearching )
-		printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), possiblePath);
+		printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), path);
 	return found;
 }
 
+//
+// Library and framework searches probe many names that don't exist in many directories.
+// Each search directory is read once, the first time a path in it is probed, and probes
+// for names not in it fail without a stat().  Names are compared in lower case because the
+// file system may not be case sensitive, so a listing can only rule a file out.  Paths that
+// might exist are still checked with stat(), which also gets their modification time.
+//
+bool Options::searchDirectoryMayContain(const char* path) const
+{
+	SearchDirectory* best = NULL;
+	for (SearchDirectory& dir : fSearchDirectories) {
+		if ( (best != NULL) && (dir.pathLen <= best->pathLen) )
+			continue;
+		if ( strncmp(path, dir.path, dir.pathLen) != 0 )
+			continue;
+		if ( (dir.path[dir.pathLen-1] != '/') && (path[dir.pathLen] != '/') )
+			continue;
+		best = &dir;
+	}
+	if ( best == NULL )
+		return true;
+
+	// the file or framework directory in the search directory
+	const char* leaf = &path[best->pathLen];
+	while ( *leaf == '/' )
+		++leaf;
+	const char* leafEnd = leaf;
+	while ( (*leafEnd != '\0') && (*leafEnd != '/') ) {
+		// leave non-ASCII names to stat(), the file system may normalize them
+		if ( (uint8_t)*leafEnd >= 0x80 )
+			return true;
+		++leafEnd;
+	}
+	if ( leafEnd == leaf )
+		return true;
+	std::string name(leaf, leafEnd - leaf);
+	for (char& c : name)
+		c = tolower((uint8_t)c);
+
+	if ( !best->listed )
+		listSearchDirectory(*best);
+	if ( !best->complete || (best->names.count(name) != 0) )
+		return true;
+	++fSearchProbesRuledOut;
+	return false;
+}
+
+void Options::listSearchDirectory(SearchDirectory& dir) const
+{
+	dir.listed = true;
+	DIR* dirp = opendir(dir.path);
+	// searchable but not readable directories fall back to stat()
+	if ( dirp == NULL )
+		return;
+	while ( true ) {
+		errno = 0;
+		struct dirent* entry = readdir(dirp);
+		if ( entry == NULL ) {
+			dir.complete = (errno == 0);
+			break;
+		}
+		std::string name(entry->d_name);
+		for (char& c : name)
+			c = tolower((uint8_t)c);
+		dir.names.insert(name);
+	}
+	closedir(dirp);
+	if ( !dir.complete ) {
+		dir.names.clear();
+		return;
+	}
+	++fSearchDirectoriesListed;
+	if ( fTraceDylibSearching )
+		printf("[Logging for XBS] listed search directory: '%s' (%lu entries)\n", dir.path, dir.names.size());
+}
+
+void Options::searchProbeCounts(uint32_t& probes, uint32_t& ruledOut, uint32_t& directoriesListed) const
+{
+	probes = fSearchProbes;
+	ruledOut = fSearchProbesRuledOut;
+	directoriesListed = fSearchDirectoriesListed;
+}
+
 
 Options::FileInfo Options::findLibrary(const char* rootName, bool dylibsOnly) const
 {
@@ -904,8 +1006,11 @@ Options::FileInfo Options::findFramework(const char* rootName, const char* suffi
 		auto possiblePath = std::string(path).append("/").append(rootName).append(".framework/").append(rootName);
 		if ( suffix != nullptr ) {
 			char realPath[PATH_MAX];
+			pthread_mutex_lock(&fFileSearchLock);
+			const bool mayExist = searchDirectoryMayContain(possiblePath.c_str());
+			pthread_mutex_unlock(&fFileSearchLock);
 			// no symlink in framework to suffix variants, so follow main symlink
-			if ( realpath(possiblePath.c_str(), realPath) != nullptr )
+			if ( mayExist && (realpath(possiblePath.c_str(), realPath) != nullptr) )
 				possiblePath = std::string(realPath).append(suffix);
 		}
         FileInfo result;
@@ -948,19 +1053,12 @@ bool Options::findFile(const std::string &path, const std::vector<std::string> &
 	FileInfo tbdInfo;
 	for ( const auto &ext : tbdExtensions ) {
 		auto newPath = replace_extension(path, ext);
-		bool found = tbdInfo.checkFileExists(*this, newPath.c_str());
-		if ( fTraceDylibSearching )
-			printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), newPath.c_str());
-		if ( found )
+		if ( checkSearchPath(newPath.c_str(), tbdInfo) )
 			break;
 	}
 
 	FileInfo dylibInfo;
-	{
-		bool found = dylibInfo.checkFileExists(*this, path.c_str());
-		if ( fTraceDylibSearching )
-			printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), path.c_str());
-	}
+	checkSearchPath(path.c_str(), dylibInfo);
 
 	// There is only a text-based stub file or a dynamic library file.
 	if ( tbdInfo.missing() != dylibInfo.missing() ) {
@@ -1217,49 +1315,66 @@ void Options::loadFileList(const char* fileOfPaths, ld::File::Ordinal baseOrdina
 		this->addDependency(Options::depFileList, fileOfPaths);
 	}
 
-	char path[PATH_MAX];
-	ld::File::Ordinal previousOrdinal = baseOrdinal;
-	while ( fgets(path, PATH_MAX, file) != NULL ) {
-		path[PATH_MAX-1] = '\0';
-		char* eol = strchr(path, '\n');
-		if ( eol != NULL )
-			*eol = '\0';
-		if ( prefix != NULL ) {
-			char builtPath[strlen(prefix)+strlen(path)+2];
-			strcpy(builtPath, prefix);
-			strcat(builtPath, "/");
-			strcat(builtPath, path);
-           if (fPipelineFifo != NULL) {
-			   FileInfo info = FileInfo(builtPath);
-			   info.ordinal = previousOrdinal.nextFileListOrdinal();
-			   previousOrdinal = info.ordinal;
-			   info.fromFileList = true;
-              fInputFiles.push_back(info);
-           } else {
-			   FileInfo info = findFile(builtPath);
-			   info.ordinal = previousOrdinal.nextFileListOrdinal();
-			   previousOrdinal = info.ordinal;
-			   info.fromFileList = true;
-			   fInputFiles.push_back(info);
-           }
-		}
-		else {
-           if (fPipelineFifo != NULL) {
-			   FileInfo info = FileInfo(path);
-			   info.ordinal = previousOrdinal.nextFileListOrdinal();
-			   previousOrdinal = info.ordinal;
-			   info.fromFileList = true;
-			   fInputFiles.push_back(info);
-           } else {
-			   FileInfo info = findFile(path);
-			   info.ordinal = previousOrdinal.nextFileListOrdinal();
-			   previousOrdinal = info.ordinal;
-			   info.fromFileList = true;
-			   fInputFiles.push_back(info);
-           }
+	// read the whole list, then look for the files on several threads since with big
+	// projects on network file systems the stat() calls are most of the time spent here
+	std::string contents;
+	char buffer[64*1024];
+	size_t amount;
+	while ( (amount = fread(buffer, 1, sizeof(buffer), file)) != 0 )
+		contents.append(buffer, amount);
+	fclose(file);
+
+	std::vector<std::string> paths;
+	for (size_t start=0; start < contents.size(); ) {
+		size_t eol = contents.find('\n', start);
+		if ( eol == std::string::npos )
+			eol = contents.size();
+		std::string path = contents.substr(start, eol-start);
+		if ( prefix != NULL )
+			path = std::string(prefix) + "/" + path;
+		paths.push_back(path);
+		start = eol + 1;
+	}
+
+	const size_t count = paths.size();
+	std::vector<FileInfo> infos(count);
+	if ( fPipelineFifo != NULL ) {
+		// files will show up as the pipeline writes them, so don't look for them now
+		for (size_t i=0; i < count; ++i)
+			infos[i] = FileInfo(paths[i].c_str());
+	}
+	else if ( fTraceDylibSearching || (count < 64) ) {
+		// keep the search log in file list order
+		for (size_t i=0; i < count; ++i)
+			infos[i] = findFile(paths[i]);
+	}
+	else {
+		std::vector<const char*> errors(count, NULL);
+		FileInfo* infoArray = &infos[0];
+		const std::string* pathArray = &paths[0];
+		const char** errorArray = &errors[0];
+		dispatch_apply(count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+			try {
+				infoArray[i] = findFile(pathArray[i]);
+			}
+			catch (const char* msg) {
+				errorArray[i] = msg;
+			}
+		});
+		// report the first missing file, as a serial search would
+		for (const char* msg : errors) {
+			if ( msg != NULL )
+				throw msg;
 		}
 	}
-	fclose(file);
+
+	ld::File::Ordinal previousOrdinal = baseOrdinal;
+	for (FileInfo& info : infos) {
+		info.ordinal = previousOrdinal.nextFileListOrdinal();
+		previousOrdinal = info.ordinal;
+		info.fromFileList = true;
+		fInputFiles.push_back(info);
+	}
 }
 
 
@@ -2560,6 +2675,52 @@ void Options::parse(int argc, const char* argv[])
 				if ( fLtoCachePath == NULL )
 					throw "missing argument to -cache_path_lto";
 			}
+			else if ( strcmp(arg, "-object_parse_cache") == 0 ) {
+				fObjectParseCachePath = argv[++i];
+				if ( fObjectParseCachePath == NULL )
+					throw "missing argument to -object_parse_cache";
+			}
+			else if ( strcmp(arg, "-object_parse_cache_size") == 0 ) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -object_parse_cache_size";
+				char* endptr;
+				fObjectParseCacheMaxSize = strtoull(value, &endptr, 10) * 1024 * 1024;
+				if ( *endptr != '\0')
+					throw "invalid argument for -object_parse_cache_size";
+			}
+			else if ( strcmp(arg, "-tbd_cache_path") == 0 ) {
+				fTBDCachePath = argv[++i];
+				if ( fTBDCachePath == NULL )
+					throw "missing argument to -tbd_cache_path";
+			}
+			else if ( strcmp(arg, "-tbd_cache_size") == 0 ) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -tbd_cache_size";
+				char* endptr;
+				fTBDCacheMaxSize = strtoull(value, &endptr, 10) * 1024 * 1024;
+				if ( *endptr != '\0')
+					throw "invalid argument for -tbd_cache_size";
+			}
+			else if ( strcmp(arg, "-input_prefetch_limit") == 0 ) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -input_prefetch_limit";
+				char* endptr;
+				fInputPrefetchLimit = strtoul(value, &endptr, 10);
+				if ( *endptr != '\0')
+					throw "invalid argument for -input_prefetch_limit";
+			}
+			else if ( strcmp(arg, "-threads") == 0 ) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -threads";
+				char* endptr;
+				fThreadCount = strtoul(value, &endptr, 10);
+				if ( (*endptr != '\0') || (fThreadCount == 0) )
+					throw "invalid argument for -threads";
+			}
 			else if ( strcmp(arg, "-prune_interval_lto") == 0 ) {
 				const char* value = argv[++i];
 				if ( value == NULL )
@@ -3391,6 +3552,11 @@ void Options::parse(int argc, const char* argv[])
 			else if ( strcmp(arg, "-print_statistics") == 0 ) {
 				fStatistics = true;
 			}
+			else if ( strcmp(arg, "-statistics_json") == 0 ) {
+				fStatisticsJSONPath = argv[++i];
+				if ( fStatisticsJSONPath == NULL )
+					throw "missing argument to -statistics_json";
+			}
 			else if ( strcmp(arg, "-d") == 0 ) {
 				fMakeTentativeDefinitionsReal = true;
 			}
@@ -4013,6 +4179,9 @@ void Options::parse(int argc, const char* argv[])
 			else if ( strcmp(arg, "-verbose_deduplicate") == 0 ) {
 				fVerboseDeDupe = true;
 			}
+			else if ( strcmp(arg, "-tail_merge_cstrings") == 0 ) {
+				fTailMergeCStrings = true;
+			}
 			else if ( strcmp(arg, "-max_default_common_align") == 0 ) {
 				const char* alignStr = argv[++i];
 				if ( alignStr == NULL )
@@ -4419,6 +4588,11 @@ void Options::buildSearchPaths(int argc, const char* argv[])
 		}
 	}
 
+	for (const char* dir : fLibrarySearchPaths)
+		fSearchDirectories.push_back(SearchDirectory(dir));
+	for (const char* dir : fFrameworkSearchPaths)
+		fSearchDirectories.push_back(SearchDirectory(dir));
+
 	if ( fVerbose ) {
 		fprintf(stderr,"Library search paths:\n");
 		for (std::vector<const char*>::iterator it = fLibrarySearchPaths.begin();
@@ -4496,6 +4670,10 @@ void Options::parsePreCommandLineEnvironmentSettings()
 	const char* customDyldPath = getenv("LD_DYLD_PATH");
 	if ( customDyldPath != NULL ) 
 		fDyldInstallPath = customDyldPath;
+
+	const char* objectParseCachePath = getenv("LD_OBJECT_PARSE_CACHE");
+	if ( objectParseCachePath != NULL )
+		fObjectParseCachePath = objectParseCachePath;
     
     const char* debugArchivePath = getenv("LD_DEBUG_SNAPSHOT");
     if (debugArchivePath != NULL) {
@@ -6612,7 +6790,10 @@ void Options::addDependency(uint8_t opcode, const char* path) const
 	DependencyEntry entry;
 	entry.opcode = opcode;
 	entry.path   = path;
+	// file lists are searched on several threads
+	pthread_mutex_lock(&fFileSearchLock);
 	fDependencies.push_back(entry);
+	pthread_mutex_unlock(&fFileSearchLock);
 }
 
 
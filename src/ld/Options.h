@@ -27,6 +27,7 @@
 
 
 #include <stdint.h>
+#include <pthread.h>
 #include <mach/machine.h>
 #include <tapi/tapi.h>
 
@@ -351,6 +352,9 @@ public:
 	bool						warnStabs();
 	bool						pauseAtEnd() { return fPause; }
 	bool						printStatistics() const { return fStatistics; }
+	const char*					statisticsJSONPath() const { return fStatisticsJSONPath; }
+	bool						traceDylibSearching() const { return fTraceDylibSearching; }
+	void						searchProbeCounts(uint32_t& probes, uint32_t& ruledOut, uint32_t& directoriesListed) const;
 	bool						printArchPrefix() const { return fMessagesPrefixedWithArchitecture; }
 	void						gotoClassicLinker(int argc, const char* argv[]);
 	bool						sharedRegionEligible() const { return fSharedRegionEligible; }
@@ -437,6 +441,12 @@ public:
 	bool						addDataInCodeInfo() const { return fDataInCodeInfoLoadCommand; }
 	bool						canReExportSymbols() const { return fCanReExportSymbols; }
 	const char*					ltoCachePath() const { return fLtoCachePath; }
+	const char*					objectParseCachePath() const { return fObjectParseCachePath; }
+	uint64_t					objectParseCacheMaxSize() const { return fObjectParseCacheMaxSize; }
+	const char*					tbdCachePath() const { return fTBDCachePath; }
+	uint64_t					tbdCacheMaxSize() const { return fTBDCacheMaxSize; }
+	uint32_t					inputPrefetchLimit() const { return fInputPrefetchLimit; }
+	uint32_t					threadCount() const { return fThreadCount; }
 	bool						ltoPruneIntervalOverwrite() const { return fLtoPruneIntervalOverwrite; }
 	int							ltoPruneInterval() const { return fLtoPruneInterval; }
 	int							ltoPruneAfter() const { return fLtoPruneAfter; }
@@ -464,6 +474,7 @@ public:
 	bool						renameReverseSymbolMap() const { return fReverseMapUUIDRename; }
 	bool						deduplicateFunctions() const { return fDeDupe; }
 	bool						verboseDeduplicate() const { return fVerboseDeDupe; }
+	bool						tailMergeCStrings() const { return fTailMergeCStrings; }
 	bool						makeInitializersIntoOffsets() const { return fMakeInitializersIntoOffsets; }
 	bool						useLinkedListBinding() const { return fUseLinkedListBinding; }
 	bool						makeChainedFixups() const { return fMakeChainedFixups; }
@@ -577,6 +588,15 @@ private:
 		SetWithWildcards	symbols;
 	};
 
+	struct SearchDirectory {
+									SearchDirectory(const char* p) : path(p), pathLen(strlen(p)), listed(false), complete(false) { }
+		const char*						path;
+		size_t							pathLen;
+		bool							listed;
+		bool							complete;	// names has every entry, so a name not in it does not exist
+		std::unordered_set<std::string>	names;		// lower cased
+	};
+
 	struct DependencyEntry {
 		uint8_t				opcode;
 		std::string			path;
@@ -592,6 +612,9 @@ private:
 	FileInfo					findFramework(const char* rootName, const char* suffix) const;
 	bool						checkForFile(const char* format, const char* dir, const char* rootName,
 											 FileInfo& result) const;
+	bool						checkSearchPath(const char* path, FileInfo& result) const;
+	bool						searchDirectoryMayContain(const char* path) const;
+	void						listSearchDirectory(SearchDirectory& dir) const;
 	uint64_t					parseVersionNumber64(const char*);
 	std::string					getVersionString32(uint32_t ver) const;
 	std::string					getVersionString64(uint64_t ver) const;
@@ -683,6 +706,18 @@ private:
 	const char*							fMapPath;
 	const char*							fDyldInstallPath;
 	const char*							fLtoCachePath;
+	const char*							fObjectParseCachePath;
+	uint64_t							fObjectParseCacheMaxSize;
+	const char*							fTBDCachePath;
+	uint64_t							fTBDCacheMaxSize;
+	uint32_t							fInputPrefetchLimit;
+	uint32_t							fThreadCount;
+	const char*							fStatisticsJSONPath;
+	mutable std::vector<SearchDirectory>	fSearchDirectories;
+	mutable uint32_t					fSearchProbes;
+	mutable uint32_t					fSearchProbesRuledOut;
+	mutable uint32_t					fSearchDirectoriesListed;
+	mutable pthread_mutex_t				fFileSearchLock;
 	bool								fLtoPruneIntervalOverwrite;
 	int									fLtoPruneInterval;
 	int									fLtoPruneAfter;
@@ -821,6 +856,7 @@ private:
 	bool								fReverseMapUUIDRename;
 	bool								fDeDupe;
 	bool								fVerboseDeDupe;
+	bool								fTailMergeCStrings;
 	bool								fMakeInitializersIntoOffsets;
 	bool								fUseLinkedListBinding;
 	bool								fMakeChainedFixups;
@@ -42,6 +42,7 @@
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 #include <mach-o/fat.h>
+#include <dispatch/dispatch.h>
 
 #include <string>
 #include <map>
@@ -67,6 +68,8 @@
 #include "HeaderAndLoadCommands.hpp"
 #include "LinkEdit.hpp"
 #include "LinkEditClassic.hpp"
+#include "ChainedFixups.hpp"
+#include "RadixSort.hpp"
 #include "generic_dylib_file.hpp"
 
 namespace ld {
@@ -106,6 +109,9 @@ OutputFile::OutputFile(const Options& opts, ld::Internal& state)
 		_hasExternalRelocations(!_hasDyldInfo && !opts.makeThreadedStartsSection()),
 		_hasOptimizationHints(opts.outputKind() == Options::kObjectFile),
 		_hasCodeSignature(opts.adHocSign()),
+		_contentBytesCopiedInRuns(0),
+		_contentBytesCopiedPerAtom(0),
+		_contentRunCount(0),
 		_encryptedTEXTstartOffset(0),
 		_encryptedTEXTendOffset(0),
 		_localSymbolsStartIndex(0),
@@ -201,6 +207,71 @@ bool OutputFile::findSegment(ld::Internal& state, uint64_t addr, uint64_t* start
 }
 
 
+// The rebase and bind tables can have tens of millions of entries, so they are radix
+// sorted on integer keys instead of with their operator<.  Keys are applied least
+// significant first, and each radix pass is stable, so the result matches operator<.
+void OutputFile::sortRebaseInfo()
+{
+	// sort by type, then address
+	const RebaseInfo* info = _rebaseInfo.data();
+	ld::radix_sort::Sorter sorter(_rebaseInfo.size());
+	sorter.sortBy([=](uint32_t i) { return info[i]._address; });
+	sorter.sortBy([=](uint32_t i) { return (uint64_t)info[i]._type; });
+	sorter.apply(_rebaseInfo);
+}
+
+void OutputFile::sortBindingInfo()
+{
+	// sort by library, symbol, type, flags (descending), then address
+	const BindingInfo* info = _bindingInfo.data();
+	std::vector<uint32_t> symbolRanks;
+	const uint32_t rankCount = ld::radix_sort::rankNames(_bindingInfo.size(), [=](uint32_t i) { return info[i]._symbolName; }, symbolRanks);
+	const uint32_t* ranks = symbolRanks.data();
+	// library ordinals go just above the symbol rank, offset so special (negative) ordinals sort first
+	const unsigned rankBits = (rankCount > 1) ? (32 - __builtin_clz(rankCount - 1)) : 0;
+	int minOrdinal = 0;
+	for (const BindingInfo& bind : _bindingInfo)
+		minOrdinal = std::min(minOrdinal, bind._libraryOrdinal);
+	ld::radix_sort::Sorter sorter(_bindingInfo.size());
+	sorter.sortBy([=](uint32_t i) { return info[i]._address; });
+	sorter.sortBy([=](uint32_t i) { return ((uint64_t)info[i]._type << 8) | (uint8_t)~info[i]._flags; });
+	sorter.sortBy([=](uint32_t i) { return ((uint64_t)((int64_t)info[i]._libraryOrdinal - minOrdinal) << rankBits) | ranks[i]; });
+	sorter.apply(_bindingInfo);
+}
+
+void OutputFile::sortWeakBindingInfo()
+{
+	// sort by symbol, type, then address
+	const BindingInfo* info = _weakBindingInfo.data();
+	std::vector<uint32_t> symbolRanks;
+	ld::radix_sort::rankNames(_weakBindingInfo.size(), [=](uint32_t i) { return info[i]._symbolName; }, symbolRanks);
+	const uint32_t* ranks = symbolRanks.data();
+	ld::radix_sort::Sorter sorter(_weakBindingInfo.size());
+	sorter.sortBy([=](uint32_t i) { return info[i]._address; });
+	sorter.sortBy([=](uint32_t i) { return (uint64_t)info[i]._type; });
+	sorter.sortBy([=](uint32_t i) { return (uint64_t)ranks[i]; });
+	sorter.apply(_weakBindingInfo);
+}
+
+// Fills in _threadedRebaseBindIndices with every rebase and bind, sorted by address
+void OutputFile::buildThreadedRebaseBindIndices()
+{
+	_threadedRebaseBindIndices.reserve(_bindingInfo.size() + _rebaseInfo.size());
+
+	for (int64_t i = 0, e = _rebaseInfo.size(); i != e; ++i)
+		_threadedRebaseBindIndices.push_back(-i);
+
+	for (int64_t i = 0, e = _bindingInfo.size(); i != e; ++i)
+		_threadedRebaseBindIndices.push_back(i + 1);
+
+	const RebaseInfo* rebaseInfo = _rebaseInfo.data();
+	const BindingInfo* bindInfo = _bindingInfo.data();
+	ld::radix_sort::sort(_threadedRebaseBindIndices, [=](int64_t index) {
+		return index <= 0 ? rebaseInfo[-index]._address : bindInfo[index - 1]._address;
+	});
+}
+
+
 void OutputFile::assignAtomAddresses(ld::Internal& state)
 {
 	const bool log = false;
@@ -3097,6 +3168,30 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 {
 	const bool logThreadedFixups = false;
 
+	// Atoms with no fixups whose content is a range of a mapped input file are not copied one
+	// at a time.  Consecutive ones that are also consecutive in their input file (most of a
+	// __cstring, __const or -sectcreate section) are merged into one run and copied with one
+	// memcpy when an atom that does not continue the run comes along.
+	const uint8_t* runSource = NULL;
+	uint64_t runFileOffset = 0;
+	uint64_t runSize = 0;
+	uint32_t runAtomCount = 0;
+	auto flushRun = [&]() {
+		if ( runSize != 0 ) {
+			memcpy(&wholeBuffer[runFileOffset], runSource, runSize);
+			if ( runAtomCount > 1 ) {
+				_contentBytesCopiedInRuns += runSize;
+				++_contentRunCount;
+			}
+			else {
+				_contentBytesCopiedPerAtom += runSize;
+			}
+		}
+		runSource = NULL;
+		runSize = 0;
+		runAtomCount = 0;
+	};
+
 	// have each atom write itself
 	uint64_t fileOffsetOfEndOfLastAtom = 0;
 	bool lastAtomUsesNoOps = false;
@@ -3121,10 +3216,31 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 				if ( (fileOffset != fileOffsetOfEndOfLastAtom) && lastAtomUsesNoOps ) {
 					this->copyNoOps(&wholeBuffer[fileOffsetOfEndOfLastAtom], &wholeBuffer[fileOffset], lastAtomWasThumb);
 				}
-				// copy atom content
-				atom->copyRawContent(&wholeBuffer[fileOffset]);
-				// apply fix ups
-				this->applyFixUps(state, baseAddress, atom, &wholeBuffer[fileOffset]);
+				const uint8_t* rawContent = NULL;
+				if ( (atom->fixupsBegin() == atom->fixupsEnd()) && (atom->contentType() != ld::Atom::typeZeroFill) && (atom->size() != 0) )
+					rawContent = atom->rawContentPointer();
+				if ( rawContent != NULL ) {
+					if ( (runSize != 0) && ((runSource + runSize) == rawContent) && ((runFileOffset + runSize) == fileOffset) ) {
+						runSize += atom->size();
+						++runAtomCount;
+					}
+					else {
+						flushRun();
+						runSource = rawContent;
+						runFileOffset = fileOffset;
+						runSize = atom->size();
+						runAtomCount = 1;
+					}
+				}
+				else {
+					// fixups may look at content already written, so finish any run first
+					flushRun();
+					// copy atom content
+					atom->copyRawContent(&wholeBuffer[fileOffset]);
+					_contentBytesCopiedPerAtom += atom->size();
+					// apply fix ups
+					this->applyFixUps(state, baseAddress, atom, &wholeBuffer[fileOffset]);
+				}
 				fileOffsetOfEndOfLastAtom = fileOffset+atom->size();
 				lastAtomUsesNoOps = sectionUsesNops;
 				lastAtomWasThumb = atom->isThumb();
@@ -3136,6 +3252,7 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 					throwf("%s in '%s'", msg, atom->name());
 			}
 		}
+		flushRun();
 	}
 	
 	if ( _options.verboseOptimizationHints() ) {
@@ -3146,29 +3263,7 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 
 	if ( _options.makeThreadedStartsSection() ) {
 		assert(_threadedRebaseBindIndices.empty());
-
-		std::vector<OutputFile::BindingInfo>& bindInfo = _bindingInfo;
-		std::vector<OutputFile::RebaseInfo>& rebaseInfo = _rebaseInfo;
-
-		std::vector<int64_t>& threadedRebaseBindIndices = _threadedRebaseBindIndices;
-		threadedRebaseBindIndices.reserve(bindInfo.size() + rebaseInfo.size());
-
-		for (int64_t i = 0, e = rebaseInfo.size(); i != e; ++i)
-			threadedRebaseBindIndices.push_back(-i);
-
-		for (int64_t i = 0, e = bindInfo.size(); i != e; ++i)
-			threadedRebaseBindIndices.push_back(i + 1);
-
-		// Now sort the entries by address.
-		std::sort(threadedRebaseBindIndices.begin(), threadedRebaseBindIndices.end(),
-				  [&rebaseInfo, &bindInfo](int64_t indexA, int64_t indexB) {
-					  if (indexA == indexB)
-						  return false;
-					  uint64_t addressA = indexA <= 0 ? rebaseInfo[-indexA]._address : bindInfo[indexA - 1]._address;
-					  uint64_t addressB = indexB <= 0 ? rebaseInfo[-indexB]._address : bindInfo[indexB - 1]._address;
-					  assert(addressA != addressB);
-					  return addressA < addressB;
-				  });
+		buildThreadedRebaseBindIndices();
 	}
 
 	// new rebasing/binding scheme requires making another pass at DATA
@@ -3486,57 +3581,51 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 			}
 		}
 		else {
-			// chain together fixups
-			uint32_t segIndex = 0;
+			// chain together fixups, each page on its own
+			struct PageToChain { ChainedFixupSegInfo* segInfo; uint32_t pageIndex; uint8_t* pageBufferStart; };
+			std::vector<PageToChain> pagesToChain;
 			for (ChainedFixupSegInfo& segInfo : _chainedFixupSegments) {
 				//fprintf(stderr, "0x%08llX 0x%08llX %s\n", segInfo.startAddr, segInfo.endAddr-segInfo.startAddr, segInfo.name);
-				uint8_t* segBufferStart = &wholeBuffer[segInfo.fileOffset];
-				uint8_t* pageBufferStart = segBufferStart;
+				uint8_t* pageBufferStart = &wholeBuffer[segInfo.fileOffset];
+				for (uint32_t pageIndex=0; pageIndex < segInfo.pages.size(); ++pageIndex) {
+					if ( segInfo.pages[pageIndex].fixupOffsets.size() > 1 )
+						pagesToChain.push_back({ &segInfo, pageIndex, pageBufferStart });
+					pageBufferStart += segInfo.pageSize;
+				}
+			}
+			const PageToChain* pageArray = pagesToChain.data();
+			dispatch_apply(pagesToChain.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+				ChainedFixupSegInfo& segInfo = *pageArray[i].segInfo;
+				ChainedFixupPageInfo& pageInfo = segInfo.pages[pageArray[i].pageIndex];
+				uint8_t* pageBufferStart = pageArray[i].pageBufferStart;
+				if ( segInfo.pointerFormat != DYLD_CHAINED_PTR_32 ) {
+					ld::chained_fixups::chainPage(pageBufferStart, pageInfo.fixupOffsets, segInfo.pointerFormat);
+					return;
+				}
+				// only adds to this page's chainOverflows, so pages can still be done in parallel
+				uint8_t* prevLoc = nullptr;
+				for (uint16_t pageOffset : pageInfo.fixupOffsets) {
+					uint8_t* loc = pageBufferStart + pageOffset;
+					if ( prevLoc != nullptr )
+						chain32bitPointers((dyld_chained_ptr_32_rebase*)prevLoc, (dyld_chained_ptr_32_rebase*)loc,
+											segInfo, pageBufferStart, pageArray[i].pageIndex);
+					prevLoc = loc;
+				}
+			});
+
+			// extra 32-bit chain starts go in overflow slots after the per-page starts, in page order
+			dyld_chained_fixups_header* header = NULL;
+			for (ld::Internal::FinalSection* sect : state.sections) {
+				//fprintf(stderr, "file offset=0x%08llX, section %s\n", sect->fileOffset, sect->sectionName());
+				if ( (sect->type() == ld::Section::typeLinkEdit) && (strcmp(sect->sectionName(), "__chainfixups") == 0) )
+					header = (dyld_chained_fixups_header*)&wholeBuffer[sect->fileOffset];
+			}
+			uint32_t segIndex = 0;
+			for (ChainedFixupSegInfo& segInfo : _chainedFixupSegments) {
 				uint32_t pageIndex = 0;
 				uint32_t nextOverflowSlot = segInfo.pages.size();
 				for (ChainedFixupPageInfo& pageInfo : segInfo.pages) {
-					//fprintf(stderr, "   fixup count: %lu\n", pageInfo.fixupOffsets.size());
-					uint8_t* prevLoc = nullptr;
-					for (uint16_t pageOffset : pageInfo.fixupOffsets) {
-						uint8_t* loc = (uint8_t*)pageBufferStart + pageOffset;
-						//fprintf(stderr, "%p, pageOffset=0x%04X, bind=%d\n", loc, pageOffset, ((dyld_chained_ptr_64_rebase*)loc)->bind);
-						if ( prevLoc != nullptr ) {
-							uint64_t delta = (uint8_t*)loc - (uint8_t*)prevLoc;
-							switch ( segInfo.pointerFormat ) {
-								case DYLD_CHAINED_PTR_ARM64E:
-								case DYLD_CHAINED_PTR_ARM64E_USERLAND:
-								case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
-									((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/8;
-									assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 8) == delta && "next out of range");
-									break;
-								case DYLD_CHAINED_PTR_ARM64E_KERNEL:
-								case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
-									((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/4;
-									assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 4) == delta && "next out of range");
-									break;
-								case DYLD_CHAINED_PTR_64:
-								case DYLD_CHAINED_PTR_64_OFFSET:
-									((dyld_chained_ptr_64_rebase*)prevLoc)->next = delta/4;
-									assert((((dyld_chained_ptr_64_rebase*)prevLoc)->next * 4) == delta && "next out of range");
-									break;
-								case DYLD_CHAINED_PTR_32:
-									chain32bitPointers((dyld_chained_ptr_32_rebase*)prevLoc, (dyld_chained_ptr_32_rebase*)loc,
-														segInfo, pageBufferStart, pageIndex);
-									break;
-								default:
-									assert(0 && "unknown pointer format");
-							}
-						}
-						prevLoc = loc;
-					}
 					if ( !pageInfo.chainOverflows.empty() ) {
-						uint8_t* chainHeader = NULL;
-						for (ld::Internal::FinalSection* sect : state.sections) {
-							//fprintf(stderr, "file offset=0x%08llX, section %s\n", sect->fileOffset, sect->sectionName());
-							if ( (sect->type() == ld::Section::typeLinkEdit) && (strcmp(sect->sectionName(), "__chainfixups") == 0) )
-								chainHeader = &wholeBuffer[sect->fileOffset];
-						}
-						dyld_chained_fixups_header*     header    = (dyld_chained_fixups_header*)chainHeader;
 						dyld_chained_starts_in_image*   chains    = (dyld_chained_starts_in_image*)((uint8_t*)header + header->starts_offset);
 						dyld_chained_starts_in_segment* segChains = (dyld_chained_starts_in_segment*)((uint8_t*)chains + chains->seg_info_offset[segIndex]);
 						uint32_t						maxOverFlowCount = (segChains->size - offsetof(dyld_chained_starts_in_segment, page_start[segChains->page_count]))/sizeof(uint16_t);
@@ -3553,7 +3642,6 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 						}
 						assert(nextOverflowSlot <= maxOverFlowCount);
 					}
-					pageBufferStart += segInfo.pageSize;
 					++pageIndex;
 				}
 				++segIndex;
@@ -3761,6 +3849,69 @@ void OutputFile::computeContentUUID(ld::Internal& state, uint8_t* wholeBuffer)
 	}
 }
 
+//
+// Writes ranges of the output buffer into an already sized output file on a serial queue,
+// so the disk I/O overlaps whatever work is left before the link finishes.  Each range is
+// split into pwrite()s of at most kChunkSize, so one huge section doesn't hold up the queue.
+// This only overlaps I/O, it does not save memory: the ranges are written straight from the
+// whole-file buffer, which must stay allocated until finish() returns.
+//
+class OutputStreamer
+{
+public:
+					OutputStreamer(int fd, const uint8_t* buffer) : _fd(fd), _buffer(buffer), _queue(NULL), _error(0) { }
+					~OutputStreamer();
+	void			write(uint64_t fileOffset, uint64_t size);
+	int				finish();
+
+private:
+	enum { kChunkSize = 8*1024*1024 };
+
+	int					_fd;
+	const uint8_t*		_buffer;
+	dispatch_queue_t	_queue;
+	int					_error;
+};
+
+OutputStreamer::~OutputStreamer()
+{
+	// the buffer may be freed after this, so let queued writes drain first
+	finish();
+	if ( _queue != NULL )
+		dispatch_release(_queue);
+}
+
+void OutputStreamer::write(uint64_t fileOffset, uint64_t size)
+{
+	if ( _queue == NULL )
+		_queue = dispatch_queue_create("com.apple.ld.output", DISPATCH_QUEUE_SERIAL);
+	const int fd = _fd;
+	const uint8_t* buffer = _buffer;
+	int* error = &_error;
+	for (uint64_t chunkStart = fileOffset; chunkStart < fileOffset+size; chunkStart += kChunkSize) {
+		const uint64_t chunkEnd = std::min(chunkStart + kChunkSize, fileOffset+size);
+		dispatch_async(_queue, ^{
+			uint64_t offset = chunkStart;
+			while ( (offset < chunkEnd) && (*error == 0) ) {
+				ssize_t amount = ::pwrite(fd, &buffer[offset], chunkEnd - offset, offset);
+				if ( amount > 0 )
+					offset += amount;
+				else if ( (amount == -1) && (errno != EINTR) )
+					*error = errno;
+			}
+		});
+	}
+}
+
+// waits for all queued writes, returns the errno of the first that failed, or zero
+int OutputStreamer::finish()
+{
+	if ( _queue != NULL )
+		dispatch_sync(_queue, ^{ });
+	return _error;
+}
+
+
 static int sDescriptorOfPathToRemove = -1;
 static void removePathAndExit(int sig)
 {
@@ -3874,7 +4025,19 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 			fd = open(_options.outputFilePath(),  O_WRONLY);
 		if ( fd == -1 ) 
 			throwf("can't open output file for writing: %s, errno=%d", _options.outputFilePath(), errno);
-		// try to allocate buffer for entire output file content
+		// size a regular file up front, so running out of disk space is found before linking the content
+		// and each part can be written in place as soon as it is final
+		if ( outputIsRegularFile && (ftruncate(fd, _fileSize) == -1) ) {
+			int err = errno;
+			::close(fd);
+			if ( err == ENOSPC )
+				throwf("not enough disk space for writing '%s'", _options.outputFilePath());
+			else
+				throwf("can't grow file for writing '%s', errno=%d", _options.outputFilePath(), err);
+		}
+		// try to allocate buffer for entire output file content.  The whole image has to be in memory
+		// because threaded/chained fixups patch across sections, and the content UUID and code signature
+		// hash all of it, so sections can't be written and dropped as they are finished.
 		wholeBuffer = (uint8_t*)calloc(_fileSize, 1);
 		if ( wholeBuffer == NULL )
 			throwf("can't create buffer of %llu bytes for output", _fileSize);
@@ -3887,14 +4050,28 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 	}
 
 	writeAtoms(state, wholeBuffer);
-	
+
+	// When the output can't be mapped, start writing everything that is already final while the
+	// UUID and code signature are computed.  Only the load commands (LC_UUID) and the code signature
+	// still change, so they are written last.
+	OutputStreamer streamer(fd, wholeBuffer);
+	const bool streamOutput = outputIsRegularFile && !outputIsMappableFile;
+	const uint64_t headerEnd = headerAndLoadCommandsSection->fileOffset + headerAndLoadCommandsSection->size;
+	const uint64_t codeSignatureStart = _hasCodeSignature ? state.sections.back()->fileOffset : _fileSize;
+	if ( streamOutput )
+		streamer.write(headerEnd, codeSignatureStart - headerEnd);
+
 	// compute UUID 
 	if ( _options.UUIDMode() == Options::kUUIDContent )
 		computeContentUUID(state, wholeBuffer);
+	if ( streamOutput )
+		streamer.write(0, headerEnd);
 
 	// now that file output buffer is complete, if codesigned, compute each page's hash
 	if ( _hasCodeSignature )
 		_codeSignatureAtom->hash(wholeBuffer);
+	if ( streamOutput )
+		streamer.write(codeSignatureStart, _fileSize - codeSignatureStart);
 
 	if ( outputIsRegularFile && outputIsMappableFile ) {
 		::close(fd);
@@ -3908,7 +4085,11 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 		}
 	} 
 	else {
-		if ( ::write(fd, wholeBuffer, _fileSize) == -1 ) {
+		if ( streamOutput ) {
+			if ( int err = streamer.finish() )
+				throwf("can't write to output file: %s, errno=%d", _options.outputFilePath(), err);
+		}
+		else if ( ::write(fd, wholeBuffer, _fileSize) == -1 ) {
 			throwf("can't write to output file: %s, errno=%d", _options.outputFilePath(), errno);
 		}
 		sDescriptorOfPathToRemove = -1;
@@ -5455,11 +5636,12 @@ void OutputFile::buildChainedFixupInfo(ld::Internal& state)
 		throw "unaligned pointer(s)";
 
 	// sort all fixups on each page, so chain can be built
+	std::vector<ChainedFixupPageInfo*> allPages;
 	for (ChainedFixupSegInfo& segInfo : _chainedFixupSegments) {
-		for (ChainedFixupPageInfo& pageInfo : segInfo.pages) {
-			std::sort(pageInfo.fixupOffsets.begin(), pageInfo.fixupOffsets.end());
-		}
+		for (ChainedFixupPageInfo& pageInfo : segInfo.pages)
+			allPages.push_back(&pageInfo);
 	}
+	ld::chained_fixups::sortPages(allPages);
 	// remember largest legal rebase target
 	uint64_t baseAddress = 0;
 	uint64_t maxRebaseAddress = 0;
@@ -7066,8 +7248,10 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 		return;
 	// make a vector of atoms that come from files compiled with dwarf debug info
 	std::vector<const ld::Atom*> atomsNeedingDebugNotes;
-	std::set<const ld::Atom*> atomsWithStabs;
-	std::set<const ld::relocatable::File*> filesSeenWithStabs;
+	// sorted and uniqued after the scan, cheaper than node based sets with 100Ks of atoms
+	std::vector<const ld::Atom*> atomsWithStabs;
+	std::vector<const ld::relocatable::File*> filesSeenWithStabs;
+	std::vector<const ld::relocatable::File*> filesWithDwarf;
 	atomsNeedingDebugNotes.reserve(1024);
 	const ld::relocatable::File* objFile = NULL;
 	bool objFileHasDwarf = false;
@@ -7107,6 +7291,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 								break;
 							case ld::relocatable::File::kDebugInfoDwarf:
 								objFileHasDwarf = true;
+								filesWithDwarf.push_back(objFile);
 								break;
 							case ld::relocatable::File::kDebugInfoStabs:
 							case ld::relocatable::File::kDebugInfoStabsUUID:
@@ -7118,13 +7303,26 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 				if ( objFileHasDwarf )
 					atomsNeedingDebugNotes.push_back(atom);
 				if ( objFileHasStabs ) {
-					atomsWithStabs.insert(atom);
+					atomsWithStabs.push_back(atom);
 					if ( objFile != NULL )
-						filesSeenWithStabs.insert(objFile);
+						filesSeenWithStabs.push_back(objFile);
 				}
 			}
 		}
 	}
+	std::sort(atomsWithStabs.begin(), atomsWithStabs.end());
+	std::sort(filesSeenWithStabs.begin(), filesSeenWithStabs.end());
+	filesSeenWithStabs.erase(std::unique(filesSeenWithStabs.begin(), filesSeenWithStabs.end()), filesSeenWithStabs.end());
+	std::sort(filesWithDwarf.begin(), filesWithDwarf.end());
+	filesWithDwarf.erase(std::unique(filesWithDwarf.begin(), filesWithDwarf.end()), filesWithDwarf.end());
+
+	// object file parsers defer decoding dwarf line tables until now, decode them in parallel
+	if ( !filesWithDwarf.empty() ) {
+		const ld::relocatable::File** dwarfFiles = &filesWithDwarf[0];
+		dispatch_apply(filesWithDwarf.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+			dwarfFiles[index]->loadLineInfo();
+		});
+	}
 	
 	// sort by file ordinal then atom ordinal
 	std::sort(atomsNeedingDebugNotes.begin(), atomsNeedingDebugNotes.end(), DebugNoteSorter());
@@ -7350,9 +7548,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 	}
 
 	// <rdar://66170674> sort .o files into canonical order
-	std::vector<const ld::relocatable::File*> orderedFilesSeen;
-	for (const ld::relocatable::File* obj : filesSeenWithStabs)
-		orderedFilesSeen.push_back(obj);
+	std::vector<const ld::relocatable::File*>& orderedFilesSeen = filesSeenWithStabs;
 	std::sort(orderedFilesSeen.begin(), orderedFilesSeen.end(), [](const ld::relocatable::File* lhs, const ld::relocatable::File* rhs) {
 		return (lhs->ordinal() < rhs->ordinal());
 	});
@@ -7364,7 +7560,7 @@ void OutputFile::synthesizeDebugNotes(ld::Internal& state)
 		if ( filesStabs != NULL ) {
 			for (const ld::relocatable::File::Stab& stab : *filesStabs ) {
 				// ignore stabs associated with atoms that were dead stripped or coalesced away
-				if ( (stab.atom != NULL) && (atomsWithStabs.count(stab.atom) == 0) )
+				if ( (stab.atom != NULL) && !std::binary_search(atomsWithStabs.begin(), atomsWithStabs.end(), stab.atom) )
 					continue;
 				// <rdar://problem/8284718> Value of N_SO stabs should be address of first atom from translation unit
 				if ( (stab.type == N_SO) && (stab.string != NULL) && (stab.string[0] != '\0') ) {
@@ -66,6 +66,15 @@ public:
 	uint32_t					encryptedTextEndOffset()	{ return _encryptedTEXTendOffset; }
 	int							compressedOrdinalForAtom(const ld::Atom* target) const;
 	uint64_t					fileSize() const { return _fileSize; }
+	// atom content bytes written by writeAtoms(), in fixup-free runs and atom by atom
+	uint64_t					contentBytesCopiedInRuns() const { return _contentBytesCopiedInRuns; }
+	uint32_t					contentRunCount() const { return _contentRunCount; }
+	uint64_t					contentBytesCopiedPerAtom() const { return _contentBytesCopiedPerAtom; }
+	// sorts the LINKEDIT tables into the order the encoders need
+	void						sortRebaseInfo();
+	void						sortBindingInfo();
+	void						sortWeakBindingInfo();
+	void						buildThreadedRebaseBindIndices();
 
 	bool						needsBind(const ld::Atom* toTarget, bool authPtr, uint64_t* accumulator = nullptr,
 										  uint64_t* inlineAddend = nullptr, uint32_t* bindOrdinal = nullptr,
@@ -376,6 +385,9 @@ private:
 		  bool								_hasOptimizationHints;
 		  bool								_hasCodeSignature;
 	uint64_t								_fileSize;
+	uint64_t								_contentBytesCopiedInRuns;
+	uint64_t								_contentBytesCopiedPerAtom;
+	uint32_t								_contentRunCount;
 	std::map<uint64_t, uint32_t>			_lazyPointerAddressToInfoOffset;
 	uint32_t								_encryptedTEXTstartOffset;
 	uint32_t								_encryptedTEXTendOffset;
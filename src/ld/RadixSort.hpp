@@ -0,0 +1,240 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __RADIX_SORT_HPP__
+#define __RADIX_SORT_HPP__
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <dispatch/dispatch.h>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ld {
+namespace radix_sort {
+
+//
+// Stable least significant digit radix sort for the big LINKEDIT tables (rebase, bind,
+// threaded fixups), which can hold tens of millions of entries.  Items are reduced to
+// 64-bit keys and sorted up to 8 bits a pass.  Passes only cover bits that differ
+// between keys, so e.g. the high bits of addresses cost nothing.  Each pass histograms
+// and scatters slices of the array in parallel.  To sort by several keys, sort by the
+// least significant one first.
+//
+
+static const size_t kMinSliceSize	= 0x10000;
+static const size_t kMaxSlices		= 32;
+static const unsigned kMaxDigitBits	= 8;
+static const unsigned kMaxBuckets	= 1 << kMaxDigitBits;
+
+//
+// Sorts the indexes 0..count-1 of some table, by one key after another:
+//
+//		Sorter sorter(info.size());
+//		sorter.sortBy([=](uint32_t i) { return info[i].address; });
+//		sorter.sortBy([=](uint32_t i) { return (uint64_t)info[i].type; });
+//		sorter.apply(info);			// now by type, then address
+//
+class Sorter {
+public:
+						Sorter(size_t count);
+
+	// stably reorders the indexes so that keyOf(index) ascends
+	template <typename KeyFunc>
+	void				sortBy(KeyFunc keyOf);
+	// index of the i-th item in sorted order
+	uint32_t			operator[](size_t i) const	{ return _entries[i].index; }
+	size_t				count() const				{ return _count; }
+	// permutes items into sorted order
+	template <typename T>
+	void				apply(std::vector<T>& items) const;
+
+private:
+	struct Entry {
+		uint64_t		key;
+		uint32_t		index;
+	};
+
+	size_t						_count;
+	size_t						_sliceCount;
+	size_t						_sliceSize;
+	std::unique_ptr<Entry[]>	_entries;	// not value initialized, every pass writes all of it
+	std::unique_ptr<Entry[]>	_scratch;
+};
+
+
+inline Sorter::Sorter(size_t count)
+	: _count(count), _sliceCount(std::min(std::max(count / kMinSliceSize, (size_t)1), kMaxSlices)),
+	  _sliceSize((count + _sliceCount - 1) / _sliceCount), _entries(new Entry[count]), _scratch(new Entry[count])
+{
+	assert(count <= UINT32_MAX);
+	for (size_t i=0; i < count; ++i)
+		_entries[i].index = (uint32_t)i;
+}
+
+template <typename KeyFunc>
+void Sorter::sortBy(KeyFunc keyOf)
+{
+	if ( _count < 2 )
+		return;
+	const size_t count = _count;
+	const size_t sliceCount = _sliceCount;
+	const size_t sliceSize = _sliceSize;
+	dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+	std::vector<uint64_t> sliceAnd(sliceCount);
+	std::vector<uint64_t> sliceOr(sliceCount);
+	Entry* src = _entries.get();
+	Entry* dst = _scratch.get();
+	uint64_t* sliceAndArray = sliceAnd.data();
+	uint64_t* sliceOrArray = sliceOr.data();
+
+	// compute keys once, noting which bits differ between them
+	dispatch_apply(sliceCount, queue, ^(size_t s) {
+		uint64_t andBits = ~0ULL;
+		uint64_t orBits = 0;
+		for (size_t i=s*sliceSize, end=std::min(i+sliceSize, count); i < end; ++i) {
+			uint64_t key = keyOf(src[i].index);
+			src[i].key = key;
+			andBits &= key;
+			orBits |= key;
+		}
+		sliceAndArray[s] = andBits;
+		sliceOrArray[s] = orBits;
+	});
+	uint64_t andBits = ~0ULL;
+	uint64_t orBits = 0;
+	for (size_t s=0; s < sliceCount; ++s) {
+		andBits &= sliceAnd[s];
+		orBits |= sliceOr[s];
+	}
+	const uint64_t varyingBits = orBits & ~andBits;
+
+	std::vector<size_t> buckets(sliceCount * kMaxBuckets);
+	size_t* bucketArray = buckets.data();
+	for (unsigned shift=0; shift < 64; ) {
+		// each pass sorts on the next kMaxDigitBits bits, starting at a bit that varies
+		if ( (varyingBits >> shift) == 0 )
+			break;
+		shift += __builtin_ctzll(varyingBits >> shift);
+		const unsigned digitBits = std::min(kMaxDigitBits, 64 - shift);
+		const size_t bucketCount = (size_t)1 << digitBits;
+		const uint64_t digitMask = bucketCount - 1;
+		// count how many keys of each slice fall in each bucket
+		dispatch_apply(sliceCount, queue, ^(size_t s) {
+			size_t* counts = &bucketArray[s * bucketCount];
+			memset(counts, 0, bucketCount * sizeof(size_t));
+			for (size_t i=s*sliceSize, end=std::min(i+sliceSize, count); i < end; ++i)
+				++counts[(src[i].key >> shift) & digitMask];
+		});
+		// turn counts into where each slice starts writing each bucket, slices in order keeps the sort stable
+		size_t offset = 0;
+		for (size_t b=0; b < bucketCount; ++b) {
+			for (size_t s=0; s < sliceCount; ++s) {
+				size_t n = buckets[s * bucketCount + b];
+				buckets[s * bucketCount + b] = offset;
+				offset += n;
+			}
+		}
+		Entry* from = src;
+		Entry* to = dst;
+		dispatch_apply(sliceCount, queue, ^(size_t s) {
+			size_t* offsets = &bucketArray[s * bucketCount];
+			for (size_t i=s*sliceSize, end=std::min(i+sliceSize, count); i < end; ++i)
+				to[offsets[(from[i].key >> shift) & digitMask]++] = from[i];
+		});
+		std::swap(src, dst);
+		shift += digitBits;
+	}
+	if ( src != _entries.get() )
+		_entries.swap(_scratch);
+}
+
+template <typename T>
+void Sorter::apply(std::vector<T>& items) const
+{
+	assert(items.size() == _count);
+	std::vector<T> sorted;
+	sorted.reserve(_count);
+	for (size_t i=0; i < _count; ++i)
+		sorted.push_back(items[_entries[i].index]);
+	items.swap(sorted);
+}
+
+
+// Stably sorts items by a single key
+template <typename T, typename KeyFunc>
+void sort(std::vector<T>& items, KeyFunc keyOf)
+{
+	Sorter sorter(items.size());
+	const T* itemArray = items.data();
+	sorter.sortBy([=](uint32_t index) { return keyOf(itemArray[index]); });
+	sorter.apply(items);
+}
+
+// Sets ranks[i] to the strcmp() rank of nameOf(i), with equal spellings sharing a rank,
+// so sorts by name can compare integers.  Returns the number of distinct ranks.  The
+// names are mostly pointers to the same few strings, so they are deduplicated by
+// address before any string is compared.
+template <typename NameFunc>
+uint32_t rankNames(size_t count, NameFunc nameOf, std::vector<uint32_t>& ranks)
+{
+	std::unordered_map<const char*, uint32_t> nameToUnique;
+	std::vector<const char*> uniqueNames;
+	ranks.resize(count);
+	for (size_t i=0; i < count; ++i) {
+		const char* name = nameOf((uint32_t)i);
+		auto pos = nameToUnique.emplace(name, (uint32_t)uniqueNames.size());
+		if ( pos.second )
+			uniqueNames.push_back(name);
+		ranks[i] = pos.first->second;
+	}
+
+	std::vector<uint32_t> byName(uniqueNames.size());
+	std::iota(byName.begin(), byName.end(), 0);
+	std::sort(byName.begin(), byName.end(), [&](uint32_t a, uint32_t b) {
+		return strcmp(uniqueNames[a], uniqueNames[b]) < 0;
+	});
+	std::vector<uint32_t> uniqueRanks(uniqueNames.size());
+	uint32_t rank = 0;
+	for (size_t i=0; i < byName.size(); ++i) {
+		if ( (i != 0) && (strcmp(uniqueNames[byName[i-1]], uniqueNames[byName[i]]) != 0) )
+			++rank;
+		uniqueRanks[byName[i]] = rank;
+	}
+	for (uint32_t& r : ranks)
+		r = uniqueRanks[r];
+	return uniqueNames.empty() ? 0 : rank + 1;
+}
+
+} // namespace radix_sort
+} // namespace ld
+
+#endif // __RADIX_SORT_HPP__
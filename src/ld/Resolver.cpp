@@ -39,6 +39,7 @@
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 #include <mach-o/fat.h>
+#include <dispatch/dispatch.h>
 
 #include <string>
 #include <map>
@@ -548,6 +549,9 @@ void Resolver::doFile(const ld::File& file)
 				}
 				break;
 		}
+
+		// bind references to symbols seen in earlier files before the atoms are added
+		this->bindKnownReferences(*objFile);
 	}
 	if ( dylibFile != NULL ) {
 		// Check dylib for bitcode, if the library install path is relative path or @rpath, it has to contain bitcode
@@ -889,6 +893,57 @@ void Resolver::convertReferencesToIndirect(const ld::Atom& atom)
 }
 
 
+class AtomCollector : public ld::File::AtomHandler {
+public:
+	virtual void					doAtom(const ld::Atom& atom)	{ atoms.push_back(&atom); }
+	virtual void					doFile(const class ld::File&)	{ }
+
+	std::vector<const ld::Atom*>	atoms;
+};
+
+//
+// Most by-name references in an object file are to symbols that earlier files already put in
+// the symbol table.  Those lookups don't change the table, so they are done here in parallel
+// before the file's atoms are added.  Everything else is left by-name for the serial
+// convertReferencesToIndirect(), which runs in atom order, so new slots are numbered and
+// duplicates are coalesced exactly as if every reference had been bound there.
+//
+void Resolver::bindKnownReferences(const ld::relocatable::File& file)
+{
+	const size_t kAtomsPerChunk = 512;
+	// small files are not worth a parallel pass, so skip them before walking their atoms
+	if ( file.atomCount() < 2*kAtomsPerChunk )
+		return;
+	AtomCollector collector;
+	file.forEachAtom(collector);
+	const size_t atomCount = collector.atoms.size();
+
+	const ld::Atom* const* atoms = &collector.atoms[0];
+	const SymbolTable* symbolTable = &_symbolTable;
+	const bool removeDtraceProbes = (_options.outputKind() != Options::kObjectFile);
+	dispatch_apply((atomCount + kAtomsPerChunk - 1) / kAtomsPerChunk, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunk) {
+		const size_t chunkEnd = std::min(atomCount, (chunk+1)*kAtomsPerChunk);
+		for (size_t i=chunk*kAtomsPerChunk; i < chunkEnd; ++i) {
+			const ld::Atom* atom = atoms[i];
+			// these are hashed by SymbolTable::add() with their references still by-name
+			if ( (atom->combine() == ld::Atom::combineByNameAndContent) || (atom->combine() == ld::Atom::combineByNameAndReferences) )
+				continue;
+			for (ld::Fixup::iterator fit=atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
+				if ( fit->binding != ld::Fixup::bindingByNameUnbound )
+					continue;
+				if ( removeDtraceProbes && isDtraceProbe(fit->kind) )
+					continue;
+				SymbolTable::IndirectBindingSlot slot;
+				if ( symbolTable->findExistingSlotForName(fit->u.name, slot) ) {
+					fit->binding = ld::Fixup::bindingsIndirectlyBound;
+					fit->u.bindingIndex = slot;
+				}
+			}
+		}
+	});
+}
+
+
 void Resolver::addInitialUndefines()
 {
 	// add initial undefines from -u option
@@ -1968,6 +2023,40 @@ void Resolver::buildArchivesList()
 	_inputFiles.archives(_internal);
 }
 
+void Resolver::releaseUnusedArchiveMembers()
+{
+	// with LTO, dead atoms of mach-o members may still be waiting on the optimizer's output
+	if ( _haveLLVMObjs )
+		return;
+	// only archive members can be freed, so the atoms are checked against those alone
+	std::unordered_set<const ld::File*> memberFiles;
+	_inputFiles.parsedArchiveMembers(memberFiles);
+	if ( memberFiles.empty() )
+		return;
+	std::unordered_set<const ld::File*> liveFiles;
+	auto noteLive = [&](const ld::File* file) {
+		if ( memberFiles.count(file) != 0 )
+			liveFiles.insert(file);
+	};
+	for (const ld::Atom* atom : _atoms) {
+		noteLive(atom->file());
+		noteLive(atom->originalFile());
+	}
+	for (const ld::relocatable::File* file : _internal.filesWithBitcode)
+		noteLive(file);
+	for (const ld::relocatable::File* file : _internal.filesFromCompilerRT)
+		noteLive(file);
+	// the map file lists dead stripped symbols by file
+	if ( _options.generatedMapPath() != NULL ) {
+		for (const ld::Atom* atom : _internal.deadAtoms)
+			noteLive(atom->originalFile());
+	}
+	// nothing may point at atoms of a member once it is gone
+	if ( _options.deadCodeStrip() )
+		_symbolTable.removeDeadAtoms();
+	_inputFiles.releaseUnusedArchiveMembers(liveFiles);
+}
+
 void Resolver::dumpAtoms() 
 {
 	fprintf(stderr, "Resolver all atoms:\n");
@@ -2034,6 +2123,7 @@ void Resolver::resolve()
     _symbolTable.checkDuplicateSymbols();
 	this->buildArchivesList();
 	this->checkChainedFixupsBounds();
+	this->releaseUnusedArchiveMembers();
 }
 
 
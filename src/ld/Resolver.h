@@ -60,7 +60,7 @@ class Resolver : public ld::File::AtomHandler
 public:
 							Resolver(const Options& opts, InputFiles& inputs, ld::Internal& state) 
 								: _options(opts), _inputFiles(inputs), _internal(state), 
-								  _symbolTable(opts, state.indirectBindingTable),
+								  _symbolTable(opts, state.indirectBindingTable, inputs.literalPool()),
 								  _haveLLVMObjs(false),
 								  _completedInitialObjectFiles(false),
 								  _ltoCodeGenFinished(false),
@@ -71,6 +71,7 @@ public:
 		virtual void		doFile(const class File&);
 		
 		void				resolve();
+		uint64_t			symbolTableMemoryUsage() const { return _symbolTable.memoryUsage(); }
 
 
 private:
@@ -95,14 +96,16 @@ private:
 	void					fillInEntryPoint();
 	void					linkTimeOptimize();
 	void					convertReferencesToIndirect(const ld::Atom& atom);
+	void					bindKnownReferences(const ld::relocatable::File& file);
 	const ld::Atom*			entryPoint(bool searchArchives);
 	void					markLive(const ld::Atom& atom, WhyLiveBackChain* previous);
-	bool					isDtraceProbe(ld::Fixup::Kind kind);
+	static bool				isDtraceProbe(ld::Fixup::Kind kind);
 	void					liveUndefines(std::vector<const char*>&);
 	void					remainingUndefines(std::vector<const char*>&);
 	bool					printReferencedBy(const char* name, SymbolTable::IndirectBindingSlot slot);
 	void					tweakWeakness();
 	void					buildArchivesList();
+	void					releaseUnusedArchiveMembers();
 	void					doLinkerOption(const std::vector<const char*>& linkerOption, const char* fileName);
 	void					dumpAtoms();
 	void					checkChainedFixupsBounds();
@@ -16,10 +16,14 @@
 #include <sys/stat.h>
 #include <libgen.h>
 #include <time.h>
+#include <copyfile.h>
 #include <Block.h>
+#include <dispatch/dispatch.h>
+#include <CommonCrypto/CommonDigest.h>
 
 #include "Snapshot.h"
 #include "Options.h"
+#include "CacheDirectory.hpp"
 
 #include "compile_stubs.h"
 
@@ -40,9 +44,19 @@ static const char *linkCommandString        = "link_command";       // text file
 static const char *assertFileString         = "assert_info";        // text file containing assertion failure logs
 static const char *compileFileString        = "compile_stubs";      // text file containing compile_stubs script
 
+// Content addressed store of copied inputs, shared by all snapshots in the same location.
+static const char *objectStoreString        = "ld-snapshot-objects";
+// Once a link's copies are done the store is trimmed to this size, least recently used files first.
+static const uint64_t objectStoreMaxSize    = 1024*1024*1024;
+
+// Files still being copied into the snapshot in the background.
+static dispatch_group_t sCopyGroup = NULL;
+// Object store this link added to or reused files from, pruned by waitForCopies().
+static const char *sStoreToPrune = NULL;
+
 Snapshot *Snapshot::globalSnapshot = NULL;
 
-Snapshot::Snapshot(const Options * opts) : fOptions(opts), fRecordArgs(false), fRecordObjects(false), fRecordDylibSymbols(false), fRecordArchiveFiles(false), fRecordUmbrellaFiles(false), fRecordDataFiles(false), fFrameworkArgAdded(false), fRecordKext(false), fSnapshotLocation(NULL), fSnapshotName(NULL), fRootDir(NULL), fFilelistFile(-1), fCopiedArchives(NULL)
+Snapshot::Snapshot(const Options * opts) : fOptions(opts), fRecordArgs(false), fRecordObjects(false), fRecordDylibSymbols(false), fRecordArchiveFiles(false), fRecordUmbrellaFiles(false), fRecordDataFiles(false), fFrameworkArgAdded(false), fRecordKext(false), fSnapshotLocation(NULL), fSnapshotName(NULL), fRootDir(NULL), fObjectStoreDir(NULL), fStoredFileCount(0), fFilelistFile(-1), fCopiedArchives(NULL)
 {
     if (globalSnapshot != NULL)
         throw "only one snapshot supported";
@@ -158,7 +172,8 @@ void Snapshot::buildUniquePath(char *buf, const char *subdir, const char *file)
 {
     buildPath(buf, subdir, file);
     struct stat st;
-    if (!fRecordKext && (stat(buf, &st)==0)) {
+    // files being copied in the background may not exist yet, so check the reserved paths too
+    if (!fRecordKext && ((stat(buf, &st)==0) || (fReservedPaths.count(buf) != 0))) {
         // make it unique
         int counter=1;
         char *number = strrchr(buf, 0);
@@ -166,7 +181,7 @@ void Snapshot::buildUniquePath(char *buf, const char *subdir, const char *file)
         number++;
         do {
             sprintf(number, "%d", counter++);
-        } while (stat(buf, &st) == 0);
+        } while ((stat(buf, &st) == 0) || (fReservedPaths.count(buf) != 0));
     }
 }
 
@@ -204,30 +219,116 @@ void Snapshot::copyFileToSnapshot(const char *sourcePath, const char *subdir, ch
         }
     }
 
-    if (copyBuf == NULL)
-        copyBuf = malloc(copyBufSize);
-    
     char *file=basename((char *)sourcePath);
     char buf[PATH_MAX];
     if (path == NULL) path = buf;
     buildUniquePath(path, subdir, file);
-    mode_t mode = fRecordKext ? (S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) : (S_IRUSR|S_IWUSR);
-    int out_fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, mode);
-    int in_fd = open(sourcePath, O_RDONLY);
-    int len;
-    if (out_fd != -1 && in_fd != -1) {
-        do {
-            len = read(in_fd, copyBuf, copyBufSize);
-            if (len > 0) write(out_fd, copyBuf, len);
-        } while (len == copyBufSize);
+    if (fRecordKext) {
+        // kext snapshots are build products, so they are complete before the link goes on
+        if (copyBuf == NULL)
+            copyBuf = malloc(copyBufSize);
+        mode_t mode = (S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+        int out_fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, mode);
+        int in_fd = open(sourcePath, O_RDONLY);
+        int len;
+        if (out_fd != -1 && in_fd != -1) {
+            do {
+                len = read(in_fd, copyBuf, copyBufSize);
+                if (len > 0) write(out_fd, copyBuf, len);
+            } while (len == copyBufSize);
+        }
+        close(in_fd);
+        close(out_fd);
+    } else {
+        fReservedPaths.insert(path);
+        storeFile(sourcePath, path);
     }
-    close(in_fd);
-    close(out_fd);
 
     const char * relPath = snapshotRelativePath(path);
     memmove(path, relPath, 1+strlen(relPath));
 }
 
+// Builds <storeDir>/<SHA-256 of the file's content> in storePath.
+// Returns false if the file can't be read.
+static bool contentStorePath(const char *sourcePath, const char *storeDir, char *storePath)
+{
+    int fd = open(sourcePath, O_RDONLY);
+    if (fd == -1)
+        return false;
+    CC_SHA256_CTX ctx;
+    CC_SHA256_Init(&ctx);
+    uint8_t buffer[1<<16];
+    ssize_t len;
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+        CC_SHA256_Update(&ctx, buffer, (CC_LONG)len);
+    close(fd);
+    if (len < 0)
+        return false;
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &ctx);
+    char *p = storePath + sprintf(storePath, "%s/", storeDir);
+    for (int i=0; i < CC_SHA256_DIGEST_LENGTH; ++i)
+        p += sprintf(p, "%02x", digest[i]);
+    return true;
+}
+
+// Copy a file to path in the snapshot on a background thread.
+// Each distinct file is stored once in the object store, named by its content, and hard linked
+// into every snapshot that records it.  Stores are cloned from the source when the file system
+// supports it.  If the store can't be used the file is copied straight to path.
+void Snapshot::storeFile(const char *sourcePath, const char *path)
+{
+    if (sCopyGroup == NULL)
+        sCopyGroup = dispatch_group_create();
+    const char *source = strdup(sourcePath);
+    const char *dest = strdup(path);
+    const char *storeDir = fObjectStoreDir;
+    const unsigned storeIndex = fStoredFileCount++;
+    if (storeDir != NULL)
+        sStoreToPrune = storeDir;
+    dispatch_group_async(sCopyGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        const mode_t mode = (S_IRUSR|S_IWUSR);
+        char storePath[PATH_MAX];
+        bool stored = false;
+        if ((storeDir != NULL) && contentStorePath(source, storeDir, storePath)) {
+            struct stat st;
+            stored = (stat(storePath, &st) == 0);
+            if (stored) {
+                // a reuse counts as a use, pruning goes by modification time
+                utimes(storePath, NULL);
+            }
+            else {
+                // copy under a temporary name so other links never see a partial store
+                char tempPath[PATH_MAX];
+                snprintf(tempPath, sizeof(tempPath), "%s.%d.%u", storePath, getpid(), storeIndex);
+                if ((copyfile(source, tempPath, NULL, COPYFILE_CLONE) == 0) && (chmod(tempPath, mode) == 0))
+                    stored = (rename(tempPath, storePath) == 0);
+                if (!stored)
+                    unlink(tempPath);
+            }
+            if (stored)
+                stored = (link(storePath, dest) == 0);
+        }
+        if (!stored) {
+            if (copyfile(source, dest, NULL, COPYFILE_CLONE) == 0)
+                chmod(dest, mode);
+        }
+        ::free((void *)source);
+        ::free((void *)dest);
+    });
+}
+
+void Snapshot::waitForCopies()
+{
+    if (sCopyGroup != NULL)
+        dispatch_group_wait(sCopyGroup, DISPATCH_TIME_FOREVER);
+    if (sStoreToPrune != NULL) {
+        // files already linked into snapshots keep their data, only the store's link goes away
+        ld::cache_directory::prune(sStoreToPrune, objectStoreMaxSize);
+        sStoreToPrune = NULL;
+    }
+}
+
 // Create the snapshot root directory.
 void Snapshot::createSnapshot()
 {
@@ -252,6 +353,13 @@ void Snapshot::createSnapshot()
             setSnapshotMode(SNAPSHOT_DISABLED); // don't try to write anything if we can't create snapshot dir
         }
 
+        if ((fRootDir != NULL) && !fRecordKext) {
+            // one store per user, so hard links never point at files the user can't read
+            snprintf(buf, sizeof(buf), "%s/%s-%d", fSnapshotLocation, objectStoreString, getuid());
+            if ((mkdir(buf, S_IRUSR|S_IWUSR|S_IXUSR) == 0) || (errno == EEXIST))
+                fObjectStoreDir = strdup(buf);
+        }
+
         if (!fRecordKext) {
             buildPath(buf, NULL, compileFileString);
             mode_t mode = fRecordKext ? (S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) : (S_IXUSR|S_IRUSR|S_IWUSR);
@@ -11,6 +11,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "ld.hpp"
@@ -85,6 +87,10 @@ public:
     // Returns the snapshot root directory.
     const char *rootDir() { return fRootDir; }
 
+    // Blocks until the files being copied into the snapshot in the background are written.
+    // Must be called before the linker exits.
+    static void waitForCopies();
+
 private:
 
     friend class SnapshotArchiveFileLog;
@@ -125,6 +131,9 @@ private:
     // Uses buildUniquePath to construct a unique path. If the result path is needed by the caller
     // then a path buffer can be supplied in buf. Otherwise an internal buffer is used.
     void copyFileToSnapshot(const char *sourcePath, const char *subdir, char *buf=NULL);
+
+    // Starts copying sourcePath to path (in the snapshot) through the object store on a background thread.
+    void storeFile(const char *sourcePath, const char *path);
     
     // Convert a full path to snapshot relative by constructing an interior pointer at the right offset.
     const char *snapshotRelativePath(const char *path) { return path+strlen(fRootDir)+1; }
@@ -150,6 +159,8 @@ private:
     const char *fSnapshotName;    // a string to use in constructing the snapshot name
     const char *fOutputPath;    // -o path
     char *fRootDir;             // root directory of the snapshot
+    const char *fObjectStoreDir; // content addressed store the copied files are hard linked from
+    unsigned fStoredFileCount;  // files handed to storeFile(), used to make temporary names unique
     const char *fArchString;
     int fFilelistFile;          // file descriptor to the open text file used for the -filelist
 
@@ -157,6 +168,7 @@ private:
     StringVector fArgs;         // stores the "cooked" command line args
     IntVector fArgIndicies;     // where args start in fArgs
     PathMap fPathMap;           // mapping of original paths->snapshot paths for copied files
+    std::set<std::string> fReservedPaths; // snapshot paths of files still being copied
     
     DylibMap fDylibSymbols;    // map of dylib names to string vector containing referenced symbol names
     StringVector *fCopiedArchives;  // vector of .a files that have been copied to the snapshot
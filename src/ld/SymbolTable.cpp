@@ -59,8 +59,9 @@ namespace tool {
 static ld::IndirectBindingTable*	_s_indirectBindingTable = NULL;
 
 
-SymbolTable::SymbolTable(const Options& opts, std::vector<const ld::Atom*>& ibt) 
-	: _options(opts), _cstringTable(6151), _indirectBindingTable(ibt), _hasExternalTentativeDefinitions(false)
+SymbolTable::SymbolTable(const Options& opts, std::vector<const ld::Atom*>& ibt, ld::LiteralPool& literalPool) 
+	: _options(opts), _literalPool(literalPool), _cstringsPooledByParsers(0), _indirectBindingTable(ibt),
+	  _hasExternalTentativeDefinitions(false)
 {  
 	_s_indirectBindingTable = this;
 }
@@ -85,7 +86,10 @@ size_t SymbolTable::CStringHashFuncs::operator()(const ld::Atom* atom) const
 
 bool SymbolTable::CStringHashFuncs::operator()(const ld::Atom* left, const ld::Atom* right) const
 {
-	return (strcmp((char*)left->rawContentPointer(), (char*)right->rawContentPointer()) == 0);
+	// cstring atoms are sized to include their terminating zero, so different sizes can't match
+	if ( left->size() != right->size() )
+		return false;
+	return (memcmp(left->rawContentPointer(), right->rawContentPointer(), left->size()) == 0);
 }
 
 
@@ -631,6 +635,15 @@ SymbolTable::IndirectBindingSlot SymbolTable::findSlotForName(const char* name)
 	return slot;
 }
 
+bool SymbolTable::findExistingSlotForName(const char* name, IndirectBindingSlot& slot) const
+{
+	NameToSlot::const_iterator pos = _byNameTable.find(name);
+	if ( pos == _byNameTable.end() )
+		return false;
+	slot = pos->second;
+	return true;
+}
+
 void SymbolTable::removeDeadAtoms()
 {
 	// remove dead atoms from: _byNameTable, _byNameReverseTable, and _indirectBindingTable
@@ -663,14 +676,11 @@ void SymbolTable::removeDeadAtoms()
 			++it;
 	}
 
-	// remove dead atoms from _cstringTable
-	for (CStringToSlot::iterator it=_cstringTable.begin(); it != _cstringTable.end(); ) {
-		const ld::Atom* atom = it->first;
-		assert(atom != NULL);
-		if ( !atom->live() && !atom->dontDeadStrip() )
-			it = _cstringTable.erase(it);
-		else
-			++it;
+	// remove dead atoms from _cstringSlots
+	for (std::vector<CStringSlot>::iterator it=_cstringSlots.begin(); it != _cstringSlots.end(); ++it) {
+		const ld::Atom* atom = it->firstAtom;
+		if ( (atom != NULL) && !atom->live() && !atom->dontDeadStrip() )
+			*it = CStringSlot();
 	}
 
 	// remove dead atoms from _utf16Table
@@ -735,13 +745,24 @@ SymbolTable::IndirectBindingSlot SymbolTable::findSlotForContent(const ld::Atom*
 	ContentToSlot::iterator pos;
 	switch ( atom->section().type() ) {
 		case ld::Section::typeCString:
-			cspos = _cstringTable.find(atom);
-			if ( cspos != _cstringTable.end() ) {
-				*existingAtom = _indirectBindingTable[cspos->second];
-				return cspos->second;
+			{
+				// usually a parser thread already put the string in the pool
+				uint32_t poolIndex;
+				if ( atom->literalPoolIndex(poolIndex) )
+					++_cstringsPooledByParsers;
+				else
+					poolIndex = _literalPool.internCString((char*)atom->rawContentPointer());
+				if ( poolIndex >= _cstringSlots.size() )
+					_cstringSlots.resize(_literalPool.count());
+				CStringSlot& entry = _cstringSlots[poolIndex];
+				if ( entry.firstAtom != NULL ) {
+					*existingAtom = _indirectBindingTable[entry.slot];
+					return entry.slot;
+				}
+				slot = _indirectBindingTable.size();
+				entry.firstAtom = atom;
+				entry.slot = slot;
 			}
-			slot = _indirectBindingTable.size();
-			_cstringTable[atom] = slot;
 			break;
 		case ld::Section::typeNonStdCString:
 			{
@@ -939,23 +960,7 @@ void SymbolTable::removeDeadUndefs(std::vector<const ld::Atom*>& allAtoms, const
 
 void SymbolTable::printStatistics()
 {
-//	fprintf(stderr, "cstring table size: %lu, bucket count: %lu, hash func called %u times\n", 
-//				_cstringTable.size(), _cstringTable.bucket_count(), cstringHashCount);
-	int count[11];
-	for(unsigned int b=0; b < 11; ++b) {
-		count[b] = 0;
-	}
-	for(unsigned int i=0; i < _cstringTable.bucket_count(); ++i) {
-		unsigned int n = _cstringTable.bucket_size(i);
-		if ( n < 10 ) 
-			count[n] += 1;
-		else
-			count[10] += 1;
-	}
-	fprintf(stderr, "cstring table distribution\n");
-	for(unsigned int b=0; b < 11; ++b) {
-		fprintf(stderr, "%u buckets have %u elements\n", count[b], b);
-	}
+	fprintf(stderr, "cstring pool size: %u, %u cstrings pooled by parser threads\n", _literalPool.count(), _cstringsPooledByParsers);
 	fprintf(stderr, "indirect table size: %lu\n", _indirectBindingTable.size());
 	fprintf(stderr, "by-name table size: %lu\n", _byNameTable.size());
 //	fprintf(stderr, "by-content table size: %lu, hash count: %u, equals count: %u, lookup count: %u\n", 
@@ -973,6 +978,42 @@ void SymbolTable::printStatistics()
 	
 }
 
+
+// approximate heap use of a node-based table: bucket array, plus per element the value, next pointer and cached hash
+template <typename T>
+static uint64_t hashTableBytes(const T& table)
+{
+	return table.bucket_count()*sizeof(void*) + table.size()*(sizeof(typename T::value_type) + 2*sizeof(void*));
+}
+
+// approximate heap use of a std::map: per element the value, three links and the color
+template <typename T>
+static uint64_t treeBytes(const T& tree)
+{
+	return tree.size()*(sizeof(typename T::value_type) + 4*sizeof(void*));
+}
+
+uint64_t SymbolTable::memoryUsage() const
+{
+	uint64_t result = _indirectBindingTable.capacity()*sizeof(const ld::Atom*);
+	result += hashTableBytes(_byNameTable);
+	result += treeBytes(_byNameReverseTable);
+	result += hashTableBytes(_literal4Table);
+	result += hashTableBytes(_literal8Table);
+	result += hashTableBytes(_literal16Table);
+	result += hashTableBytes(_utf16Table);
+	result += _literalPool.memoryUsage() + _cstringSlots.capacity()*sizeof(CStringSlot);
+	result += hashTableBytes(_nonStdCStringSectionToMap);
+	for (NameToMap::const_iterator it=_nonStdCStringSectionToMap.begin(); it != _nonStdCStringSectionToMap.end(); ++it)
+		result += sizeof(CStringToSlot) + hashTableBytes(*it->second);
+	result += hashTableBytes(_nonLazyPointerTable);
+	result += hashTableBytes(_threadPointerTable);
+	result += hashTableBytes(_cfStringTable);
+	result += hashTableBytes(_objc2ClassRefTable);
+	result += hashTableBytes(_pointerToCStringTable);
+	return result;
+}
+
 } // namespace tool 
 } // namespace ld 
 
@@ -46,6 +46,7 @@
 
 #include "Options.h"
 #include "ld.hpp"
+#include "LiteralPool.hpp"
 
 namespace ld {
 namespace tool {
@@ -80,6 +81,13 @@ private:
 	};
 	typedef std::unordered_map<const ld::Atom*, IndirectBindingSlot, CStringHashFuncs, CStringHashFuncs> CStringToSlot;
 
+	// __cstring atoms are coalesced by their LiteralPool index, firstAtom is NULL for unused indexes
+	struct CStringSlot {
+							CStringSlot() : firstAtom(NULL), slot(0) { }
+		const ld::Atom*		firstAtom;
+		IndirectBindingSlot	slot;
+	};
+
 	class UTF16StringHashFuncs {
 	public:
 		size_t	operator()(const ld::Atom*) const;
@@ -110,10 +118,12 @@ public:
 		std::vector<const ld::Atom*>&	_slotTable;
 	};
 	
-						SymbolTable(const Options& opts, std::vector<const ld::Atom*>& ibt);
+						SymbolTable(const Options& opts, std::vector<const ld::Atom*>& ibt, ld::LiteralPool& literalPool);
 
 	bool				add(const ld::Atom& atom, Options::Treatment duplicates);
 	IndirectBindingSlot	findSlotForName(const char* name);
+	// only reads the table, so it can be called from several threads while nothing is being added
+	bool				findExistingSlotForName(const char* name, IndirectBindingSlot& slot) const;
 	IndirectBindingSlot	findSlotForContent(const ld::Atom* atom, const ld::Atom** existingAtom);
 	IndirectBindingSlot	findSlotForReferences(const ld::Atom* atom, const ld::Atom** existingAtom);
 	const ld::Atom*		atomForSlot(IndirectBindingSlot s)	{ return _indirectBindingTable[s]; }
@@ -127,6 +137,7 @@ public:
 	byNameIterator		begin()								{ return byNameIterator(_byNameTable.begin(),_indirectBindingTable); }
 	byNameIterator		end()								{ return byNameIterator(_byNameTable.end(),_indirectBindingTable); }
 	void				printStatistics();
+	uint64_t			memoryUsage() const;
 	void				removeDeadUndefs(std::vector<const ld::Atom *>& allAtoms, const std::unordered_set<const ld::Atom*>& keep);
 
 	// from ld::IndirectBindingTable
@@ -156,7 +167,9 @@ private:
 	ContentToSlot					_literal8Table;
 	ContentToSlot					_literal16Table;
 	UTF16StringToSlot				_utf16Table;
-	CStringToSlot					_cstringTable;
+	ld::LiteralPool&				_literalPool;
+	std::vector<CStringSlot>		_cstringSlots;
+	uint32_t						_cstringsPooledByParsers;
 	NameToMap						_nonStdCStringSectionToMap;
 	ReferencesToSlot				_nonLazyPointerTable;
 	ReferencesToSlot				_threadPointerTable;
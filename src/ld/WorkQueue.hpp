@@ -0,0 +1,151 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __WORK_QUEUE_HPP__
+#define __WORK_QUEUE_HPP__
+
+#include <stdint.h>
+
+#include <atomic>
+
+
+namespace ld {
+
+//
+// Bounded queue that any number of threads may push to and pop from without taking a
+// lock.  Each cell carries a sequence number that says whether it is ready to be written
+// (sequence == position) or ready to be read (sequence == position+1), so producers and
+// consumers only contend on the cursor they advance.  Items come out in the order their
+// pushes claimed positions.
+//
+template <typename T>
+class WorkQueue
+{
+public:
+							WorkQueue(uint64_t minCapacity);
+							~WorkQueue()		{ delete [] _cells; }
+
+	// returns false if the queue is full
+	bool					push(T value);
+	// returns false if the queue is empty, otherwise the item and the position it was pushed at
+	bool					pop(T& value, uint64_t& position);
+	// item pushed at position, if it is there and has not been popped yet
+	bool					peek(uint64_t position, T& value) const;
+
+private:
+	struct Cell {
+		std::atomic<uint64_t>	sequence;
+		std::atomic<T>			value;
+	};
+
+	Cell*					_cells;
+	uint64_t				_mask;
+	alignas(64) std::atomic<uint64_t>	_tail;		// next position to push to
+	alignas(64) std::atomic<uint64_t>	_head;		// next position to pop from
+};
+
+
+template <typename T>
+WorkQueue<T>::WorkQueue(uint64_t minCapacity)
+	: _tail(0), _head(0)
+{
+	uint64_t capacity = 2;
+	while ( capacity < minCapacity )
+		capacity *= 2;
+	_mask = capacity - 1;
+	_cells = new Cell[capacity];
+	for (uint64_t i=0; i < capacity; ++i)
+		_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool WorkQueue<T>::push(T value)
+{
+	uint64_t position = _tail.load(std::memory_order_relaxed);
+	Cell* cell;
+	for (;;) {
+		cell = &_cells[position & _mask];
+		const int64_t diff = (int64_t)cell->sequence.load(std::memory_order_acquire) - (int64_t)position;
+		if ( diff == 0 ) {
+			if ( _tail.compare_exchange_weak(position, position+1, std::memory_order_relaxed) )
+				break;
+		}
+		else if ( diff < 0 ) {
+			// cell still holds the item from one lap ago
+			return false;
+		}
+		else {
+			// another producer took this position
+			position = _tail.load(std::memory_order_relaxed);
+		}
+	}
+	cell->value.store(value, std::memory_order_relaxed);
+	cell->sequence.store(position+1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+bool WorkQueue<T>::pop(T& value, uint64_t& position)
+{
+	uint64_t pos = _head.load(std::memory_order_relaxed);
+	Cell* cell;
+	for (;;) {
+		cell = &_cells[pos & _mask];
+		const int64_t diff = (int64_t)cell->sequence.load(std::memory_order_acquire) - (int64_t)(pos+1);
+		if ( diff == 0 ) {
+			if ( _head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed) )
+				break;
+		}
+		else if ( diff < 0 ) {
+			// nothing pushed at this position yet
+			return false;
+		}
+		else {
+			// another consumer took this position
+			pos = _head.load(std::memory_order_relaxed);
+		}
+	}
+	value = cell->value.load(std::memory_order_relaxed);
+	// make the cell writable for the push one lap from now
+	cell->sequence.store(pos+_mask+1, std::memory_order_release);
+	position = pos;
+	return true;
+}
+
+template <typename T>
+bool WorkQueue<T>::peek(uint64_t position, T& value) const
+{
+	const Cell& cell = _cells[position & _mask];
+	if ( cell.sequence.load(std::memory_order_acquire) != position+1 )
+		return false;
+	value = cell.value.load(std::memory_order_relaxed);
+	// if the item was popped and the cell reused while reading, the value may be from a later push
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return ( cell.sequence.load(std::memory_order_relaxed) == position+1 );
+}
+
+
+} // namespace ld
+
+#endif // __WORK_QUEUE_HPP__
@@ -42,10 +42,14 @@ extern "C" double log2 ( double );
 #include <mach/vm_statistics.h>
 #include <mach/mach_init.h>
 #include <mach/mach_host.h>
+#include <mach/task.h>
+#include <mach/task_info.h>
+#include <malloc/malloc.h>
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 #include <dlfcn.h>
 #include <AvailabilityMacros.h>
+#include <dispatch/dispatch.h>
 
 #include <string>
 #include <map>
@@ -54,6 +58,7 @@ extern "C" double log2 ( double );
 #include <vector>
 #include <list>
 #include <algorithm>
+#include <atomic>
 #include <unordered_map>
 #include <cxxabi.h>
 
@@ -84,16 +89,25 @@ extern "C" double log2 ( double );
 #include "passes/dylibs.h"
 #include "passes/bitcode_bundle.h"
 #include "passes/code_dedup.h"
+#include "passes/cstring_tail_merge.h"
 
 #include "parsers/archive_file.h"
 #include "parsers/macho_relocatable_file.h"
 #include "parsers/macho_dylib_file.h"
 #include "parsers/lto_file.h"
 #include "parsers/opaque_section_file.h"
+#include "parsers/textstub_dylib_file.hpp"
 
 
 const ld::VersionSet ld::File::_platforms;
 
+struct MemoryInfo {
+	uint64_t						resident;
+	uint64_t						residentPeak;		// highest resident size of the process so far, not of the phase
+	uint64_t						phaseResidentPeak;	// highest resident size since the previous sample
+	uint64_t						mallocInUse;
+};
+
 struct PerformanceStatistics {
 	uint64_t						startTool;
 	uint64_t						startInputFileProcessing;
@@ -104,6 +118,25 @@ struct PerformanceStatistics {
 	uint64_t						startDone;
 	vm_statistics_data_t			vmStart;
 	vm_statistics_data_t			vmEnd;
+	// memory sampled at the same points as the start times above
+	MemoryInfo						memStartInputFileProcessing;
+	MemoryInfo						memStartResolver;
+	MemoryInfo						memStartDylibs;
+	MemoryInfo						memStartPasses;
+	MemoryInfo						memStartOutput;
+	MemoryInfo						memDone;
+};
+
+// bytes held at the end of the link, by which part of the linker owns them, plus the output image
+struct MemoryByOwner {
+	uint64_t						parsedAtoms;
+	uint64_t						fixups;
+	uint64_t						unwindAndLineInfo;
+	uint64_t						symbolTable;
+	uint64_t						sections;
+	uint64_t						passAtoms;			// lower bound, each pass atom class has its own size
+	uint64_t						linkEdit;
+	uint64_t						outputBuffer;		// while the output is written, not at the end of the link
 };
 
 
@@ -1477,6 +1510,166 @@ static void getVMInfo(vm_statistics_data_t& info)
 	}
 }
 
+// The kernel only keeps a high-water mark for the whole process.  So that each phase gets a
+// peak of its own, a timer samples the resident size while statistics are gathered, and every
+// getMemoryInfo() takes the highest sample since the previous one.
+static std::atomic<uint64_t>	sResidentPeakSinceLastSample(0);
+static uint64_t					sProcessPeakAtLastSample = 0;
+static dispatch_source_t		sResidentSampler = NULL;
+
+static void getResident(uint64_t& resident, uint64_t& residentPeak)
+{
+	task_vm_info_data_t vmInfo;
+	mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+	if ( task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&vmInfo, &count) == KERN_SUCCESS ) {
+		resident = vmInfo.resident_size;
+		residentPeak = vmInfo.resident_size_peak;
+	}
+	else {
+		resident = 0;
+		residentPeak = 0;
+	}
+}
+
+static void startResidentSampling()
+{
+	sResidentSampler = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
+	if ( sResidentSampler == NULL )
+		return;
+	dispatch_source_set_timer(sResidentSampler, DISPATCH_TIME_NOW, NSEC_PER_MSEC, NSEC_PER_MSEC/4);
+	dispatch_source_set_event_handler(sResidentSampler, ^{
+		uint64_t resident, residentPeak;
+		getResident(resident, residentPeak);
+		uint64_t seen = sResidentPeakSinceLastSample.load();
+		while ( (resident > seen) && !sResidentPeakSinceLastSample.compare_exchange_weak(seen, resident) )
+			;
+	});
+	dispatch_resume(sResidentSampler);
+}
+
+static void stopResidentSampling()
+{
+	if ( sResidentSampler != NULL ) {
+		dispatch_source_cancel(sResidentSampler);
+		dispatch_release(sResidentSampler);
+		sResidentSampler = NULL;
+	}
+}
+
+static void getMemoryInfo(MemoryInfo& info)
+{
+	getResident(info.resident, info.residentPeak);
+	// a phase that raised the process peak reached exactly that, otherwise use the highest sample
+	info.phaseResidentPeak = std::max(sResidentPeakSinceLastSample.exchange(info.resident), info.resident);
+	if ( info.residentPeak > sProcessPeakAtLastSample )
+		info.phaseResidentPeak = info.residentPeak;
+	sProcessPeakAtLastSample = info.residentPeak;
+	malloc_statistics_t mallocStats;
+	malloc_zone_statistics(NULL, &mallocStats);
+	info.mallocInUse = mallocStats.size_in_use;
+}
+
+static void getMemoryByOwner(const ld::Internal& state, const ld::tool::Resolver& resolver, const ld::tool::OutputFile& out, MemoryByOwner& usage)
+{
+	mach_o::relocatable::memoryCounts(usage.parsedAtoms, usage.fixups, usage.unwindAndLineInfo);
+	usage.symbolTable = resolver.symbolTableMemoryUsage();
+	usage.sections = 0;
+	usage.passAtoms = 0;
+	usage.linkEdit = 0;
+	for (const ld::Internal::FinalSection* sect : state.sections) {
+		usage.sections += sizeof(ld::Internal::FinalSection) + sect->atoms.capacity()*sizeof(const ld::Atom*);
+		const bool isLinkEdit = (strcmp(sect->segmentName(), "__LINKEDIT") == 0);
+		for (const ld::Atom* atom : sect->atoms) {
+			if ( isLinkEdit ) {
+				// LINKEDIT atoms hold their encoded content until the output file is written
+				usage.linkEdit += atom->size();
+			}
+			else if ( atom->file() == NULL ) {
+				// atoms synthesized by passes have no file
+				usage.passAtoms += sizeof(ld::Atom);
+				for (ld::Fixup::iterator fit = atom->fixupsBegin(); fit != atom->fixupsEnd(); ++fit)
+					usage.passAtoms += sizeof(ld::Fixup);
+			}
+		}
+	}
+	usage.outputBuffer = out.fileSize();
+}
+
+static void printMemory(const char* msg, const MemoryInfo& info)
+{
+	char resident[40];
+	char phaseResidentPeak[40];
+	char residentPeak[40];
+	char mallocInUse[40];
+	fprintf(stderr, "%24s: resident %15s, phase peak %15s, peak so far %15s, malloc'ed %15s bytes\n", msg, commatize(info.resident, resident),
+			commatize(info.phaseResidentPeak, phaseResidentPeak), commatize(info.residentPeak, residentPeak), commatize(info.mallocInUse, mallocInUse));
+}
+
+static void printOwner(const char* msg, uint64_t bytes)
+{
+	char temp[40];
+	fprintf(stderr, "%24s: %15s bytes\n", msg, commatize(bytes, temp));
+}
+
+struct PhaseStatistics {
+	const char*						name;
+	uint64_t						time;
+	const MemoryInfo*				memoryAtEnd;
+};
+
+static void writeStatisticsJSON(const char* path, const PhaseStatistics phases[], unsigned phaseCount,
+								const PerformanceStatistics& statistics, const MemoryByOwner& usage,
+								const ld::tool::InputFiles& inputFiles, uint64_t outputSize)
+{
+	FILE* file = fopen(path, "w");
+	if ( file == NULL ) {
+		warning("could not write statistics to %s: %s", path, strerror(errno));
+		return;
+	}
+	struct mach_timebase_info timeBaseInfo;
+	if ( mach_timebase_info(&timeBaseInfo) != KERN_SUCCESS ) {
+		timeBaseInfo.numer = 1;
+		timeBaseInfo.denom = 1;
+	}
+	fprintf(file, "{\n  \"phases\": [\n");
+	for (unsigned i=0; i < phaseCount; ++i) {
+		const PhaseStatistics& phase = phases[i];
+		const double seconds = (double)phase.time * timeBaseInfo.numer / timeBaseInfo.denom / 1000000000.0;
+		fprintf(file, "    { \"name\": \"%s\", \"seconds\": %.6f, \"resident\": %llu, \"resident_peak\": %llu, \"resident_peak_so_far\": %llu, \"malloc_in_use\": %llu }%s\n",
+				phase.name, seconds, phase.memoryAtEnd->resident, phase.memoryAtEnd->phaseResidentPeak, phase.memoryAtEnd->residentPeak, phase.memoryAtEnd->mallocInUse,
+				(i+1 < phaseCount) ? "," : "");
+	}
+	fprintf(file, "  ],\n");
+	fprintf(file, "  \"memory_by_owner\": { \"parsed_atoms\": %llu, \"fixups\": %llu, \"unwind_and_line_info\": %llu, "
+				  "\"symbol_table\": %llu, \"sections\": %llu, \"pass_atoms\": %llu, \"linkedit\": %llu },\n",
+			usage.parsedAtoms, usage.fixups, usage.unwindAndLineInfo, usage.symbolTable, usage.sections,
+			usage.passAtoms, usage.linkEdit);
+	fprintf(file, "  \"output_buffer_while_writing\": %llu,\n", usage.outputBuffer);
+	fprintf(file, "  \"pageins\": %u, \"pageouts\": %u, \"faults\": %u,\n",
+			statistics.vmEnd.pageins-statistics.vmStart.pageins,
+			statistics.vmEnd.pageouts-statistics.vmStart.pageouts,
+			statistics.vmEnd.faults-statistics.vmStart.faults);
+	fprintf(file, "  \"object_files\": %u, \"object_bytes\": %lld, \"archive_files\": %u, \"archive_bytes\": %lld, \"dylib_files\": %u,\n",
+			inputFiles._totalObjectLoaded, inputFiles._totalObjectSize, inputFiles._totalArchivesLoaded,
+			inputFiles._totalArchiveSize, inputFiles._totalDylibsLoaded);
+	const std::vector<ld::tool::InputFiles::ParseWorkerStatistics> workers = inputFiles.parseWorkerStatistics();
+	fprintf(file, "  \"parse_workers\": [\n");
+	for (size_t i=0; i < workers.size(); ++i) {
+		fprintf(file, "    { \"files\": %u, \"parse_seconds\": %.6f, \"idle_seconds\": %.6f }%s\n", workers[i].filesParsed,
+				(double)workers[i].parseTime * timeBaseInfo.numer / timeBaseInfo.denom / 1000000000.0,
+				(double)workers[i].idleTime * timeBaseInfo.numer / timeBaseInfo.denom / 1000000000.0,
+				(i+1 < workers.size()) ? "," : "");
+	}
+	fprintf(file, "  ],\n");
+	uint32_t cacheHits, cacheMisses;
+	uint64_t cacheTime;
+	mach_o::relocatable::parseCacheCounts(cacheHits, cacheMisses, cacheTime);
+	fprintf(file, "  \"object_parse_cache\": { \"hits\": %u, \"misses\": %u, \"seconds\": %.6f },\n", cacheHits, cacheMisses,
+			(double)cacheTime * timeBaseInfo.numer / timeBaseInfo.denom / 1000000000.0);
+	fprintf(file, "  \"output_bytes\": %llu\n}\n", outputSize);
+	fclose(file);
+}
+
 
 
 
@@ -1497,8 +1690,11 @@ int main(int argc, const char* argv[])
 			lto::set_library(dylib);
 		
 		// gather vm stats
-		if ( options.printStatistics() )
+		const bool gatherStatistics = ( options.printStatistics() || (options.statisticsJSONPath() != NULL) );
+		if ( gatherStatistics ) {
 			getVMInfo(statistics.vmStart);
+			startResidentSampling();
+		}
 
 		// update strings for error messages
 		showArch = options.printArchPrefix();
@@ -1506,15 +1702,21 @@ int main(int argc, const char* argv[])
 		
 		// open and parse input files
 		statistics.startInputFileProcessing = mach_absolute_time();
+		if ( gatherStatistics )
+			getMemoryInfo(statistics.memStartInputFileProcessing);
 		ld::tool::InputFiles inputFiles(options);
 		
 		// load and resolve all references
 		statistics.startResolver = mach_absolute_time();
+		if ( gatherStatistics )
+			getMemoryInfo(statistics.memStartResolver);
 		ld::tool::Resolver resolver(options, inputFiles, state);
 		resolver.resolve();
         
 		// add dylibs used
 		statistics.startDylibs = mach_absolute_time();
+		if ( gatherStatistics )
+			getMemoryInfo(statistics.memStartDylibs);
 		inputFiles.dylibs(state);
 	
 		// do initial section sorting so passes have rough idea of the layout
@@ -1522,6 +1724,8 @@ int main(int argc, const char* argv[])
 
 		// run passes
 		statistics.startPasses = mach_absolute_time();
+		if ( gatherStatistics )
+			getMemoryInfo(statistics.memStartPasses);
 		ld::passes::objc::doPass(options, state);
 		ld::passes::stubs::doPass(options, state);
 		ld::passes::inits::doPass(options, state);
@@ -1533,6 +1737,7 @@ int main(int argc, const char* argv[])
 		ld::passes::order::doPass(options, state);
 		state.markAtomsOrdered();
 		ld::passes::dedup::doPass(options, state);
+		ld::passes::cstring_tail_merge::doPass(options, state);	// must be after order pass
 		ld::passes::branch_shim::doPass(options, state);	// must be after stubs
 		ld::passes::branch_island::doPass(options, state);	// must be after stubs and order pass
 		ld::passes::dtrace::doPass(options, state);
@@ -1550,31 +1755,96 @@ int main(int argc, const char* argv[])
 
 		// write output file
 		statistics.startOutput = mach_absolute_time();
+		if ( gatherStatistics )
+			getMemoryInfo(statistics.memStartOutput);
 		ld::tool::OutputFile out(options, state);
 		out.write(state);
 		statistics.startDone = mach_absolute_time();
+		if ( gatherStatistics ) {
+			getMemoryInfo(statistics.memDone);
+			stopResidentSampling();
+		}
 		
 		// print statistics
 		//mach_o::relocatable::printCounts();
-		if ( options.printStatistics() ) {
+		if ( gatherStatistics ) {
 			getVMInfo(statistics.vmEnd);
-			uint64_t totalTime = statistics.startDone - statistics.startTool;
-			printTime("ld total time", totalTime, totalTime);
-			printTime(" option parsing time", statistics.startInputFileProcessing  -	statistics.startTool,				totalTime);
-			printTime(" object file processing", statistics.startResolver			 -	statistics.startInputFileProcessing,totalTime);
-			printTime(" resolve symbols", statistics.startDylibs				 -	statistics.startResolver,			totalTime);
-			printTime(" build atom list", statistics.startPasses				 -	statistics.startDylibs,				totalTime);
-			printTime(" passess", statistics.startOutput				 -	statistics.startPasses,				totalTime);
-			printTime(" write output", statistics.startDone				 -	statistics.startOutput,				totalTime);
-			fprintf(stderr, "pageins=%u, pageouts=%u, faults=%u\n", 
-								statistics.vmEnd.pageins-statistics.vmStart.pageins,
-								statistics.vmEnd.pageouts-statistics.vmStart.pageouts, 
-								statistics.vmEnd.faults-statistics.vmStart.faults);
-			char temp[40];
-			fprintf(stderr, "processed %3u object files,  totaling %15s bytes\n", inputFiles._totalObjectLoaded, commatize(inputFiles._totalObjectSize, temp));
-			fprintf(stderr, "processed %3u archive files, totaling %15s bytes\n", inputFiles._totalArchivesLoaded, commatize(inputFiles._totalArchiveSize, temp));
-			fprintf(stderr, "processed %3u dylib files\n", inputFiles._totalDylibsLoaded);
-			fprintf(stderr, "wrote output file            totaling %15s bytes\n", commatize(out.fileSize(), temp));
+			MemoryByOwner usage;
+			getMemoryByOwner(state, resolver, out, usage);
+			const PhaseStatistics phases[] = {
+				{ "option parsing",				statistics.startInputFileProcessing - statistics.startTool,					&statistics.memStartInputFileProcessing },
+				{ "object file processing",		statistics.startResolver			- statistics.startInputFileProcessing,	&statistics.memStartResolver },
+				{ "resolve symbols",			statistics.startDylibs				- statistics.startResolver,				&statistics.memStartDylibs },
+				{ "build atom list",			statistics.startPasses				- statistics.startDylibs,				&statistics.memStartPasses },
+				{ "passes",						statistics.startOutput				- statistics.startPasses,				&statistics.memStartOutput },
+				{ "write output",				statistics.startDone				- statistics.startOutput,				&statistics.memDone },
+			};
+			const unsigned phaseCount = sizeof(phases)/sizeof(phases[0]);
+			if ( options.printStatistics() ) {
+				uint64_t totalTime = statistics.startDone - statistics.startTool;
+				printTime("ld total time", totalTime, totalTime);
+				printTime(" option parsing time", statistics.startInputFileProcessing  -	statistics.startTool,				totalTime);
+				printTime(" object file processing", statistics.startResolver			 -	statistics.startInputFileProcessing,totalTime);
+				printTime(" resolve symbols", statistics.startDylibs				 -	statistics.startResolver,			totalTime);
+				printTime(" build atom list", statistics.startPasses				 -	statistics.startDylibs,				totalTime);
+				printTime(" passess", statistics.startOutput				 -	statistics.startPasses,				totalTime);
+				printTime(" write output", statistics.startDone				 -	statistics.startOutput,				totalTime);
+				fprintf(stderr, "pageins=%u, pageouts=%u, faults=%u\n", 
+									statistics.vmEnd.pageins-statistics.vmStart.pageins,
+									statistics.vmEnd.pageouts-statistics.vmStart.pageouts, 
+									statistics.vmEnd.faults-statistics.vmStart.faults);
+				fprintf(stderr, "memory at end of phase:\n");
+				for (const PhaseStatistics& phase : phases)
+					printMemory(phase.name, *phase.memoryAtEnd);
+				fprintf(stderr, "memory held at end of link:\n");
+				printOwner("parsed atoms", usage.parsedAtoms);
+				printOwner("fixups", usage.fixups);
+				printOwner("unwind and line info", usage.unwindAndLineInfo);
+				printOwner("symbol table", usage.symbolTable);
+				printOwner("final sections", usage.sections);
+				printOwner("pass atoms (at least)", usage.passAtoms);
+				printOwner("LINKEDIT content", usage.linkEdit);
+				fprintf(stderr, "memory used while writing output:\n");
+				printOwner("output image", usage.outputBuffer);
+				char temp[40];
+				fprintf(stderr, "processed %3u object files,  totaling %15s bytes\n", inputFiles._totalObjectLoaded, commatize(inputFiles._totalObjectSize, temp));
+				fprintf(stderr, "processed %3u archive files, totaling %15s bytes\n", inputFiles._totalArchivesLoaded, commatize(inputFiles._totalArchiveSize, temp));
+				fprintf(stderr, "released %3u archive members,  dropped %15s bytes\n", inputFiles._totalArchiveMembersReleased, commatize(inputFiles._totalArchiveBytesReleased, temp));
+				fprintf(stderr, "processed %3u dylib files\n", inputFiles._totalDylibsLoaded);
+				const std::vector<ld::tool::InputFiles::ParseWorkerStatistics> workers = inputFiles.parseWorkerStatistics();
+				for (size_t i=0; i < workers.size(); ++i) {
+					char workerName[40];
+					snprintf(workerName, sizeof(workerName), "worker %lu parsed %u files", i, workers[i].filesParsed);
+					printTime(workerName, workers[i].parseTime, totalTime);
+					printTime(" and was idle", workers[i].idleTime, totalTime);
+				}
+				uint32_t probes, ruledOut, directoriesListed;
+				options.searchProbeCounts(probes, ruledOut, directoriesListed);
+				fprintf(stderr, "library search: %u probes, %u ruled out by listing %u search directories\n", probes, ruledOut, directoriesListed);
+				if ( options.objectParseCachePath() != NULL ) {
+					uint32_t hits, misses;
+					uint64_t cacheTime;
+					mach_o::relocatable::parseCacheCounts(hits, misses, cacheTime);
+					fprintf(stderr, "object parse cache: %u hits, %u misses\n", hits, misses);
+					printTime(" parse cache keys and entries", cacheTime, totalTime);
+				}
+				if ( options.tbdCachePath() != NULL ) {
+					uint32_t hits, misses;
+					textstub::dylib::cacheCounts(hits, misses);
+					fprintf(stderr, "tbd cache: %u hits, %u misses\n", hits, misses);
+				}
+				fprintf(stderr, "wrote output file            totaling %15s bytes\n", commatize(out.fileSize(), temp));
+				fprintf(stderr, "copied atom content          totaling %15s bytes", commatize(out.contentBytesCopiedInRuns(), temp));
+				fprintf(stderr, " in %u fixup-free runs,", out.contentRunCount());
+				fprintf(stderr, " %s bytes atom by atom\n", commatize(out.contentBytesCopiedPerAtom(), temp));
+			}
+			if ( options.statisticsJSONPath() != NULL )
+				writeStatisticsJSON(options.statisticsJSONPath(), phases, phaseCount, statistics, usage, inputFiles, out.fileSize());
+		}
+		if ( options.traceDylibSearching() ) {
+			uint32_t probes, ruledOut, directoriesListed;
+			options.searchProbeCounts(probes, ruledOut, directoriesListed);
+			printf("[Logging for XBS] library search: %u probes, %u ruled out by listing %u search directories\n", probes, ruledOut, directoriesListed);
 		}
 		// <rdar://problem/6780050> Would like linker warning to be build error.
 		if ( options.errorBecauseOfWarnings() ) {
@@ -1583,6 +1853,7 @@ int main(int argc, const char* argv[])
 		}
 		// <rdar://problem/61228255> need to flush stdout since we skipping some clean up in calling _exit()
 		fflush(stdout);
+		Snapshot::waitForCopies();
 
 		// <rdar://problem/55031993> don't run terminators until all we can guarantee all threads are stopped
 		// <rdar://problem/56200095> don't run C++ destructors of stack objects to gain 5% linking perf win
@@ -1595,6 +1866,7 @@ int main(int argc, const char* argv[])
 			fprintf(stderr, "ld: %s for architecture %s\n", msg, archName);
 		else
 			fprintf(stderr, "ld: %s\n", msg);
+		Snapshot::waitForCopies();
 		// <rdar://50510752> exit but don't run termination routines
 		_exit(1);
 	}
@@ -1629,6 +1901,7 @@ void __assert_rtn(const char* func, const char* file, int line, const char* fail
 		fprintf(stderr, "%d  %p  %s + %ld\n", i, callStack[i], symboName, offset);
 		snapshot->recordAssertionMessage("%d  %p  %s + %ld\n", i, callStack[i], symboName, offset);
 	}
+    Snapshot::waitForCopies();
     fprintf(stderr, "A linker snapshot was created at:\n\t%s\n", snapshot->rootDir());
 	fprintf(stderr, "ld: Assertion failed: (%s), function %s, file %s, line %d.\n", failedexpr, func, file, line);
 	_exit(1);
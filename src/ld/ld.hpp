@@ -27,6 +27,7 @@
 #define __LD_HPP__
 
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <unistd.h>
 #include <assert.h>
@@ -403,6 +404,9 @@ namespace relocatable {
 	//
 	// stabs() lazily creates a vector of Stab objects for each atom
 	//
+	// loadLineInfo() fills in the LineInfo of each atom, which is only needed for debug notes
+	// so parsers may defer it.  It may be called for different files concurrently.
+	//
 	// canScatterAtoms() true for all compiler generated code.  Hand written assembly can opt-in
 	// via .subsections_via_symbols directive.  When true it means the linker can break up section
 	// content at symbol boundaries and do optimizations like coalescing, dead code stripping, or
@@ -434,6 +438,9 @@ namespace relocatable {
 		virtual const char*					debugInfoPath() const { return path(); }
 		virtual time_t						debugInfoModificationTime() const { return modificationTime(); }
 		virtual const std::vector<Stab>*	stabs() const = 0;
+		virtual void						loadLineInfo() const { }
+		// number of atoms forEachAtom() delivers, or 0 if not known without walking them
+		virtual uint32_t					atomCount() const { return 0; }
 		virtual bool						canScatterAtoms() const = 0;
 		virtual bool						hasLongBranchStubs()		{ return false; }
 		virtual bool						hasllvmProfiling() const    { return false; }
@@ -513,6 +520,10 @@ namespace dylib {
 		virtual void						forEachExportedSymbol(void (^handler)(const char* symbolName, bool weakDef)) const = 0;
 		virtual bool						hasReExportedDependentsThatProvidedExportAtom() const { return false; }
 		virtual bool						isUnzipperedTwin() const { return false; }
+		// install paths processIndirectLibraries() will pass to findDylib(), in order, so they can be loaded ahead of time
+		virtual void						forEachIndirectDylibToFind(void (^handler)(const char* installPath)) const { }
+		// install paths whose interfaces processIndirectLibraries() registers inline, instead of them being found on disk
+		virtual void						forEachInlinedDylib(void (^handler)(const char* installPath)) const { }
 
 	public:
 		const char*							_dylibInstallPath;
@@ -545,6 +556,11 @@ namespace archive {
 												: ld::File(pth, modTime, ord, Archive) { }
 		virtual								~File() {}
 		virtual bool						justInTimeDataOnlyforEachAtom(const char* name, AtomHandler&) const = 0;
+		// once symbols are resolved, frees parsed members that no file in liveFiles came from and drops their pages
+		virtual void						releaseUnusedMembers(const std::unordered_set<const ld::File*>& liveFiles,
+																 uint32_t& memberCount, uint64_t& byteCount) const { }
+		// members parsed so far that releaseUnusedMembers() could free
+		virtual void						forEachParsedMember(void (^handler)(const ld::File* member)) const { }
 	};
 } // namespace archive 
 
@@ -1175,6 +1191,7 @@ public:
 	virtual void							copyRawContent(uint8_t buffer[]) const = 0;
 	virtual const uint8_t*					rawContentPointer() const { return NULL; }
 	virtual unsigned long					contentHash(const class IndirectBindingTable&) const { return 0; }
+	virtual bool							literalPoolIndex(uint32_t& index) const { return false; }
 	virtual bool							canCoalesceWith(const Atom& rhs, const class IndirectBindingTable&) const { return false; }
 	virtual Fixup::iterator					fixupsBegin() const	{ return NULL; }
 	virtual Fixup::iterator					fixupsEnd() const	{ return NULL; }
@@ -1256,13 +1273,76 @@ public:
 
 
 
+// Content hashing used for coalescing literals and for c-string keyed tables.
+// Strings are consumed eight bytes at a time, and the length falls out of finding
+// the terminating zero, so callers get it for free for a length-first compare.
+// Hash values are only meaningful within one process.
+inline uint64_t hashMix(uint64_t hash, uint64_t word)
+{
+	return (((hash << 5) | (hash >> 59)) ^ word) * 0x517CC1B727220A95ULL;
+}
+
+inline size_t hashFinish(uint64_t hash, size_t length)
+{
+	hash = hashMix(hash, length);
+	return (size_t)(hash ^ (hash >> 32));
+}
+
+inline size_t hashBytes(const void* content, size_t length, uint64_t seed=0)
+{
+	const uint8_t* p = (uint8_t*)content;
+	const uint8_t* const end = p + length;
+	uint64_t hash = seed;
+	uint64_t word;
+	for ( ; (size_t)(end - p) >= sizeof(word); p += sizeof(word)) {
+		memcpy(&word, p, sizeof(word));
+		hash = hashMix(hash, word);
+	}
+	if ( p != end ) {
+		word = 0;
+		memcpy(&word, p, end - p);
+		hash = hashMix(hash, word);
+	}
+	return hashFinish(hash, length);
+}
+
+inline size_t hashCString(const char* str, size_t& length, uint64_t seed=0)
+{
+	const char* s = str;
+	uint64_t hash = seed;
+	uint64_t word;
+	for (;;) {
+		// a whole word is only read if that cannot run off the page the string ends on
+		if ( (((uintptr_t)s) & 4095) <= (4096 - sizeof(word)) ) {
+			memcpy(&word, s, sizeof(word));
+			if ( ((word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL) == 0 ) {
+				hash = hashMix(hash, word);
+				s += sizeof(word);
+				continue;
+			}
+		}
+		// word holding the terminating zero (or near a page end), copy up to the zero
+		uint8_t bytes[sizeof(word)] = { 0 };
+		size_t n = 0;
+		while ( (n < sizeof(word)) && (s[n] != '\0') ) {
+			bytes[n] = s[n];
+			++n;
+		}
+		memcpy(&word, bytes, sizeof(word));
+		hash = hashMix(hash, word);
+		s += n;
+		if ( n < sizeof(word) )
+			break;
+	}
+	length = s - str;
+	return hashFinish(hash, length);
+}
+
 // utility classes for using std::unordered_map with c-strings
 struct CStringHash {
 	size_t operator()(const char* __s) const {
-		size_t __h = 0;
-		for ( ; *__s; ++__s)
-			__h = 5 * __h + *__s;
-		return __h;
+		size_t __len;
+		return hashCString(__s, __len);
 	};
 };
 struct CStringEquals
@@ -26,6 +26,7 @@
 #include <math.h>
 #include <unistd.h>
 #include <sys/param.h>
+#include <sys/mman.h>
 #include <mach-o/ranlib.h>
 #include <ar.h>
 
@@ -86,6 +87,9 @@ public:
 	
 	// overrides of ld::archive::File
 	virtual bool										justInTimeDataOnlyforEachAtom(const char* name, ld::File::AtomHandler& handler) const;
+	virtual void										releaseUnusedMembers(const std::unordered_set<const ld::File*>& liveFiles,
+																			 uint32_t& memberCount, uint64_t& byteCount) const;
+	virtual void										forEachParsedMember(void (^handler)(const ld::File* member)) const;
 
 private:
 	friend bool isArchiveFile(const uint8_t* fileContent, uint64_t fileLength, ld::Platform* platform, const char** archiveArchName);
@@ -110,7 +114,7 @@ private:
 
 	};
 
-	struct MemberState { ld::relocatable::File* file; const Entry *entry; bool logged; bool loaded; uint32_t index;};
+	struct MemberState { ld::relocatable::File* file; const Entry *entry; bool logged; bool loaded; bool bitcode; uint32_t index;};
 	bool											loadMember(MemberState& state, ld::File::AtomHandler& handler, const char *format, ...) const;
 
 	typedef std::unordered_map<const char*, uint64_t, ld::CStringHash, ld::CStringEquals> NameToOffsetMap;
@@ -118,8 +122,7 @@ private:
 	typedef typename A::P							P;
 	typedef typename A::P::E						E;
 
-	typedef std::map<const class Entry*, MemberState> MemberToStateMap;
-
+	void											buildMemberIndex() const;
 	MemberState&									makeObjectFileForMember(const Entry* member) const;
 	bool											memberHasObjCCategories(const Entry* member) const;
 	void											dumpTableOfContents();
@@ -135,7 +138,7 @@ private:
 #endif
 	uint32_t										_tableOfContentCount;
 	const char*										_tableOfContentStrings;
-	mutable MemberToStateMap						_instantiatedEntries;
+	mutable std::vector<MemberState>				_members;		// every member in file order, so member index is position+1
 	NameToOffsetMap									_hashTable;
 	const bool										_forceLoadAll;
 	const bool										_forceLoadObjC;
@@ -353,37 +356,34 @@ bool File<A>::memberHasObjCCategories(const Entry* member) const
 }
 
 
+// Walks the member headers once, the first time any member is needed.  Members are
+// found by binary search after that, instead of walking from the last one seen.
 template <typename A>
-typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* member) const
+void File<A>::buildMemberIndex() const
 {
-	uint32_t memberIndex = 0;
-	// in case member was instantiated earlier but not needed yet
-	typename MemberToStateMap::iterator pos = _instantiatedEntries.find(member);
-	if ( pos == _instantiatedEntries.end() ) {
-		// Have to find the index of this member
-		const Entry* start;
-		uint32_t index;
-		if (_instantiatedEntries.size() == 0) {
-			start = (Entry*)&_archiveFileContent[8];
-			index = 1;
-		} else {
-			MemberState &lastKnown = _instantiatedEntries.rbegin()->second;
-			start = lastKnown.entry->next();
-			index = lastKnown.index+1;
-		}
-		for (const Entry* p=start; p <= member; p = p->next(), index++) {
-			MemberState state = {NULL, p, false, false, index};
-			_instantiatedEntries[p] = state;
-			if (member == p) {
-				memberIndex = index;
-			}
-		}
-	} else {
-		MemberState& state = pos->second;
-		if (state.file)
-			return state;
-		memberIndex = state.index;
+	const Entry* const start = (Entry*)&_archiveFileContent[8];
+	const Entry* const end = (Entry*)&_archiveFileContent[_archiveFilelength];
+	uint32_t index = 1;
+	for (const Entry* p=start; p < end; p = p->next(), ++index) {
+		MemberState state = {NULL, p, false, false, false, index};
+		_members.push_back(state);
 	}
+}
+
+
+template <typename A>
+typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* member) const
+{
+	if ( _members.empty() )
+		this->buildMemberIndex();
+	typename std::vector<MemberState>::iterator pos = std::lower_bound(_members.begin(), _members.end(), member,
+															[](const MemberState& state, const Entry* e) { return state.entry < e; });
+	if ( (pos == _members.end()) || (pos->entry != member) )
+		throwf("corrupt archive %s, table of contents points into the middle of a member", this->path());
+	MemberState& state = *pos;
+	if ( state.file != NULL )
+		return state;
+	const uint32_t memberIndex = state.index;
 	assert(memberIndex != 0);
 	char memberName[256];
 	member->getName(memberName, sizeof(memberName));
@@ -406,18 +406,17 @@ typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* mem
 																	mPath, member->modificationTime(), 
 																	ordinal, _objOpts);
 		if ( result != NULL ) {
-			MemberState state = {result, member, false, false, memberIndex};
-			_instantiatedEntries[member] = state;
-			return _instantiatedEntries[member];
+			state.file = result;
+			return state;
 		}
 		// see if member is llvm bitcode file
 		result = lto::parse(member->content(), member->contentSize(), 
 								mPath, member->modificationTime(), ordinal, 
 								_objOpts.architecture, _objOpts.subType, _logAllFiles, _objOpts.verboseOptimizationHints);
 		if ( result != NULL ) {
-			MemberState state = {result, member, false, false, memberIndex};
-			_instantiatedEntries[member] = state;
-			return _instantiatedEntries[member];
+			state.file = result;
+			state.bitcode = true;
+			return state;
 		}
 			
 		throwf("archive member '%s' with length %d is not mach-o or llvm bitcode", memberName, member->contentSize());
@@ -541,6 +540,59 @@ bool File<A>::justInTimeforEachAtom(const char* name, ld::File::AtomHandler& han
 	return loadMember(state, handler, "%s forced load of %s(%s)\n", name, this->path(), memberName);
 }
 
+// With -all_load on big static libraries, most of what gets parsed is later dead stripped.
+// Members none of whose atoms survived are deleted, then the pages of every member that
+// is not in use are handed back, so the archive mapping stops counting against the link.
+template <typename A>
+void File<A>::releaseUnusedMembers(const std::unordered_set<const ld::File*>& liveFiles, uint32_t& memberCount, uint64_t& byteCount) const
+{
+	const uintptr_t pageSize = getpagesize();
+	const uintptr_t fileEnd = (uintptr_t)(_archiveFileContent + _archiveFilelength);
+	uintptr_t runStart = 0;
+	uintptr_t runEnd = 0;
+	auto dropRun = [&]() {
+		// only whole pages, the neighbors may still be in use
+		const uintptr_t first = (runStart + pageSize - 1) & ~(pageSize - 1);
+		const uintptr_t last = runEnd & ~(pageSize - 1);
+		if ( last > first ) {
+			::madvise((void*)first, last - first, MADV_DONTNEED);
+			byteCount += (last - first);
+		}
+		runStart = runEnd = 0;
+	};
+	// the first member is the table of contents, which _hashTable still points into
+	for (size_t i=1; i < _members.size(); ++i) {
+		MemberState& state = _members[i];
+		if ( (state.file != NULL) && !state.bitcode && (liveFiles.count(state.file) == 0) ) {
+			delete state.file;
+			state.file = NULL;
+			++memberCount;
+		}
+		const uintptr_t memberStart = (uintptr_t)state.entry;
+		const uintptr_t memberEnd = std::min((uintptr_t)(state.entry->content() + state.entry->contentSize()), fileEnd);
+		if ( state.file == NULL ) {
+			if ( runStart == 0 )
+				runStart = memberStart;
+			runEnd = memberEnd;
+		}
+		else if ( runStart != 0 ) {
+			dropRun();
+		}
+	}
+	if ( runStart != 0 )
+		dropRun();
+}
+
+template <typename A>
+void File<A>::forEachParsedMember(void (^handler)(const ld::File* member)) const
+{
+	for (size_t i=1; i < _members.size(); ++i) {
+		const MemberState& state = _members[i];
+		if ( (state.file != NULL) && !state.bitcode )
+			handler(state.file);
+	}
+}
+
 class CheckIsDataSymbolHandler : public ld::File::AtomHandler
 {
 public:
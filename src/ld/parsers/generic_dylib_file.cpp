@@ -438,6 +438,17 @@ void File::processIndirectLibraries(ld::dylib::File::DylibHandler* handler, bool
     _indirectDylibsProcessed = true;
 }
 
+void File::forEachIndirectDylibToFind(void (^handler)(const char* installPath)) const
+{
+    // must match the findDylib() calls made by processIndirectLibraries()
+    if ( _indirectDylibsProcessed || (_noRexports && !_linkingFlat) )
+        return;
+    for (const auto& dep : _dependentDylibs) {
+        if ( _linkingFlat || dep.reExport || !_explictReExportFound )
+            handler(dep.path);
+    }
+}
+
 bool File::isPublicLocation(const char* path) const
 {
     // -no_implicit_dylibs disables this optimization
@@ -115,6 +115,7 @@ public:
 
 	// overrides of ld::dylib::File
 	virtual void							processIndirectLibraries(ld::dylib::File::DylibHandler*, bool addImplicitDylibs) override;
+	virtual void							forEachIndirectDylibToFind(void (^handler)(const char* installPath)) const override final;
 	virtual bool							providedExportAtom() const	override final { return _providedAtom; }
     virtual bool                            hasReExportedDependentsThatProvidedExportAtom() const override;
 	virtual const char*						parentUmbrella() const override final { return _parentUmbrella; }
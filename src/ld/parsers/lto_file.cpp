@@ -34,6 +34,7 @@
 #include <pthread.h>
 #include <mach-o/dyld.h>
 #include <dlfcn.h>
+#include <dispatch/dispatch.h>
 #include <atomic>
 #include <vector>
 #include <map>
@@ -386,6 +387,9 @@ ld::relocatable::File* Parser::parseMachOFile(const uint8_t* p, size_t len, cons
 	objOpts.maxDefaultCommonAlignment = options.maxDefaultCommonAlignment;
 	objOpts.internalSDK			= options.internalSDK;
 	objOpts.forceHidden			= false;
+	objOpts.parseCacheDir		= NULL;
+	objOpts.parseCacheMaxSize	= 0;
+	objOpts.literalPool			= NULL;
 
 	const char *object_path = path.c_str();
 	if (path.empty())
@@ -1373,23 +1377,30 @@ bool Parser::optimizeThinLTO(const std::vector<File*>&              files,
 		return thinlto_module_get_object(thingenerator, ID);
 	};
 
+	// libLTO is only asked for the buffers from this thread, the work on them below is concurrent
+	std::vector<LTOObjectBuffer> buffers;
+	buffers.reserve(numObjects);
+	for (unsigned bufID = 0; bufID < numObjects; ++bufID)
+		buffers.push_back(get_thinlto_buffer_or_load_file(bufID));
+
 	// if requested, save off objects files
 	if ( options.saveTemps ) {
-		for (unsigned bufID = 0; bufID < numObjects; ++bufID) {
-			auto machOFile = get_thinlto_buffer_or_load_file(bufID);
-			std::string tempMachoPath = options.outputFilePath;
+		const LTOObjectBuffer* saveBuffers = &buffers[0];
+		const char* outputFilePath = options.outputFilePath;
+		dispatch_apply(numObjects, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t bufID) {
+			std::string tempMachoPath = outputFilePath;
 			tempMachoPath += ".";
 			tempMachoPath += std::to_string(bufID);
 			tempMachoPath += ".thinlto.o";
 			int fd = ::open(tempMachoPath.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0666);
 			if ( fd != -1 ) {
-				::write(fd, machOFile.Buffer, machOFile.Size);
+				::write(fd, saveBuffers[bufID].Buffer, saveBuffers[bufID].Size);
 				::close(fd);
 			}
 			else {
 				warning("unable to write temporary ThinLTO output: %s", tempMachoPath.c_str());
 			}
-		}
+		});
 	}
 
 	// mach-o parsing is done in-memory, but need path for debug notes
@@ -1405,42 +1416,91 @@ bool Parser::optimizeThinLTO(const std::vector<File*>&              files,
 		}
 	}
 
+	struct GeneratedObject
+	{
+		LTOObjectBuffer				buffer;
+		std::string					path;
+		bool						saveToPath;
+		ld::File::Ordinal			ordinal;
+		ld::relocatable::File*		file;
+		const char*					errorMessage;
+		dispatch_semaphore_t		parsed;
+	};
+	std::vector<GeneratedObject> objects;
+	objects.reserve(numObjects);
 	auto ordinal = ld::File::Ordinal::LTOOrdinal().nextFileListOrdinal();
 	for (unsigned bufID = 0; bufID < numObjects; ++bufID) {
-		auto machOFile = get_thinlto_buffer_or_load_file(bufID);
-		if (!machOFile.Size) {
+		if (!buffers[bufID].Size) {
 			warning("Ignoring empty buffer generated by ThinLTO");
 			continue;
 		}
-
-		// mach-o parsing is done in-memory, but need path for debug notes
-		std::string tmp_path;
+		GeneratedObject object;
+		object.buffer		= buffers[bufID];
+		object.saveToPath	= false;
+		object.ordinal		= ordinal;
+		object.file			= NULL;
+		object.errorMessage	= NULL;
+		object.parsed		= dispatch_semaphore_create(0);
+		ordinal = ordinal.nextFileListOrdinal();
 #if LTO_API_VERSION >= 21
 		if ( useFileBasedAPI ) {
-			tmp_path = thinlto_module_get_object_file(thingenerator, bufID);
+			object.path = thinlto_module_get_object_file(thingenerator, bufID);
 		}
 		else
 #endif
 		if ( options.tmpObjectFilePath != NULL) {
-			tmp_path = macho_dirpath + "/" + std::to_string(bufID) + ".o";
 			// if needed, save temp mach-o file to specific location
-			int fd = ::open(tmp_path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0666);
-			if ( fd != -1) {
-				::write(fd, (const uint8_t *)machOFile.Buffer, machOFile.Size);
-				::close(fd);
+			object.path = macho_dirpath + "/" + std::to_string(bufID) + ".o";
+			object.saveToPath = true;
+		}
+		objects.push_back(object);
+	}
+
+	// Parse the generated objects concurrently, but load their atoms one at a time in bufID
+	// order, each as soon as it is parsed, so symbol resolution does not depend on timing.
+	dispatch_group_t parseGroup = dispatch_group_create();
+	const OptimizeOptions* parseOptions = &options;
+	for (GeneratedObject& object : objects) {
+		GeneratedObject* obj = &object;
+		dispatch_group_async(parseGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+			if ( obj->saveToPath ) {
+				int fd = ::open(obj->path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0666);
+				if ( fd != -1) {
+					::write(fd, (const uint8_t *)obj->buffer.Buffer, obj->buffer.Size);
+					::close(fd);
+				}
+				else {
+					warning("could not write ThinLTO temp file '%s', errno=%d", obj->path.c_str(), errno);
+				}
 			}
-			else {
-				warning("could not write ThinLTO temp file '%s', errno=%d", tmp_path.c_str(), errno);
+			// parse generated mach-o file into a MachOReader
+			try {
+				obj->file = parseMachOFile((const uint8_t *)obj->buffer.Buffer, obj->buffer.Size, obj->path, *parseOptions, obj->ordinal);
+			}
+			catch (const char* msg) {
+				obj->errorMessage = msg;
 			}
+			dispatch_semaphore_signal(obj->parsed);
+		});
+	}
+	try {
+		for (GeneratedObject& object : objects) {
+			dispatch_semaphore_wait(object.parsed, DISPATCH_TIME_FOREVER);
+			if ( object.errorMessage != NULL )
+				throw object.errorMessage;
+			// Load the generated MachO file
+			loadMachO(object.file, options, handler, newAtoms, additionalUndefines, llvmAtoms, deadllvmAtoms);
 		}
-
-		// parse generated mach-o file into a MachOReader
-		ld::relocatable::File* machoFile = parseMachOFile((const uint8_t *)machOFile.Buffer, machOFile.Size, tmp_path, options, ordinal);
-		ordinal = ordinal.nextFileListOrdinal();
-
-		// Load the generated MachO file
-		loadMachO(machoFile, options, handler, newAtoms, additionalUndefines, llvmAtoms, deadllvmAtoms);
 	}
+	catch (...) {
+		// parsers still running write into objects
+		dispatch_group_wait(parseGroup, DISPATCH_TIME_FOREVER);
+		throw;
+	}
+	dispatch_group_wait(parseGroup, DISPATCH_TIME_FOREVER);
+	dispatch_release(parseGroup);
+	for (GeneratedObject& object : objects)
+		dispatch_release(object.parsed);
 
 	// Remove Atoms from ld if code generator optimized them away
 	for (CStringToAtom::iterator li = llvmAtoms.begin(), le = llvmAtoms.end(); li != le; ++li) {
@@ -564,7 +564,7 @@ public:
 						   opts.linkingMainExecutable(), opts.implicitlyLinkIndirectPublicDylibs(),
 						   opts.platforms(), opts.allowWeakImports(),
 						   opts.allowSimulatorToLinkWithMacOSX(), opts.addVersionLoadCommand(),
-						   opts.targetIOSSimulator(), opts.logAllFiles(), opts.installPath(),
+						   opts.targetIOSSimulator(), false, opts.installPath(),
 						   indirectDylib, opts.bundleBitcode(), opts.internalSDK(), fromSDK,
 						   opts.platformMismatchesAreWarning());
 	}
@@ -31,6 +31,8 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <mach/mach_time.h>
+#include <CommonCrypto/CommonDigest.h>
 
 #include "MachOFileAbstraction.hpp"
 
@@ -38,17 +40,21 @@
 #include "libunwind/AddressSpace.hpp"
 #include "libunwind/Registers.hpp"
 
+#include <string>
 #include <vector>
 #include <set>
 #include <map>
 #include <algorithm>
 #include <type_traits>
+#include <atomic>
+#include <mutex>
 
 #include "dwarf2.h"
 #include "debugline.h"
 
 #include "Architectures.hpp"
 #include "Bitcode.hpp"
+#include "CacheDirectory.hpp"
 #include "ld.hpp"
 #include "macho_relocatable_file.h"
 
@@ -67,6 +73,7 @@ template <typename A> class Atom;
 template <typename A> class Section;
 template <typename A> class CFISection;
 template <typename A> class CUSection;
+template <typename A> class CStringSection;
 
 template <typename A>
 class File : public ld::relocatable::File
@@ -80,6 +87,8 @@ public:
 												_dwarfTranslationUnitPath(NULL), 
 												_dwarfDebugInfoSect(NULL), _dwarfDebugAbbrevSect(NULL), 
 												_dwarfDebugLineSect(NULL), _dwarfDebugStringSect(NULL), 
+												_dwarfStmtList(0), _stubsMachOSection(NULL), _lineInfoPending(false),
+												_countedAtomBytes(0), _countedFixupBytes(0), _countedUnwindAndLineInfoBytes(0),
 												_hasObjC(false),
 												_swiftVersion(0),
 												_swiftLanguageVersion(0),
@@ -108,6 +117,8 @@ public:
 	virtual bool										canScatterAtoms() const			{ return _canScatterAtoms; }
 	virtual bool										hasllvmProfiling() const    	{ return _hasllvmProfiling; }
 	virtual const char*									translationUnitSource() const;
+	virtual void										loadLineInfo() const;
+	virtual uint32_t									atomCount() const				{ return _atomsArrayCount + _aliasAtomsArrayCount; }
 	virtual LinkerOptionsList*							linkerOptions() const			{ return &_linkerOptions; }
 	virtual const ToolVersionList&						toolVersions() const			{ return _toolVersions; }
 	virtual uint8_t										swiftVersion() const			{ return _swiftVersion; }
@@ -123,10 +134,16 @@ private:
 	friend class Atom<A>;
 	friend class Section<A>;
 	friend class Parser<A>;
+	friend class CStringSection<A>;
 	friend class CFISection<A>::OAS;
 
 	typedef typename A::P					P;
-	
+	typedef typename A::P::E				E;
+	typedef typename A::P::uint_t			pint_t;
+
+	Atom<A>*								findAtomByAddress(pint_t addr) const;
+	Atom<A>*								findAtomByAddressOrNullIfStub(pint_t addr) const;
+
 	const uint8_t*							_fileContent;
 	Section<A>**							_sectionsArray;
 	uint8_t*								_atomsArray;
@@ -136,7 +153,8 @@ private:
 	uint32_t								_aliasAtomsArrayCount;
 	std::vector<ld::Fixup>					_fixups;
 	std::vector<ld::Atom::UnwindInfo>		_unwindInfos;
-	std::vector<ld::Atom::LineInfo>			_lineInfos;
+	mutable std::vector<ld::Atom::LineInfo>	_lineInfos;
+	std::vector<uint32_t>					_literalPoolIndexes;
 	std::vector<ld::relocatable::File::Stab>_stabs;
 	std::vector<AstTimeAndPath>				_astFiles;
 	ld::relocatable::File::DebugInfoKind	_debugInfoKind;
@@ -146,6 +164,13 @@ private:
 	const macho_section<P>*					_dwarfDebugLineSect;
 	const macho_section<P>*					_dwarfDebugStringSect;
 	const macho_section<P>*					_dwarfDebugStringOffsSect;
+	uint64_t								_dwarfStmtList;
+	const macho_section<P>*					_stubsMachOSection;
+	mutable bool							_lineInfoPending;
+	// what this file added to the -print_statistics memory counts, taken back when it is deleted
+	uint64_t								_countedAtomBytes;
+	uint64_t								_countedFixupBytes;
+	mutable uint64_t						_countedUnwindAndLineInfoBytes;
 	bool									_hasObjC;
 	uint8_t									_swiftVersion;
 	uint16_t								_swiftLanguageVersion;
@@ -192,6 +217,8 @@ public:
 	virtual unsigned long			contentHash(const class Atom<A>* atom, const ld::IndirectBindingTable& ind) const { return 0; }
 	virtual bool					canCoalesceWith(const class Atom<A>* atom, const ld::Atom& rhs, 
 													const ld::IndirectBindingTable& ind) const { return false; }
+	virtual void					addToLiteralPool(ld::LiteralPool& pool) { }
+	virtual bool					literalPoolIndex(const class Atom<A>* atom, uint32_t& index) const { return false; }
 	virtual	bool					ignoreLabel(const char* label) const { return false; }
 	static const char*				makeSectionName(const macho_section<typename A::P>* s);
 
@@ -701,7 +728,7 @@ class CStringSection : public ImplicitSizeSection<A>
 {
 public:
 						CStringSection(Parser<A>& parser, File<A>& f, const macho_section<typename A::P>* s)
-							: ImplicitSizeSection<A>(parser, f, s) {}
+							: ImplicitSizeSection<A>(parser, f, s), _pooled(false), _poolIndexStart(0) {}
 protected:
 	typedef typename A::P::uint_t	pint_t;
 	typedef typename A::P			P;
@@ -717,7 +744,12 @@ protected:
 	virtual unsigned long			contentHash(const class Atom<A>* atom, const ld::IndirectBindingTable& ind) const;
 	virtual bool					canCoalesceWith(const class Atom<A>* atom, const ld::Atom& rhs, 
 													const ld::IndirectBindingTable& ind) const;
+	virtual void					addToLiteralPool(ld::LiteralPool& pool);
+	virtual bool					literalPoolIndex(const class Atom<A>* atom, uint32_t& index) const;
 
+private:
+	bool							_pooled;
+	uint32_t						_poolIndexStart;	// into File<A>::_literalPoolIndexes
 };
 
 
@@ -756,6 +788,8 @@ public:
 	virtual const uint8_t*						rawContentPointer() const { return contentPointer(); }
 	virtual unsigned long						contentHash(const ld::IndirectBindingTable& ind) const 
 															{ if ( _hash == 0 ) _hash = sect().contentHash(this, ind); return _hash; }
+	virtual bool								literalPoolIndex(uint32_t& index) const
+															{ return sect().literalPoolIndex(this, index); }
 	virtual bool								canCoalesceWith(const ld::Atom& rhs, const ld::IndirectBindingTable& ind) const 
 															{ return sect().canCoalesceWith(this, rhs, ind); }
 	virtual ld::Fixup::iterator					fixupsBegin() const	{ return &machofile()._fixups[_fixupsStartIndex]; }
@@ -831,6 +865,7 @@ public:
 
 private:
 	friend class Parser<A>;
+	friend class File<A>;
 	friend class Section<A>;
 	friend class CStringSection<A>;
 	friend class AbsoluteSymbolSection<A>;
@@ -1002,6 +1037,197 @@ private:
 ld::Section AliasAtom::_s_section("__LD", "__aliases", ld::Section::typeTempAlias, true);
 
 
+//
+// The address sorted symbol order that parse() computes depends only on the .o content
+// and a few parser options.  With -object_parse_cache, it is saved in a directory so
+// relinking with unchanged .o files mmaps the saved order instead of sorting sections
+// and symbols again.  Entries are keyed by the path, inode, size, and modification time
+// of the .o plus the options.  Archive members share their archive's identity, and
+// members with the same name and size are common (e.g. ZERO_AR_DATE archives), so a
+// member's key also has a digest of its content.  The atom count is saved as a check:
+// parse() still counts atoms with the saved order and reparses from scratch if the counts
+// differ.  The atoms, fixups, and line info themselves point into the mapped .o and are
+// still built on every link.
+//
+class ParseCache
+{
+public:
+	struct Entry {
+		uint32_t		magic;
+		uint32_t		version;
+		uint32_t		symbolCount;
+		uint32_t		sortedSymbolCount;
+		uint32_t		atomCount;
+		uint32_t		overlappingSymbols;
+		uint32_t		keyLength;
+		// followed by uint32_t sortedSymbolIndexes[sortedSymbolCount], then char key[keyLength]
+
+		const uint32_t*	sortedSymbolIndexes() const		{ return (uint32_t*)&this[1]; }
+		const char*		key() const						{ return (char*)&sortedSymbolIndexes()[sortedSymbolCount]; }
+		static size_t	size(uint32_t sortedCount, uint32_t keyLen) { return sizeof(Entry) + sortedCount*sizeof(uint32_t) + keyLen; }
+	};
+
+						ParseCache(const char* path, time_t modTime, const uint8_t* fileContent, uint64_t fileLength,
+									const ParserOptions& opts);
+						~ParseCache();
+	bool				enabled() const		{ return (_dir != NULL); }
+	const Entry*		lookup(uint32_t symbolCount, uint32_t sortedSymbolCount);
+	// counts an entry lookup() returned, but parse() found did not match the file, as a miss
+	void				reject()			{ --sHits; ++sMisses; }
+	void				store(uint32_t symbolCount, uint32_t sortedSymbolCount, const uint32_t sortedSymbolIndexes[],
+								uint32_t atomCount, bool overlappingSymbols);
+
+	static std::atomic<uint32_t>	sHits;
+	static std::atomic<uint32_t>	sMisses;
+	static std::atomic<uint64_t>	sTime;		// mach_absolute_time() units spent keying, looking up, and storing
+
+private:
+	enum { kMagic = 0x6370646C, kVersion = 3 };	// 'ldpc'
+
+	const char*			_dir;
+	uint64_t			_maxSize;
+	std::string			_key;
+	char				_fileName[CC_SHA256_DIGEST_LENGTH*2+1];
+	void*				_mapping;
+	size_t				_mappingSize;
+};
+
+std::atomic<uint32_t> ParseCache::sHits(0);
+std::atomic<uint32_t> ParseCache::sMisses(0);
+std::atomic<uint64_t> ParseCache::sTime(0);
+
+
+ParseCache::ParseCache(const char* path, time_t modTime, const uint8_t* fileContent, uint64_t fileLength,
+						const ParserOptions& opts)
+	: _dir(opts.parseCacheDir), _maxSize(opts.parseCacheMaxSize), _mapping(NULL), _mappingSize(0)
+{
+	if ( _dir == NULL )
+		return;
+	const uint64_t startTime = mach_absolute_time();
+	// archive members are named "libfoo.a(member.o)", the archive's identity stands in for theirs
+	struct stat statBuffer;
+	bool found = (::stat(path, &statBuffer) == 0);
+	bool isMember = false;
+	const size_t pathLen = strlen(path);
+	if ( !found && (pathLen != 0) && (path[pathLen-1] == ')') ) {
+		if ( const char* memberStart = strrchr(path, '(') ) {
+			std::string archivePath(path, memberStart - path);
+			found = (::stat(archivePath.c_str(), &statBuffer) == 0);
+			isMember = true;
+		}
+	}
+	if ( !found ) {
+		_dir = NULL;
+		return;
+	}
+	// only options that change how sections are split into atoms are part of the key
+	char buffer[PATH_MAX+256];
+	snprintf(buffer, sizeof(buffer), "%s|%llu|%llu|%llu|%ld.%09ld|%ld|%u|%u|%d%d%d%d%d%d%d%d|%d|%u|%d", path,
+			(uint64_t)statBuffer.st_dev, (uint64_t)statBuffer.st_ino, fileLength,
+			(long)statBuffer.st_mtimespec.tv_sec, (long)statBuffer.st_mtimespec.tv_nsec, (long)modTime,
+			(uint32_t)opts.architecture, (uint32_t)opts.subType, opts.keepDwarfUnwind, opts.forceDwarfConversion, opts.neverConvertDwarf,
+			opts.warnUnwindConversionProblems, opts.armUsesZeroCostExceptions, opts.treateBitcodeAsData, opts.usingBitcode,
+			opts.forceHidden, (int)opts.srcKind, (uint32_t)opts.maxDefaultCommonAlignment, kVersion);
+	_key = buffer;
+	uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+	if ( isMember ) {
+		// the archive's identity does not tell apart members with the same name and size
+		CC_SHA256(fileContent, (CC_LONG)fileLength, digest);
+		_key += '|';
+		for (int i=0; i < CC_SHA256_DIGEST_LENGTH; ++i) {
+			char hex[3];
+			sprintf(hex, "%02x", digest[i]);
+			_key += hex;
+		}
+	}
+	CC_SHA256(_key.c_str(), (CC_LONG)_key.size(), digest);
+	for (int i=0; i < CC_SHA256_DIGEST_LENGTH; ++i)
+		sprintf(&_fileName[i*2], "%02x", digest[i]);
+	sTime += mach_absolute_time() - startTime;
+}
+
+ParseCache::~ParseCache()
+{
+	if ( _mapping != NULL )
+		::munmap(_mapping, _mappingSize);
+}
+
+const ParseCache::Entry* ParseCache::lookup(uint32_t symbolCount, uint32_t sortedSymbolCount)
+{
+	const uint64_t startTime = mach_absolute_time();
+	_mapping = ld::cache_directory::mapEntry(_dir, _fileName, _mappingSize);
+
+	// an entry that does not match this file exactly is ignored and will be overwritten
+	const Entry* entry = (Entry*)_mapping;
+	bool valid = (_mapping != NULL) && (_mappingSize >= sizeof(Entry))
+				&& (entry->magic == kMagic) && (entry->version == kVersion)
+				&& (entry->symbolCount == symbolCount) && (entry->sortedSymbolCount == sortedSymbolCount)
+				&& (entry->keyLength == _key.size()) && (_mappingSize == Entry::size(sortedSymbolCount, entry->keyLength))
+				&& (memcmp(entry->key(), _key.data(), _key.size()) == 0);
+	for (uint32_t i=0; valid && (i < sortedSymbolCount); ++i) {
+		if ( entry->sortedSymbolIndexes()[i] >= symbolCount )
+			valid = false;
+	}
+	if ( !valid ) {
+		if ( _mapping != NULL )
+			::munmap(_mapping, _mappingSize);
+		_mapping = NULL;
+		entry = NULL;
+		++sMisses;
+	}
+	else {
+		++sHits;
+	}
+	sTime += mach_absolute_time() - startTime;
+	return entry;
+}
+
+void ParseCache::store(uint32_t symbolCount, uint32_t sortedSymbolCount, const uint32_t sortedSymbolIndexes[],
+						uint32_t atomCount, bool overlappingSymbols)
+{
+	const uint64_t startTime = mach_absolute_time();
+	Entry header;
+	header.magic				= kMagic;
+	header.version				= kVersion;
+	header.symbolCount			= symbolCount;
+	header.sortedSymbolCount	= sortedSymbolCount;
+	header.atomCount			= atomCount;
+	header.overlappingSymbols	= overlappingSymbols;
+	header.keyLength			= (uint32_t)_key.size();
+	const std::vector<ld::cache_directory::Piece> pieces = {
+		{ &header, sizeof(Entry) },
+		{ sortedSymbolIndexes, sortedSymbolCount*sizeof(uint32_t) },
+		{ _key.data(), _key.size() }
+	};
+	if ( ld::cache_directory::storeEntry(_dir, _fileName, pieces) ) {
+		// trim the cache at most once per link, after it is first added to
+		static std::once_flag sPruned;
+		std::call_once(sPruned, [this]() { ld::cache_directory::prune(_dir, _maxSize); });
+	}
+	sTime += mach_absolute_time() - startTime;
+}
+
+void parseCacheCounts(uint32_t& hits, uint32_t& misses, uint64_t& time)
+{
+	hits = ParseCache::sHits;
+	misses = ParseCache::sMisses;
+	time = ParseCache::sTime;
+}
+
+
+// bytes held by the parsed files that have not been deleted, for -print_statistics
+static std::atomic<uint64_t> sAtomBytes(0);
+static std::atomic<uint64_t> sFixupBytes(0);
+static std::atomic<uint64_t> sUnwindAndLineInfoBytes(0);
+
+void memoryCounts(uint64_t& atomBytes, uint64_t& fixupBytes, uint64_t& unwindAndLineInfoBytes)
+{
+	atomBytes = sAtomBytes;
+	fixupBytes = sFixupBytes;
+	unwindAndLineInfoBytes = sUnwindAndLineInfoBytes;
+}
+
+
 template <typename A>
 class Parser 
 {
@@ -1243,6 +1469,8 @@ private:
 	void											prescanSymbolTable();
 	void											makeSortedSymbolsArray(uint32_t symArray[], const uint32_t sectionArray[]);
 	void											makeSortedSectionsArray(uint32_t array[]);
+	uint32_t										computeAtomCount(const uint32_t sortedSymbolIndexes[], const pint_t cfiStartsArray[],
+																	 uint32_t cfiStartsArrayCount, const CFI_CU_InfoArrays& cfis);
 	static int										pointerSorter(const void* l, const void* r);
 	static int										symbolIndexSorter(void* extra, const void* l, const void* r);
 	static int										sectionIndexSorter(void* extra, const void* l, const void* r);
@@ -1857,14 +2085,28 @@ ld::relocatable::File* Parser<A>::parse(const ParserOptions& opts)
 	if ( ! parseLoadCommands(opts.platforms, opts.internalSDK) )
 		return _file;
 	
+	this->prescanSymbolTable();
+
+	// if this content was parsed before, reuse its symbol order
+	ParseCache cache(_path, _modTime, _fileContent, _fileLength, opts);
+	const ParseCache::Entry* cached = NULL;
+	if ( cache.enabled() )
+		cached = cache.lookup(_symbolCount, _symbolsInSections);
+
 	// make array of
 	uint32_t sortedSectionIndexes[_machOSectionsCount];
-	this->makeSortedSectionsArray(sortedSectionIndexes);
 	
 	// make symbol table sorted by address
-	this->prescanSymbolTable();
-	uint32_t sortedSymbolIndexes[_symbolsInSections];
-	this->makeSortedSymbolsArray(sortedSymbolIndexes, sortedSectionIndexes);
+	uint32_t sortedSymbolIndexesBuffer[_symbolsInSections];
+	const uint32_t* sortedSymbolIndexes = sortedSymbolIndexesBuffer;
+	if ( cached != NULL ) {
+		sortedSymbolIndexes = cached->sortedSymbolIndexes();
+		_overlappingSymbols = cached->overlappingSymbols;
+	}
+	else {
+		this->makeSortedSectionsArray(sortedSectionIndexes);
+		this->makeSortedSymbolsArray(sortedSymbolIndexesBuffer, sortedSectionIndexes);
+	}
 		
 	// allocate Section<A> object for each mach-o section
 	makeSections();
@@ -1967,16 +2209,18 @@ ld::relocatable::File* Parser<A>::parse(const ParserOptions& opts)
 	uint32_t	sectionsCount = _file->_sectionsArrayCount;
 
 	// figure out how many atoms will be allocated and allocate
-	LabelAndCFIBreakIterator breakIterator(sortedSymbolIndexes, _symbolsInSections, cfiStartsArray, 
-											cfiStartsArrayCount, _overlappingSymbols);
-	uint32_t computedAtomCount = 0;
-	for (uint32_t i=0; i < sectionsCount; ++i ) {
-		breakIterator.beginSection();
-		uint32_t count = sections[i]->computeAtomCount(*this, breakIterator, cfis);
-		//const macho_section<P>* sect = sections[i]->machoSection();
-		//fprintf(stderr, "computed count=%u for section %s size=%llu\n", count, sect->sectname(), (sect != NULL) ? sect->size() : 0);
-		computedAtomCount += count;
-	}
+	uint32_t computedAtomCount = this->computeAtomCount(sortedSymbolIndexes, cfiStartsArray, cfiStartsArrayCount, cfis);
+	if ( (cached != NULL) && (computedAtomCount != cached->atomCount) ) {
+		// the saved order does not split this file the way it was saved, so sort from scratch and replace the entry
+		cached = NULL;
+		cache.reject();
+		this->makeSortedSectionsArray(sortedSectionIndexes);
+		this->makeSortedSymbolsArray(sortedSymbolIndexesBuffer, sortedSectionIndexes);
+		sortedSymbolIndexes = sortedSymbolIndexesBuffer;
+		computedAtomCount = this->computeAtomCount(sortedSymbolIndexes, cfiStartsArray, cfiStartsArrayCount, cfis);
+	}
+	if ( (cached == NULL) && cache.enabled() )
+		cache.store(_symbolCount, _symbolsInSections, sortedSymbolIndexes, computedAtomCount, _overlappingSymbols);
 	//fprintf(stderr, "allocating %d atoms * sizeof(Atom<A>)=%ld, sizeof(ld::Atom)=%ld\n", computedAtomCount, sizeof(Atom<A>), sizeof(ld::Atom));
 	_file->_atomsArray = new uint8_t[computedAtomCount*sizeof(Atom<A>)];
 	_file->_atomsArrayCount = 0;
@@ -2077,10 +2321,23 @@ ld::relocatable::File* Parser<A>::parse(const ParserOptions& opts)
 		this->appendAliasAtoms(_file->_aliasAtomsArray);
 	}
 	
+	_file->_countedAtomBytes = _file->_atomsArrayCount*sizeof(Atom<A>) + _file->_aliasAtomsArrayCount*sizeof(AliasAtom);
+	_file->_countedFixupBytes = _file->_fixups.capacity()*sizeof(ld::Fixup);
+	_file->_countedUnwindAndLineInfoBytes = _file->_unwindInfos.capacity()*sizeof(ld::Atom::UnwindInfo);
+	sAtomBytes += _file->_countedAtomBytes;
+	sFixupBytes += _file->_countedFixupBytes;
+	sUnwindAndLineInfoBytes += _file->_countedUnwindAndLineInfoBytes;
 	
 	// parse dwarf debug info to get line info
 	this->parseDebugInfo();
 
+	// hash cstrings into the shared pool while still on a parser thread, so the
+	// SymbolTable only has to look up each string's pool index when coalescing
+	if ( opts.literalPool != NULL ) {
+		for (uint32_t i=0; i < sectionsCount; ++i )
+			sections[i]->addToLiteralPool(*opts.literalPool);
+	}
+
 	return _file;
 }
 
@@ -2578,6 +2835,25 @@ void Parser<A>::makeSortedSymbolsArray(uint32_t array[], const uint32_t sectionA
 	}
 }
 
+// how many atoms the sections split into, given the address sorted symbols
+template <typename A>
+uint32_t Parser<A>::computeAtomCount(const uint32_t sortedSymbolIndexes[], const pint_t cfiStartsArray[],
+									 uint32_t cfiStartsArrayCount, const CFI_CU_InfoArrays& cfis)
+{
+	Section<A>** sections = _file->_sectionsArray;
+	LabelAndCFIBreakIterator breakIterator(sortedSymbolIndexes, _symbolsInSections, cfiStartsArray, 
+											cfiStartsArrayCount, _overlappingSymbols);
+	uint32_t result = 0;
+	for (uint32_t i=0; i < _file->_sectionsArrayCount; ++i ) {
+		breakIterator.beginSection();
+		uint32_t count = sections[i]->computeAtomCount(*this, breakIterator, cfis);
+		//const macho_section<P>* sect = sections[i]->machoSection();
+		//fprintf(stderr, "computed count=%u for section %s size=%llu\n", count, sect->sectname(), (sect != NULL) ? sect->size() : 0);
+		result += count;
+	}
+	return result;
+}
+
 template <typename A>
 void Parser<A>::makeSections()
 {
@@ -3887,117 +4163,161 @@ void Parser<A>::parseDebugInfo()
 		_file->_dwarfTranslationUnitPath = NULL;
 	}
 	
-	// add line number info to atoms from dwarf
-	std::vector<AtomAndLineInfo<A> > entries;
-	entries.reserve(64);
+	// line tables are only decoded if a debug map is made, see File<A>::loadLineInfo()
 	if ( _file->_debugInfoKind == ld::relocatable::File::kDebugInfoDwarf ) {
 		// file with just data will have no __debug_line info
 		if ( (_file->_dwarfDebugLineSect != NULL) && (_file->_dwarfDebugLineSect->size() != 0) ) {
 			// validate stmt_list
 			if ( (stmtList != (uint64_t)-1) && (stmtList < _file->_dwarfDebugLineSect->size()) ) {
-				const uint8_t* debug_line = (uint8_t*)_file->fileContent() + _file->_dwarfDebugLineSect->offset();
-				struct line_reader_data* lines = line_open(&debug_line[stmtList],
-														_file->_dwarfDebugLineSect->size() - stmtList, E::little_endian);
-				struct line_info result;
-				Atom<A>* curAtom = NULL;
-				uint32_t curAtomOffset = 0;
-				uint32_t curAtomAddress = 0;
-				uint32_t curAtomSize = 0;
-				std::map<uint32_t,const char*>	dwarfIndexToFile;
-				if ( lines != NULL ) {
-					while ( line_next(lines, &result, line_stop_pc) ) {
-						//fprintf(stderr, "curAtom=%p, result.pc=0x%llX, result.line=%llu, result.end_of_sequence=%d,"
-						//				  " curAtomAddress=0x%X, curAtomSize=0x%X\n",
-						//		curAtom, result.pc, result.line, result.end_of_sequence, curAtomAddress, curAtomSize);
-						// work around weird debug line table compiler generates if no functions in __text section
-						if ( (curAtom == NULL) && (result.pc == 0) && result.end_of_sequence && (result.file == 1))
-							continue;
-						// for performance, see if in next pc is in current atom
-						if ( (curAtom != NULL) && (curAtomAddress <= result.pc) && (result.pc < (curAtomAddress+curAtomSize)) ) {
-							curAtomOffset = result.pc - curAtomAddress;
-						}
-						// or pc at end of current atom
-						else if ( result.end_of_sequence && (curAtom != NULL) && (result.pc == (curAtomAddress+curAtomSize)) ) {
-							curAtomOffset = result.pc - curAtomAddress;
-						}
-						// or only one function that is a one line function
-						else if ( result.end_of_sequence && (curAtom == NULL) && (this->findAtomByAddress(0) != NULL) && (result.pc == this->findAtomByAddress(0)->size()) ) {
-							curAtom			= this->findAtomByAddress(0);
-							curAtomOffset	= result.pc - curAtom->objectAddress();
-							curAtomAddress	= curAtom->objectAddress();
-							curAtomSize		= curAtom->size();
-						}
-						else {
-							// do slow look up of atom by address
-							try {
-								curAtom = this->findAtomByAddress(result.pc);
-							}
-							catch (...) {
-								// in case of bug in debug info, don't abort link, just limp on
-								curAtom = NULL;
-							}
-							if ( curAtom == NULL )
-								break; // file has line info but no functions
-							if ( result.end_of_sequence && (curAtomAddress+curAtomSize < result.pc) ) {	
-								// a one line function can be returned by line_next() as one entry with pc at end of blob
-								// look for alt atom starting at end of previous atom
-								uint32_t previousEnd = curAtomAddress+curAtomSize;
-								Atom<A>* alt = this->findAtomByAddressOrNullIfStub(previousEnd);
-								if ( alt == NULL )
-									continue; // ignore spurious debug info for stubs
-								if ( result.pc <= alt->objectAddress() + alt->size() ) {
-									curAtom			= alt;
-									curAtomOffset	= result.pc - alt->objectAddress();
-									curAtomAddress	= alt->objectAddress();
-									curAtomSize		= alt->size();
-								}
-								else {
-									curAtomOffset	= result.pc - curAtom->objectAddress();
-									curAtomAddress	= curAtom->objectAddress();
-									curAtomSize		= curAtom->size();
-								}
-							}
-							else {
-								curAtomOffset	= result.pc - curAtom->objectAddress();
-								curAtomAddress	= curAtom->objectAddress();
-								curAtomSize		= curAtom->size();
-							}
-						}
-						const char* filename;
-						std::map<uint32_t,const char*>::iterator pos = dwarfIndexToFile.find(result.file);
-						if ( pos == dwarfIndexToFile.end() ) {
-							filename = line_file(lines, result.file);
-							dwarfIndexToFile[result.file] = filename;
-						}
-						else {
-							filename = pos->second;
-						}
-						// only record for ~8000 line info records per function
-						if ( curAtom->roomForMoreLineInfoCount() ) {
-							AtomAndLineInfo<A> entry;
-							entry.atom = curAtom;
-							entry.info.atomOffset = curAtomOffset;
-							entry.info.fileName = filename;
-							entry.info.lineNumber = result.line;
-							//fprintf(stderr, "addr=0x%08llX, line=%lld, file=%s, atom=%s, atom.size=0x%X, end=%d\n", 
-							//		result.pc, result.line, filename, curAtom->name(), curAtomSize, result.end_of_sequence);
-							entries.push_back(entry);
-							curAtom->incrementLineInfoCount();
-						}
-						if ( result.end_of_sequence ) {
-							curAtom = NULL;
-						}
+				_file->_dwarfStmtList = stmtList;
+				_file->_stubsMachOSection = hasStubsSection() ? _stubsMachOSection : NULL;
+				_file->_lineInfoPending = true;
+			}
+		}
+	}
+}
+
+template <typename A>
+Atom<A>* File<A>::findAtomByAddress(pint_t addr) const
+{
+	for (uint32_t i=0; i < _sectionsArrayCount; ++i ) {
+		const macho_section<P>* sect = _sectionsArray[i]->machoSection();
+		if ( (sect != NULL) && (sect->addr() <= addr) && (addr < (sect->addr()+sect->size())) )
+			return _sectionsArray[i]->findAtomByAddress(addr);
+	}
+	// may be in a zero length section
+	for (uint32_t i=0; i < _sectionsArrayCount; ++i ) {
+		const macho_section<P>* sect = _sectionsArray[i]->machoSection();
+		if ( (sect != NULL) && (sect->addr() == addr) && (sect->size() == 0) )
+			return _sectionsArray[i]->findAtomByAddress(addr);
+	}
+	throwf("findAtomByAddress(0x%llX) address not in any section", (uint64_t)addr);
+}
+
+template <typename A>
+Atom<A>* File<A>::findAtomByAddressOrNullIfStub(pint_t addr) const
+{
+	if ( (_stubsMachOSection != NULL) && (_stubsMachOSection->addr() <= addr) && (addr < (_stubsMachOSection->addr()+_stubsMachOSection->size())) )
+		return NULL;
+	return findAtomByAddress(addr);
+}
+
+//
+// Decodes the dwarf line table into per-atom line info.  This is deferred from parsing
+// because only debug map (N_SOL) generation uses it, and it is the most expensive part
+// of parsing an object file built with -g.  Different files can be loaded concurrently.
+//
+template <typename A>
+void File<A>::loadLineInfo() const
+{
+	if ( !_lineInfoPending )
+		return;
+	_lineInfoPending = false;
+
+	// add line number info to atoms from dwarf
+	std::vector<AtomAndLineInfo<A> > entries;
+	entries.reserve(64);
+	const uint64_t stmtList = _dwarfStmtList;
+	const uint8_t* debug_line = (uint8_t*)fileContent() + _dwarfDebugLineSect->offset();
+	struct line_reader_data* lines = line_open(&debug_line[stmtList],
+											_dwarfDebugLineSect->size() - stmtList, E::little_endian);
+	struct line_info result;
+	Atom<A>* curAtom = NULL;
+	uint32_t curAtomOffset = 0;
+	uint32_t curAtomAddress = 0;
+	uint32_t curAtomSize = 0;
+	std::map<uint32_t,const char*>	dwarfIndexToFile;
+	if ( lines != NULL ) {
+		while ( line_next(lines, &result, line_stop_pc) ) {
+			//fprintf(stderr, "curAtom=%p, result.pc=0x%llX, result.line=%llu, result.end_of_sequence=%d,"
+			//				  " curAtomAddress=0x%X, curAtomSize=0x%X\n",
+			//		curAtom, result.pc, result.line, result.end_of_sequence, curAtomAddress, curAtomSize);
+			// work around weird debug line table compiler generates if no functions in __text section
+			if ( (curAtom == NULL) && (result.pc == 0) && result.end_of_sequence && (result.file == 1))
+				continue;
+			// for performance, see if in next pc is in current atom
+			if ( (curAtom != NULL) && (curAtomAddress <= result.pc) && (result.pc < (curAtomAddress+curAtomSize)) ) {
+				curAtomOffset = result.pc - curAtomAddress;
+			}
+			// or pc at end of current atom
+			else if ( result.end_of_sequence && (curAtom != NULL) && (result.pc == (curAtomAddress+curAtomSize)) ) {
+				curAtomOffset = result.pc - curAtomAddress;
+			}
+			// or only one function that is a one line function
+			else if ( result.end_of_sequence && (curAtom == NULL) && (this->findAtomByAddress(0) != NULL) && (result.pc == this->findAtomByAddress(0)->size()) ) {
+				curAtom			= this->findAtomByAddress(0);
+				curAtomOffset	= result.pc - curAtom->objectAddress();
+				curAtomAddress	= curAtom->objectAddress();
+				curAtomSize		= curAtom->size();
+			}
+			else {
+				// do slow look up of atom by address
+				try {
+					curAtom = this->findAtomByAddress(result.pc);
+				}
+				catch (...) {
+					// in case of bug in debug info, don't abort link, just limp on
+					curAtom = NULL;
+				}
+				if ( curAtom == NULL )
+					break; // file has line info but no functions
+				if ( result.end_of_sequence && (curAtomAddress+curAtomSize < result.pc) ) {	
+					// a one line function can be returned by line_next() as one entry with pc at end of blob
+					// look for alt atom starting at end of previous atom
+					uint32_t previousEnd = curAtomAddress+curAtomSize;
+					Atom<A>* alt = this->findAtomByAddressOrNullIfStub(previousEnd);
+					if ( alt == NULL )
+						continue; // ignore spurious debug info for stubs
+					if ( result.pc <= alt->objectAddress() + alt->size() ) {
+						curAtom			= alt;
+						curAtomOffset	= result.pc - alt->objectAddress();
+						curAtomAddress	= alt->objectAddress();
+						curAtomSize		= alt->size();
+					}
+					else {
+						curAtomOffset	= result.pc - curAtom->objectAddress();
+						curAtomAddress	= curAtom->objectAddress();
+						curAtomSize		= curAtom->size();
 					}
-					line_free(lines);
 				}
+				else {
+					curAtomOffset	= result.pc - curAtom->objectAddress();
+					curAtomAddress	= curAtom->objectAddress();
+					curAtomSize		= curAtom->size();
+				}
+			}
+			const char* filename;
+			std::map<uint32_t,const char*>::iterator pos = dwarfIndexToFile.find(result.file);
+			if ( pos == dwarfIndexToFile.end() ) {
+				filename = line_file(lines, result.file);
+				dwarfIndexToFile[result.file] = filename;
+			}
+			else {
+				filename = pos->second;
+			}
+			// only record for ~8000 line info records per function
+			if ( curAtom->roomForMoreLineInfoCount() ) {
+				AtomAndLineInfo<A> entry;
+				entry.atom = curAtom;
+				entry.info.atomOffset = curAtomOffset;
+				entry.info.fileName = filename;
+				entry.info.lineNumber = result.line;
+				//fprintf(stderr, "addr=0x%08llX, line=%lld, file=%s, atom=%s, atom.size=0x%X, end=%d\n", 
+				//		result.pc, result.line, filename, curAtom->name(), curAtomSize, result.end_of_sequence);
+				entries.push_back(entry);
+				curAtom->incrementLineInfoCount();
+			}
+			if ( result.end_of_sequence ) {
+				curAtom = NULL;
 			}
 		}
+		line_free(lines);
 	}
 		
 	// assign line info start offset for each atom
-	uint8_t* p = _file->_atomsArray;
+	uint8_t* p = _atomsArray;
 	uint32_t liOffset = 0;
-	for(int i=_file->_atomsArrayCount; i > 0; --i) {
+	for(int i=_atomsArrayCount; i > 0; --i) {
 		Atom<A>* atom = (Atom<A>*)p;
 		atom->_lineInfoStartIndex = liOffset;
 		liOffset += atom->_lineInfoCount;
@@ -4005,12 +4325,14 @@ void Parser<A>::parseDebugInfo()
 		p += sizeof(Atom<A>);
 	}
 	assert(liOffset == entries.size());
-	_file->_lineInfos.resize(liOffset);
+	_lineInfos.resize(liOffset);
+	_countedUnwindAndLineInfoBytes += _lineInfos.capacity()*sizeof(ld::Atom::LineInfo);
+	sUnwindAndLineInfoBytes += _lineInfos.capacity()*sizeof(ld::Atom::LineInfo);
 
 	// copy each line info for each atom 
 	for (typename std::vector<AtomAndLineInfo<A> >::iterator it = entries.begin(); it != entries.end(); ++it) {
 		uint32_t slot = it->atom->_lineInfoStartIndex + it->atom->_lineInfoCount;
-		_file->_lineInfos[slot] = it->info;
+		_lineInfos[slot] = it->info;
 		it->atom->_lineInfoCount++;
 	}
 	
@@ -4443,6 +4765,9 @@ File<A>::~File()
 {
 	free(_sectionsArray);
 	free(_atomsArray);
+	sAtomBytes -= _countedAtomBytes;
+	sFixupBytes -= _countedFixupBytes;
+	sUnwindAndLineInfoBytes -= _countedUnwindAndLineInfoBytes;
 }
 
 template <typename A>
@@ -5948,17 +6273,7 @@ bool Literal8Section<A>::ignoreLabel(const char* label) const
 template <typename A>
 unsigned long Literal8Section<A>::contentHash(const class Atom<A>* atom, const ld::IndirectBindingTable& ind) const
 {
-#if __LP64__
-	const uint64_t* literalContent = (uint64_t*)atom->contentPointer();
-	return *literalContent;
-#else
-	unsigned long hash = 5381;
-	const uint8_t* byteContent = atom->contentPointer();
-	for (int i=0; i < 8; ++i) {
-		hash = hash * 33 + byteContent[i];
-	}
-	return hash;
-#endif
+	return ld::hashBytes(atom->contentPointer(), 8);
 }
 
 template <typename A>
@@ -5988,12 +6303,7 @@ bool Literal16Section<A>::ignoreLabel(const char* label) const
 template <typename A>
 unsigned long Literal16Section<A>::contentHash(const class Atom<A>* atom, const ld::IndirectBindingTable& ind) const
 {
-	unsigned long hash = 5381;
-	const uint8_t* byteContent = atom->contentPointer();
-	for (int i=0; i < 16; ++i) {
-		hash = hash * 33 + byteContent[i];
-	}
-	return hash;
+	return ld::hashBytes(atom->contentPointer(), 16);
 }
 
 template <typename A>
@@ -6047,14 +6357,37 @@ Atom<A>* CStringSection<A>::findAtomByAddress(pint_t addr)
 template <typename A>
 unsigned long CStringSection<A>::contentHash(const class Atom<A>* atom, const ld::IndirectBindingTable& ind) const
 {
-	unsigned long hash = 5381;
-	const char* stringContent = (char*)atom->contentPointer();
-	for (const char* s = stringContent; *s != '\0'; ++s) {
-		hash = hash * 33 + *s;
+	size_t length;
+	return ld::hashCString((char*)atom->contentPointer(), length);
+}
+
+
+template <typename A>
+void CStringSection<A>::addToLiteralPool(ld::LiteralPool& pool)
+{
+	// strings in other cstring sections are coalesced per section by the SymbolTable
+	if ( this->type() != ld::Section::typeCString )
+		return;
+	std::vector<uint32_t>& indexes = this->file()._literalPoolIndexes;
+	_poolIndexStart = (uint32_t)indexes.size();
+	indexes.reserve(indexes.size() + (this->_endAtoms - this->_beginAtoms));
+	for (Atom<A>* atom = this->_beginAtoms; atom < this->_endAtoms; ++atom) {
+		const char* stringContent = (char*)atom->contentPointer();
+		size_t length;
+		atom->_hash = ld::hashCString(stringContent, length);
+		indexes.push_back(pool.intern(stringContent, atom->_size, atom->_hash));
 	}
-	return hash;
+	_pooled = true;
 }
 
+template <typename A>
+bool CStringSection<A>::literalPoolIndex(const class Atom<A>* atom, uint32_t& index) const
+{
+	if ( !_pooled )
+		return false;
+	index = this->file()._literalPoolIndexes[_poolIndexStart + (atom - this->_beginAtoms)];
+	return true;
+}
 
 template <typename A>
 bool CStringSection<A>::canCoalesceWith(const class Atom<A>* atom, const ld::Atom& rhs, 
@@ -6072,8 +6405,9 @@ bool CStringSection<A>::canCoalesceWith(const class Atom<A>* atom, const ld::Ato
 	if ( rhsAtom != NULL ) {
 		if ( atom->_size != rhsAtom->_size )
 			return false;
+		// same size, so the terminating zeros line up
 		const char* rhsStringContent = (char*)rhsAtom->contentPointer();
-		return (strcmp(stringContent, rhsStringContent) == 0);
+		return (memcmp(stringContent, rhsStringContent, atom->_size) == 0);
 	}
 	return false;
 }
@@ -6400,23 +6734,15 @@ unsigned long CFStringSection<A>::contentHash(const class Atom<A>* atom, const l
 {
 	// base hash of CFString on hash of cstring it wraps
 	ContentType cType;
-	unsigned long hash;
 	unsigned int charCount;
 	const uint8_t* content = this->targetContent(atom, ind, &cType, &charCount);
 	switch ( cType ) {
 		case contentUTF8:
-			hash = 9408;
-			for (const char* s = (char*)content; *s != '\0'; ++s) {
-				hash = hash * 33 + *s;
-			}
-			return hash;
+			// count is the size of the cstring atom, which includes the trailing zero
+			return ld::hashBytes(content, charCount-1, 9408);
 		case contentUTF16:
-			hash = 407955;
-			--charCount; // don't add last 0x0000 to hash because some buggy compilers only have trailing single byte
-			for (const uint16_t* s = (uint16_t*)content; charCount > 0; ++s, --charCount) {
-				hash = hash * 1025 + *s;
-			}
-			return hash;
+			// don't add last 0x0000 to hash because some buggy compilers only have trailing single byte
+			return ld::hashBytes(content, (charCount-1)*sizeof(uint16_t), 407955);
 		case contentUnknown:
 			// <rdar://problem/14134211> For malformed CFStrings, hash to address of atom so they have unique hashes
 			return ULONG_MAX - (unsigned long)(atom);
@@ -6464,7 +6790,7 @@ bool CFStringSection<A>::canCoalesceWith(const class Atom<A>* atom, const ld::At
 
 	switch ( thisType ) {
 		case contentUTF8:
-			return (strcmp((char*)cstringContent, (char*)rhsStringContent) == 0);
+			return (memcmp(cstringContent, rhsStringContent, charCount) == 0);
 		case contentUTF16:
 			{
 				const uint16_t* cstringContent16 = (uint16_t*)cstringContent;
@@ -6637,14 +6963,9 @@ unsigned long PointerToCStringSection<A>::contentHash(const class Atom<A>* atom,
 													const ld::IndirectBindingTable& indirectBindingTable) const
 {
 	// make hash from section name and target cstring name
-	unsigned long hash = 123;
-	for (const char* s = this->sectionName(); *s != '\0'; ++s) {
-		hash = hash * 33 + *s;
-	}
-	for (const char* s = this->targetCString(atom, indirectBindingTable); *s != '\0'; ++s) {
-		hash = hash * 33 + *s;
-	}
-	return hash;
+	size_t length;
+	unsigned long hash = ld::hashCString(this->sectionName(), length, 123);
+	return ld::hashCString(this->targetCString(atom, indirectBindingTable), length, hash);
 }
 
 template <typename A>
@@ -6673,14 +6994,9 @@ bool PointerToCStringSection<A>::canCoalesceWith(const class Atom<A>* atom, cons
 template <typename A>
 unsigned long UTF16StringSection<A>::contentHash(const class Atom<A>* atom, const ld::IndirectBindingTable& ind) const
 {
-	unsigned long hash = 5381;
-	const uint16_t* stringContent = (uint16_t*)atom->contentPointer();
 	// some buggy compilers end utf16 data with single byte, so don't use last word in hash computation
 	unsigned int count = (atom->size()/2) - 1;
-	for (const uint16_t* s = stringContent; count > 0; ++s, --count) {
-		hash = hash * 33 + *s;
-	}
-	return hash;
+	return ld::hashBytes(atom->contentPointer(), count*sizeof(uint16_t), 5381);
 }
 
 template <typename A>
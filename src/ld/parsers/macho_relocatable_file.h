@@ -27,6 +27,7 @@
 
 #include "ld.hpp"
 #include "Options.h"
+#include "LiteralPool.hpp"
 
 namespace mach_o {
 namespace relocatable {
@@ -53,6 +54,9 @@ struct ParserOptions {
 	bool			internalSDK;
 	bool			forceHidden;
 	bool			platformMismatchesAreWarning;
+	const char*		parseCacheDir;		// NULL means don't cache parse results
+	uint64_t		parseCacheMaxSize;	// bytes parseCacheDir is pruned to after a link adds to it
+	ld::LiteralPool* literalPool;		// NULL means cstrings are pooled later by the SymbolTable
 };
 
 extern ld::relocatable::File* parse(const uint8_t* fileContent, uint64_t fileLength, 
@@ -61,6 +65,10 @@ extern ld::relocatable::File* parse(const uint8_t* fileContent, uint64_t fileLen
 									
 extern bool isObjectFile(const uint8_t* fileContent, uint64_t fileLength, const ParserOptions& opts);
 
+extern void parseCacheCounts(uint32_t& hits, uint32_t& misses, uint64_t& time);
+
+extern void memoryCounts(uint64_t& atomBytes, uint64_t& fixupBytes, uint64_t& unwindAndLineInfoBytes);
+
 extern bool isObjectFile(const uint8_t* fileContent, uint64_t fileLength, cpu_type_t* result, cpu_subtype_t* subResult, ld::VersionSet& platformsFound);
 
 extern bool hasObjC2Categories(const uint8_t* fileContent);					
@@ -42,6 +42,7 @@ public:
 	virtual uint64_t						objectAddress() const			{ return 0; }
 	virtual void							copyRawContent(uint8_t buffer[]) const
 																			{ memcpy(buffer, _content, _size); }
+	virtual const uint8_t*					rawContentPointer() const		{ return _content; }
 	virtual void							setScope(Scope)					{ }
 
 protected:
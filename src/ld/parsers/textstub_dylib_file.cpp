@@ -25,11 +25,17 @@
 
 #include <sys/param.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <CommonCrypto/CommonDigest.h>
 #include <tapi/tapi.h>
 #include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
 
 #include "Architectures.hpp"
 #include "Bitcode.hpp"
+#include "CacheDirectory.hpp"
 #include "MachOFileAbstraction.hpp"
 #include "MachOTrie.hpp"
 #include "generic_dylib_file.hpp"
@@ -39,6 +45,259 @@
 namespace textstub {
 namespace dylib {
 
+//
+// Everything File needs from a text stub.  Filled in either from tapi or from a
+// TextStubCache entry, strings are owned by whichever of those produced it.
+//
+struct StubInfo
+{
+	struct Export { const char* name; bool weakDef; bool tlv; };
+
+	const char*					installName;
+	const char*					parentUmbrella;		// nullptr if none
+	uint32_t					currentVersion;
+	uint32_t					compatibilityVersion;
+	uint8_t						swiftVersion;
+	bool						hasReexports;
+	bool						hasWeakDefinedExports;
+	bool						installNameVersionSpecific;
+	bool						appExtensionSafe;
+	bool						hasAllowableClients;
+	ld::VersionSet				platforms;
+	std::vector<const char*>	allowableClients;
+	std::vector<const char*>	reexports;
+	std::vector<const char*>	ignoreExports;
+	std::vector<Export>			exports;
+};
+
+
+//
+// On disk cache of parsed text stubs (-tbd_cache_path).  SDK .tbd files are large and the
+// same across many links, so the StubInfo for each is saved in a flat binary entry that
+// later links mmap instead of having tapi parse the YAML again.  Entries are keyed by the
+// tbd path, mtime to the nanosecond, device, inode, and size, plus the arch, flags, and
+// min OS version given to tapi, so a tbd rewritten within the same second is still a miss.
+// Least recently used entries are removed to keep the directory under -tbd_cache_size.
+//
+class TextStubCache
+{
+public:
+						TextStubCache(const Options& opts, const char* path, uint64_t fileLength,
+									  cpu_type_t cpuType, cpu_subtype_t cpuSubType, uint32_t parsingFlags, uint32_t minOSVersion);
+						~TextStubCache();
+	bool				enabled() const		{ return (_dir != nullptr); }
+	bool				lookup(StubInfo& info);
+	void				store(const StubInfo& info);
+
+	static std::atomic<uint32_t>	sHits;
+	static std::atomic<uint32_t>	sMisses;
+
+private:
+	bool				readEntry(StubInfo& info);
+
+	enum { kMagic = 0x63627464, kVersion = 2 };	// 'dtbc'
+	enum { kHasReexports=1, kHasWeakDefinedExports=2, kInstallNameVersionSpecific=4, kAppExtensionSafe=8,
+			kHasAllowableClients=16, kHasParentUmbrella=32 };
+	enum { kExportWeakDef=1, kExportTLV=2 };
+
+	// followed by uint32_t platforms[], uint32_t stringOffsets[] (clients, then reexports,
+	// then ignored exports), uint32_t exports[] (string offset << 2 | kExport* bits), strings
+	struct Header {
+		uint32_t		magic;
+		uint32_t		version;
+		uint32_t		flags;
+		uint32_t		currentVersion;
+		uint32_t		compatibilityVersion;
+		uint32_t		swiftVersion;
+		uint32_t		keyOffset;
+		uint32_t		installNameOffset;
+		uint32_t		parentUmbrellaOffset;
+		uint32_t		platformCount;
+		uint32_t		allowableClientCount;
+		uint32_t		reexportCount;
+		uint32_t		ignoreExportCount;
+		uint32_t		exportCount;
+		uint32_t		stringPoolSize;
+	};
+
+	const char*			_dir;
+	uint64_t			_maxSize;
+	std::string			_key;
+	char				_fileName[CC_SHA256_DIGEST_LENGTH*2+1];
+	void*				_mapping;
+	size_t				_mappingSize;
+};
+
+
+TextStubCache::TextStubCache(const Options& opts, const char* path, uint64_t fileLength,
+							 cpu_type_t cpuType, cpu_subtype_t cpuSubType, uint32_t parsingFlags, uint32_t minOSVersion)
+	: _dir(opts.tbdCachePath()), _maxSize(opts.tbdCacheMaxSize()), _mapping(nullptr), _mappingSize(0)
+{
+	if ( _dir == nullptr )
+		return;
+	// the modification time ld::File keeps is whole seconds, so stat for the full time stamp
+	struct stat statBuffer;
+	if ( ::stat(path, &statBuffer) != 0 ) {
+		_dir = nullptr;
+		return;
+	}
+	char buffer[PATH_MAX+192];
+	snprintf(buffer, sizeof(buffer), "%s|%ld.%09ld|%llu|%llu|%llu|%d|%d|%u|%u|%d", path, (long)statBuffer.st_mtimespec.tv_sec,
+			(long)statBuffer.st_mtimespec.tv_nsec, (uint64_t)statBuffer.st_dev, (uint64_t)statBuffer.st_ino, fileLength,
+			cpuType, cpuSubType, parsingFlags, minOSVersion, kVersion);
+	_key = buffer;
+	uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256(_key.c_str(), (CC_LONG)_key.size(), digest);
+	for (int i=0; i < CC_SHA256_DIGEST_LENGTH; ++i)
+		sprintf(&_fileName[i*2], "%02x", digest[i]);
+}
+
+TextStubCache::~TextStubCache()
+{
+	if ( _mapping != nullptr )
+		::munmap(_mapping, _mappingSize);
+}
+
+std::atomic<uint32_t> TextStubCache::sHits(0);
+std::atomic<uint32_t> TextStubCache::sMisses(0);
+
+bool TextStubCache::lookup(StubInfo& info)
+{
+	if ( readEntry(info) ) {
+		++sHits;
+		return true;
+	}
+	++sMisses;
+	return false;
+}
+
+bool TextStubCache::readEntry(StubInfo& info)
+{
+	_mapping = ld::cache_directory::mapEntry(_dir, _fileName, _mappingSize);
+	if ( (_mapping == nullptr) || (_mappingSize <= sizeof(Header)) )
+		return false;
+
+	// anything that does not look exactly right is a miss, and will be overwritten
+	const Header* header = (Header*)_mapping;
+	if ( (header->magic != kMagic) || (header->version != kVersion) )
+		return false;
+	const uint64_t tableCount = (uint64_t)header->platformCount + header->allowableClientCount + header->reexportCount
+								+ header->ignoreExportCount + header->exportCount;
+	if ( sizeof(Header) + tableCount*sizeof(uint32_t) + header->stringPoolSize != _mappingSize )
+		return false;
+	const uint32_t* platforms = (uint32_t*)&header[1];
+	const uint32_t* stringOffsets = &platforms[header->platformCount];
+	const uint32_t* exports = &stringOffsets[header->allowableClientCount + header->reexportCount + header->ignoreExportCount];
+	const char* strings = (char*)&exports[header->exportCount];
+	const uint32_t poolSize = header->stringPoolSize;
+	if ( (poolSize == 0) || (strings[poolSize-1] != '\0') )
+		return false;
+	auto string = [&](uint32_t offset) -> const char* { return (offset < poolSize) ? &strings[offset] : nullptr; };
+	const char* key = string(header->keyOffset);
+	if ( (key == nullptr) || (_key != key) )
+		return false;
+
+	info.installName				= string(header->installNameOffset);
+	info.parentUmbrella				= (header->flags & kHasParentUmbrella) ? string(header->parentUmbrellaOffset) : nullptr;
+	info.currentVersion				= header->currentVersion;
+	info.compatibilityVersion		= header->compatibilityVersion;
+	info.swiftVersion				= header->swiftVersion;
+	info.hasReexports				= (header->flags & kHasReexports);
+	info.hasWeakDefinedExports		= (header->flags & kHasWeakDefinedExports);
+	info.installNameVersionSpecific	= (header->flags & kInstallNameVersionSpecific);
+	info.appExtensionSafe			= (header->flags & kAppExtensionSafe);
+	info.hasAllowableClients		= (header->flags & kHasAllowableClients);
+	if ( (info.installName == nullptr) || ((header->flags & kHasParentUmbrella) && (info.parentUmbrella == nullptr)) )
+		return false;
+	for (uint32_t i=0; i < header->platformCount; ++i) {
+		if ( info.platforms.contains((ld::Platform)platforms[i]) )
+			return false;
+		info.platforms.insert((ld::Platform)platforms[i]);
+	}
+	std::vector<const char*>* lists[] = { &info.allowableClients, &info.reexports, &info.ignoreExports };
+	const uint32_t counts[] = { header->allowableClientCount, header->reexportCount, header->ignoreExportCount };
+	for (int l=0; l < 3; ++l) {
+		lists[l]->reserve(counts[l]);
+		for (uint32_t i=0; i < counts[l]; ++i) {
+			const char* str = string(*stringOffsets++);
+			if ( str == nullptr )
+				return false;
+			lists[l]->push_back(str);
+		}
+	}
+	info.exports.reserve(header->exportCount);
+	for (uint32_t i=0; i < header->exportCount; ++i) {
+		const char* name = string(exports[i] >> 2);
+		if ( name == nullptr )
+			return false;
+		info.exports.push_back({ name, (exports[i] & kExportWeakDef) != 0, (exports[i] & kExportTLV) != 0 });
+	}
+	return true;
+}
+
+void TextStubCache::store(const StubInfo& info)
+{
+	std::string strings(1, '\0');
+	auto addString = [&](const char* str) -> uint32_t {
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(str);
+		strings.push_back('\0');
+		return offset;
+	};
+
+	Header header;
+	header.magic				= kMagic;
+	header.version				= kVersion;
+	header.flags				= (info.hasReexports ? kHasReexports : 0)
+								| (info.hasWeakDefinedExports ? kHasWeakDefinedExports : 0)
+								| (info.installNameVersionSpecific ? kInstallNameVersionSpecific : 0)
+								| (info.appExtensionSafe ? kAppExtensionSafe : 0)
+								| (info.hasAllowableClients ? kHasAllowableClients : 0)
+								| ((info.parentUmbrella != nullptr) ? kHasParentUmbrella : 0);
+	header.currentVersion		= info.currentVersion;
+	header.compatibilityVersion	= info.compatibilityVersion;
+	header.swiftVersion			= info.swiftVersion;
+	header.keyOffset			= addString(_key.c_str());
+	header.installNameOffset	= addString(info.installName);
+	header.parentUmbrellaOffset	= (info.parentUmbrella != nullptr) ? addString(info.parentUmbrella) : 0;
+	header.platformCount		= (uint32_t)info.platforms.count();
+	header.allowableClientCount	= (uint32_t)info.allowableClients.size();
+	header.reexportCount		= (uint32_t)info.reexports.size();
+	header.ignoreExportCount	= (uint32_t)info.ignoreExports.size();
+	header.exportCount			= (uint32_t)info.exports.size();
+
+	std::vector<uint32_t> table;
+	table.reserve(header.platformCount + header.allowableClientCount + header.reexportCount
+				  + header.ignoreExportCount + header.exportCount);
+	std::vector<uint32_t>* tablePtr = &table;
+	info.platforms.forEach(^(ld::Platform platform, uint32_t minVersion, uint32_t sdkVersion, bool& stop) {
+		tablePtr->push_back((uint32_t)platform);
+	});
+	for (const std::vector<const char*>* list : { &info.allowableClients, &info.reexports, &info.ignoreExports }) {
+		for (const char* str : *list)
+			table.push_back(addString(str));
+	}
+	for (const StubInfo::Export& exp : info.exports) {
+		uint32_t offset = addString(exp.name);
+		if ( offset >= (1U << 30) )
+			return;	// too big to encode, just don't cache it
+		table.push_back((offset << 2) | (exp.weakDef ? kExportWeakDef : 0) | (exp.tlv ? kExportTLV : 0));
+	}
+	header.stringPoolSize		= (uint32_t)strings.size();
+
+	const std::vector<ld::cache_directory::Piece> pieces = {
+		{ &header, sizeof(Header) },
+		{ table.data(), table.size()*sizeof(uint32_t) },
+		{ strings.data(), strings.size() }
+	};
+	if ( !ld::cache_directory::storeEntry(_dir, _fileName, pieces) )
+		return;
+
+	// trim the cache at most once per link, after it is first added to
+	static std::once_flag sPruned;
+	std::call_once(sPruned, [this]() { ld::cache_directory::prune(_dir, _maxSize); });
+}
+
 //
 // The reader for a dylib extracts all exported symbols names from the memory-mapped
 // dylib, builds a hash table, then unmaps the file.  This is an important memory
@@ -70,13 +329,15 @@ public:
 	
 	// overrides of generic::dylib::File
 	virtual void	processIndirectLibraries(ld::dylib::File::DylibHandler*, bool addImplicitDylibs) override final;
+	virtual void	forEachInlinedDylib(void (^handler)(const char* installPath)) const override final;
 
 private:
-	void				init(tapi::LinkerInterfaceFile* file, const Options *opts, bool buildingForSimulator,
+	void				init(const StubInfo& info, const tapi::LinkerInterfaceFile* file, const Options *opts, bool buildingForSimulator,
 									 bool indirectDylib, bool linkingFlatNamespace, bool linkingMainExecutable,
 									 const char *path, const ld::VersionSet& platforms, const char *targetInstallPath,
 									 bool usingBitcode, bool internalSDK, bool fromSDK, bool platformMismatchesAreWarning);
-	void				buildExportHashTable(const tapi::LinkerInterfaceFile* file);
+	void				buildExportHashTable(const StubInfo& info);
+	static void			stubInfoFromInterface(const tapi::LinkerInterfaceFile* file, StubInfo& info);
 	static bool useSimulatorVariant();
 	
 	const Options* _opts;
@@ -160,6 +421,20 @@ File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength,
 			linkMinOSVersion = minVersion;
 	});
 
+	// use the result of parsing this same tbd in an earlier link, if it was cached
+	const uint32_t cacheFlags = (enforceDylibSubtypesMatch ? 1 : 0) | (allowWeakImports ? 0 : 2);
+	TextStubCache cache(*opts, path, fileLength, cpuType, cpuSubType, cacheFlags, linkMinOSVersion);
+	StubInfo info;
+	if ( cache.enabled() && cache.lookup(info) ) {
+		_interface = nullptr;
+		munmap((caddr_t)fileContent, fileLength);
+		if ( logAllFiles )
+			printf("%s\n", path);
+		init(info, nullptr, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
+			 linkingMainExecutable, path, platforms, targetInstallPath, usingBitcode, internalSDK, fromSDK, platformMismatchesAreWarning);
+		return;
+	}
+
 // <rdar://problem/29038544> Support $ld$weak symbols in .tbd files
 #if ((TAPI_API_VERSION_MAJOR == 1 &&  TAPI_API_VERSION_MINOR >= 3) || (TAPI_API_VERSION_MAJOR > 1))
 	// Check if the library supports the new create API.
@@ -191,8 +466,13 @@ File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength,
 	if ( logAllFiles )
 		printf("%s\n", path);
 
-	init(_interface, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
+	stubInfoFromInterface(_interface, info);
+	init(info, _interface, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
 		 linkingMainExecutable, path, platforms, targetInstallPath, usingBitcode, internalSDK, fromSDK, platformMismatchesAreWarning);
+
+	// tbds with inlined frameworks or flat namespace need the tapi interface later, so aren't cached
+	if ( cache.enabled() && _interface->hasTwoLevelNamespace() && _interface->inlinedFrameworkNames().empty() )
+		cache.store(info);
 }
 
 	template<typename A>
@@ -207,26 +487,63 @@ File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength,
 	: Base(strdup(path), mTime, ordinal, platforms, allowWeakImports, linkingFlatNamespace,
 		   hoistImplicitPublicDylibs, allowSimToMacOSX, addVers), _interface(file)
 {
-	init(_interface, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
+	StubInfo info;
+	stubInfoFromInterface(_interface, info);
+	init(info, _interface, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
 		 linkingMainExecutable, path, platforms, installPath, usingBitcode, internalSDK, fromSDK, platformMismatchesAreWarning);
 }
-	
+
+template<typename A>
+void File<A>::stubInfoFromInterface(const tapi::LinkerInterfaceFile* file, StubInfo& info)
+{
+	info.installName				= file->getInstallName().c_str();
+	info.parentUmbrella				= file->getParentFrameworkName().empty() ? nullptr : file->getParentFrameworkName().c_str();
+	info.currentVersion				= file->getCurrentVersion();
+	info.compatibilityVersion		= file->getCompatibilityVersion();
+	info.swiftVersion				= file->getSwiftVersion();
+	info.hasReexports				= file->hasReexportedLibraries();
+	info.hasWeakDefinedExports		= file->hasWeakDefinedExports();
+	info.installNameVersionSpecific	= file->isInstallNameVersionSpecific();
+	info.appExtensionSafe			= file->isApplicationExtensionSafe();
+	info.hasAllowableClients		= file->hasAllowableClients();
+
+#if ((TAPI_API_VERSION_MAJOR == 1 &&  TAPI_API_VERSION_MINOR >= 6) || (TAPI_API_VERSION_MAJOR > 1))
+	if (tapi::APIVersion::isAtLeast(1, 6)) {
+		for (const auto &platform : file->getPlatformSet())
+			info.platforms.insert((ld::Platform)platform);
+	} else
+#endif
+	{
+		info.platforms = mapPlatform(file->getPlatform(), useSimulatorVariant());
+	}
+
+	for (const auto &client : file->allowableClients())
+		info.allowableClients.push_back(client.c_str());
+	for (const auto& reexport : file->reexportedLibraries())
+		info.reexports.push_back(reexport.c_str());
+	for (const auto& symbol : file->ignoreExports())
+		info.ignoreExports.push_back(symbol.c_str());
+	info.exports.reserve(file->exports().size());
+	for (const auto &sym : file->exports())
+		info.exports.push_back({ sym.getName().c_str(), sym.isWeakDefined(), sym.isThreadLocalValue() });
+}
+
 template<typename A>
-void File<A>::init(tapi::LinkerInterfaceFile* file, const Options *opts, bool buildingForSimulator,
+void File<A>::init(const StubInfo& info, const tapi::LinkerInterfaceFile* file, const Options *opts, bool buildingForSimulator,
 				   bool indirectDylib, bool linkingFlatNamespace, bool linkingMainExecutable,
 				   const char *path, const ld::VersionSet& cmdLinePlatforms, const char *targetInstallPath,
 				   bool usingBitcode, bool internalSDK, bool fromSDK, bool platformMismatchesAreWarning) {
 	_opts = opts;
 	this->_bitcode = std::unique_ptr<ld::Bitcode>(new ld::Bitcode(nullptr, 0));
-	this->_noRexports = !file->hasReexportedLibraries();
-	this->_hasWeakExports = file->hasWeakDefinedExports();
-	this->_dylibInstallPath = strdup(file->getInstallName().c_str());
-	this->_installPathOverride = file->isInstallNameVersionSpecific();
-	this->_dylibCurrentVersion = file->getCurrentVersion();
-	this->_dylibCompatibilityVersion = file->getCompatibilityVersion();
-	this->_swiftVersion = file->getSwiftVersion();
-	this->_parentUmbrella = file->getParentFrameworkName().empty() ? nullptr : strdup(file->getParentFrameworkName().c_str());
-	this->_appExtensionSafe = file->isApplicationExtensionSafe();
+	this->_noRexports = !info.hasReexports;
+	this->_hasWeakExports = info.hasWeakDefinedExports;
+	this->_dylibInstallPath = strdup(info.installName);
+	this->_installPathOverride = info.installNameVersionSpecific;
+	this->_dylibCurrentVersion = info.currentVersion;
+	this->_dylibCompatibilityVersion = info.compatibilityVersion;
+	this->_swiftVersion = info.swiftVersion;
+	this->_parentUmbrella = (info.parentUmbrella == nullptr) ? nullptr : strdup(info.parentUmbrella);
+	this->_appExtensionSafe = info.appExtensionSafe;
 
 	// if framework, capture framework name
 	const char* lastSlash = strrchr(this->_dylibInstallPath, '/');
@@ -240,40 +557,30 @@ void File<A>::init(tapi::LinkerInterfaceFile* file, const Options *opts, bool bu
 			this->_frameworkName = leafName;
 	}
 	
-	for (auto &client : file->allowableClients())
-		this->_allowableClients.push_back(strdup(client.c_str()));
+	for (const char* client : info.allowableClients)
+		this->_allowableClients.push_back(strdup(client));
 	
 	// <rdar://problem/20659505> [TAPI] Don't hoist "public" (in /usr/lib/) dylibs that should not be directly linked
-	this->_hasPublicInstallName = file->hasAllowableClients() ? false : this->isPublicLocation(file->getInstallName().c_str());
+	this->_hasPublicInstallName = info.hasAllowableClients ? false : this->isPublicLocation(info.installName);
 	
-	for (const auto &client : file->allowableClients())
-		this->_allowableClients.emplace_back(strdup(client.c_str()));
-
-	ld::VersionSet lcPlatforms;
-#if ((TAPI_API_VERSION_MAJOR == 1 &&  TAPI_API_VERSION_MINOR >= 6) || (TAPI_API_VERSION_MAJOR > 1))
-	if (tapi::APIVersion::isAtLeast(1, 6)) {
-		for (const auto &platform : file->getPlatformSet())
-			lcPlatforms.insert((ld::Platform)platform);
-	} else
-#endif
-	{
-		lcPlatforms = mapPlatform(file->getPlatform(), useSimulatorVariant());
-	}
+	for (const char* client : info.allowableClients)
+		this->_allowableClients.emplace_back(strdup(client));
 
 	// check cross-linking
-	cmdLinePlatforms.checkDylibCrosslink(lcPlatforms, path, ".tbd", internalSDK, indirectDylib, usingBitcode, _isUnzipperedTwin, _dylibInstallPath, fromSDK, platformMismatchesAreWarning);
+	cmdLinePlatforms.checkDylibCrosslink(info.platforms, path, ".tbd", internalSDK, indirectDylib, usingBitcode, _isUnzipperedTwin, _dylibInstallPath, fromSDK, platformMismatchesAreWarning);
 
-	for (const auto& reexport : file->reexportedLibraries()) {
-		const char *path = strdup(reexport.c_str());
+	for (const char* reexport : info.reexports) {
+		const char *path = strdup(reexport);
 		if ( (targetInstallPath == nullptr) || (strcmp(targetInstallPath, path) != 0) )
 			this->_dependentDylibs.emplace_back(path, true);
 	}
 	
-	for (const auto& symbol : file->ignoreExports())
-		this->_ignoreExports.insert(strdup(symbol.c_str()));
+	for (const char* symbol : info.ignoreExports)
+		this->_ignoreExports.insert(strdup(symbol));
 	
 	// if linking flat and this is a flat dylib, create one atom that references all imported symbols.
-	if ( linkingFlatNamespace && linkingMainExecutable && (file->hasTwoLevelNamespace() == false) ) {
+	// (only tbds with two level namespace are cached, so file is always set for flat ones)
+	if ( linkingFlatNamespace && linkingMainExecutable && (file != nullptr) && (file->hasTwoLevelNamespace() == false) ) {
 		std::vector<const char*> importNames;
 		importNames.reserve(file->undefineds().size());
 		// We do not need to strdup the name, because that will be done by the
@@ -284,20 +591,17 @@ void File<A>::init(tapi::LinkerInterfaceFile* file, const Options *opts, bool bu
 	}
 	
 	// build hash table
-	buildExportHashTable(file);
+	buildExportHashTable(info);
 }
 
 template <typename A>
-void File<A>::buildExportHashTable(const tapi::LinkerInterfaceFile* file) {
+void File<A>::buildExportHashTable(const StubInfo& info) {
 	if (this->_s_logHashtable )
 		fprintf(stderr, "ld: building hashtable from text-stub info in %s\n", this->path());
 
-	for (const auto &sym : file->exports()) {
-		const char* name = sym.getName().c_str();
-		bool weakDef = sym.isWeakDefined();
-		bool tlv = sym.isThreadLocalValue();
-		addExportedSymbol(name, weakDef, tlv, 0);
-	}
+	this->reservedSymbolSpace(info.exports.size());
+	for (const StubInfo::Export& exp : info.exports)
+		addExportedSymbol(exp.name, exp.weakDef, exp.tlv, 0);
 }
 
 template <typename A>
@@ -307,6 +611,17 @@ void File<A>::processIndirectLibraries(ld::dylib::File::DylibHandler* handler, b
 	Base::processIndirectLibraries(handler, addImplicitDylibs);
 }
 
+template <typename A>
+void File<A>::forEachInlinedDylib(void (^handler)(const char* installPath)) const {
+	// must match what addTAPIInterface() registers
+#if ((TAPI_API_VERSION_MAJOR == 1 &&  TAPI_API_VERSION_MINOR >= 3) || (TAPI_API_VERSION_MAJOR > 1))
+	if ( (_interface != nullptr) && tapi::APIVersion::isAtLeast(1, 3) ) {
+		for (auto &name : _interface->inlinedFrameworkNames())
+			handler(name.c_str());
+	}
+#endif
+}
+
 template <typename A>
 class Parser
 {
@@ -330,7 +645,7 @@ public:
 						   opts.allowSimulatorToLinkWithMacOSX(),
 						   opts.addVersionLoadCommand(),
 						   opts.targetIOSSimulator(),
-						   opts.logAllFiles(),
+						   false,
 						   opts.installPath(),
 						   indirectDylib,
 						   opts.bundleBitcode(),
@@ -355,7 +670,7 @@ public:
 						   opts.allowSimulatorToLinkWithMacOSX(),
 						   opts.addVersionLoadCommand(),
 						   opts.targetIOSSimulator(),
-						   opts.logAllFiles(),
+						   false,
 						   opts.installPath(),
 						   indirectDylib,
 						   opts.bundleBitcode(),
@@ -467,6 +782,12 @@ ld::dylib::File *parse(const char *path, tapi::LinkerInterfaceFile* file, time_t
 }
 
 
+void cacheCounts(uint32_t& hits, uint32_t& misses)
+{
+	hits = TextStubCache::sHits;
+	misses = TextStubCache::sMisses;
+}
+
 bool isTextStubFile(const uint8_t* fileContent, uint64_t fileLength, const char* path) {
 	return tapi::LinkerInterfaceFile::isSupported(path, fileContent, fileLength);
 }
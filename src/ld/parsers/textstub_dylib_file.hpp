@@ -41,6 +41,9 @@ extern ld::dylib::File *parse(const char *path, tapi::LinkerInterfaceFile* file,
 
 extern bool isTextStubFile(const uint8_t* fileContent, uint64_t fileLength, const char* path);
 
+// -tbd_cache_path hits and misses so far, for -print_statistics
+extern void cacheCounts(uint32_t& hits, uint32_t& misses);
+
 } // namespace dylib
 } // namespace textstub
 
@@ -30,8 +30,11 @@
 #include <mach/machine.h>
 #include <mach-o/compact_unwind_encoding.h>
 
+#include <dispatch/dispatch.h>
+
 #include <vector>
-#include <map>
+#include <unordered_map>
+#include <algorithm>
 
 #include "ld.hpp"
 #include "compact_unwind.h"
@@ -44,20 +47,6 @@ namespace passes {
 namespace compact_unwind {
 
 
-struct UnwindEntry { 
-						UnwindEntry(const ld::Atom* f, uint64_t a, uint32_t o, const ld::Atom* d, 
-															const ld::Atom* l, const ld::Atom* p, uint32_t en)
-							: func(f), fde(d), lsda(l), personalityPointer(p), funcTentAddress(a), 
-								functionOffset(o), encoding(en) { }
-	const ld::Atom*				func; 
-	const ld::Atom*				fde; 
-	const ld::Atom*				lsda; 
-	const ld::Atom*				personalityPointer; 
-	uint64_t					funcTentAddress;
-	uint32_t					functionOffset;
-	compact_unwind_encoding_t	encoding; 
-};
-
 struct LSDAEntry { 
 	const ld::Atom*		func; 
 	const ld::Atom*		lsda; 
@@ -86,25 +75,40 @@ private:
 
 	typedef macho_unwind_info_compressed_second_level_page_header<P> CSLP;
 
+	typedef std::unordered_map<compact_unwind_encoding_t, unsigned int>	EncodingToIndex;
+	typedef std::unordered_map<const ld::Atom*, uint32_t>				AtomToOffset;
+
+	struct SecondLevelPage {
+		unsigned int							startIndex;				// first uniqueEntries index on page
+		unsigned int							endIndex;				// uniqueEntries index after last entry on page
+		uint8_t*								pageStart;
+		bool									compressed;
+		std::vector<compact_unwind_encoding_t>	pageSpecificEncodings;	// in encoding index order, after common encodings
+		std::vector<ld::Fixup>					fixups;
+	};
+
 	bool						encodingMeansUseDwarf(compact_unwind_encoding_t enc);
 	bool						encodingCannotBeMerged(compact_unwind_encoding_t enc);
 	void						compressDuplicates(const std::vector<UnwindEntry>& entries,
 													std::vector<UnwindEntry>& uniqueEntries);
 	void						makePersonalityIndexes(std::vector<UnwindEntry>& entries, 
-														std::map<const ld::Atom*, uint32_t>& personalityIndexMap);
-	void						findCommonEncoding(const std::vector<UnwindEntry>& entries, 
-													std::map<compact_unwind_encoding_t, unsigned int>& commonEncodings);
+														std::vector<const ld::Atom*>& personalities);
+	void						findCommonEncoding(const std::vector<UnwindEntry>& entries, EncodingToIndex& commonEncodings,
+													std::vector<compact_unwind_encoding_t>& commonEncodingsList);
 	void						makeLsdaIndex(const std::vector<UnwindEntry>& entries, std::vector<LSDAEntry>& lsdaIndex, 
-																std::map<const ld::Atom*, uint32_t>& lsdaIndexOffsetMap);
-	unsigned int				makeCompressedSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos,   
-													const std::map<compact_unwind_encoding_t,unsigned int> commonEncodings,  
-													uint32_t pageSize, unsigned int endIndex, uint8_t*& pageEnd);
-	unsigned int				makeRegularSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos, uint32_t pageSize,  
-															unsigned int endIndex, uint8_t*& pageEnd);
-	void						addCompressedAddressOffsetFixup(uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc);
-	void						addCompressedEncodingFixup(uint32_t offset, const ld::Atom* fde);
-	void						addRegularAddressFixup(uint32_t offset, const ld::Atom* func);
-	void						addRegularFDEOffsetFixup(uint32_t offset, const ld::Atom* fde);
+																AtomToOffset& lsdaIndexOffsetMap);
+	unsigned int				layoutCompressedSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos,   
+													const EncodingToIndex& commonEncodings, uint32_t pageSize,
+													unsigned int endIndex, uint8_t*& pageEnd, SecondLevelPage& page);
+	unsigned int				layoutRegularSecondLevelPage(uint32_t pageSize, unsigned int endIndex, uint8_t*& pageEnd,
+															SecondLevelPage& page);
+	void						fillCompressedSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos,
+													const EncodingToIndex& commonEncodings, SecondLevelPage& page);
+	void						fillRegularSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos, SecondLevelPage& page);
+	void						addCompressedAddressOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc);
+	void						addCompressedEncodingFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde);
+	void						addRegularAddressFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func);
+	void						addRegularFDEOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde);
 	void						addImageOffsetFixup(uint32_t offset, const ld::Atom* targ);
 	void						addImageOffsetFixupPlusAddend(uint32_t offset, const ld::Atom* targ, uint32_t addend);
 
@@ -142,18 +146,19 @@ UnwindInfoAtom<A>::UnwindInfoAtom(const std::vector<UnwindEntry>& entries, uint6
 	_fixups.reserve(uniqueEntries.size()*3);
 
 	// build personality index, update encodings with personality index
-	std::map<const ld::Atom*, uint32_t>	personalityIndexMap;
-	makePersonalityIndexes(uniqueEntries, personalityIndexMap);
-	if ( personalityIndexMap.size() > 3 ) {
+	std::vector<const ld::Atom*> personalities;
+	makePersonalityIndexes(uniqueEntries, personalities);
+	if ( personalities.size() > 3 ) {
 		throw "too many personality routines for compact unwind to encode";
 	}
 
 	// put the most common encodings into the common table, but at most 127 of them
-	std::map<compact_unwind_encoding_t, unsigned int> commonEncodings;
-	findCommonEncoding(uniqueEntries, commonEncodings);
+	EncodingToIndex commonEncodings;
+	std::vector<compact_unwind_encoding_t> commonEncodingsList;
+	findCommonEncoding(uniqueEntries, commonEncodings, commonEncodingsList);
 	
 	// build lsda index
-	std::map<const ld::Atom*, uint32_t> lsdaIndexOffsetMap;
+	AtomToOffset lsdaIndexOffsetMap;
 	std::vector<LSDAEntry>	lsdaIndex;
 	makeLsdaIndex(uniqueEntries, lsdaIndex, lsdaIndexOffsetMap);
 	
@@ -176,18 +181,15 @@ UnwindInfoAtom<A>::UnwindInfoAtom(const std::vector<UnwindEntry>& entries, uint6
 		maxLastPageSize = 4096;
 	}
 	
-	// fill in pages in reverse order
-	const ld::Atom* secondLevelFirstFuncs[pageCount*3];
-	uint8_t* secondLevelPagesStarts[pageCount*3];
+	// lay out pages in reverse order
+	std::vector<SecondLevelPage> secondLevelPages;
+	secondLevelPages.reserve(pageCount);
 	unsigned int endIndex = uniqueEntries.size();
-	unsigned int secondLevelPageCount = 0;
 	uint8_t* pageEnd = &_pageAlignedPages[pageCount*4096];
 	uint32_t pageSize = maxLastPageSize;
 	while ( endIndex > 0 ) {
-		endIndex = makeCompressedSecondLevelPage(uniqueEntries, commonEncodings, pageSize, endIndex, pageEnd);
-		secondLevelPagesStarts[secondLevelPageCount] = pageEnd;
-		secondLevelFirstFuncs[secondLevelPageCount] = uniqueEntries[endIndex].func;
-		++secondLevelPageCount;
+		secondLevelPages.push_back(SecondLevelPage());
+		endIndex = layoutCompressedSecondLevelPage(uniqueEntries, commonEncodings, pageSize, endIndex, pageEnd, secondLevelPages.back());
 		// if this requires more than one page, align so that next starts on page boundary
 		if ( (pageSize != 4096) && (endIndex > 0) ) {
 			pageEnd = (uint8_t*)((uintptr_t)(pageEnd) & -4096);
@@ -196,13 +198,28 @@ UnwindInfoAtom<A>::UnwindInfoAtom(const std::vector<UnwindEntry>& entries, uint6
 	}
 	_pages = pageEnd;
 	_pagesSize = &_pageAlignedPages[pageCount*4096] - pageEnd;
+	const unsigned int secondLevelPageCount = secondLevelPages.size();
+
+	// page boundaries and encodings are now fixed, so each page can be filled in independently
+	SecondLevelPage* const pages = &secondLevelPages[0];
+	const std::vector<UnwindEntry>* const infos = &uniqueEntries;
+	const EncodingToIndex* const common = &commonEncodings;
+	dispatch_apply(secondLevelPageCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+		if ( pages[i].compressed )
+			this->fillCompressedSecondLevelPage(*infos, *common, pages[i]);
+		else
+			this->fillRegularSecondLevelPage(*infos, pages[i]);
+	});
+	// gather page fixups in the order the pages were laid out
+	for (const SecondLevelPage& page : secondLevelPages)
+		_fixups.insert(_fixups.end(), page.fixups.begin(), page.fixups.end());
 
 	// calculate section layout
 	const uint32_t commonEncodingsArraySectionOffset = sizeof(macho_unwind_info_section_header<P>);
 	const uint32_t commonEncodingsArrayCount = commonEncodings.size();
 	const uint32_t commonEncodingsArraySize = commonEncodingsArrayCount * sizeof(compact_unwind_encoding_t);
 	const uint32_t personalityArraySectionOffset = commonEncodingsArraySectionOffset + commonEncodingsArraySize;
-	const uint32_t personalityArrayCount = personalityIndexMap.size();
+	const uint32_t personalityArrayCount = personalities.size();
 	const uint32_t personalityArraySize = personalityArrayCount * sizeof(uint32_t);
 	const uint32_t indexSectionOffset = personalityArraySectionOffset + personalityArraySize;
 	const uint32_t indexCount = secondLevelPageCount+1;
@@ -233,26 +250,27 @@ UnwindInfoAtom<A>::UnwindInfoAtom(const std::vector<UnwindEntry>& entries, uint6
 	
 	// copy common encodings
 	uint32_t* commonEncodingsTable = (uint32_t*)&_header[commonEncodingsArraySectionOffset];
-	for (std::map<uint32_t, unsigned int>::iterator it=commonEncodings.begin(); it != commonEncodings.end(); ++it)
-		E::set32(commonEncodingsTable[it->second], it->first);
+	for (unsigned int i=0; i < commonEncodingsArrayCount; ++i)
+		E::set32(commonEncodingsTable[i], commonEncodingsList[i]);
 		
 	// make references for personality entries
 	uint32_t* personalityArray = (uint32_t*)&_header[sectionHeader->personalityArraySectionOffset()];
-	for (std::map<const ld::Atom*, unsigned int>::iterator it=personalityIndexMap.begin(); it != personalityIndexMap.end(); ++it) {
-		uint32_t offset = (uint8_t*)&personalityArray[it->second-1] - _header;
-		this->addImageOffsetFixup(offset, it->first);
+	for (unsigned int i=0; i < personalityArrayCount; ++i) {
+		uint32_t offset = (uint8_t*)&personalityArray[i] - _header;
+		this->addImageOffsetFixup(offset, personalities[i]);
 	}
 
 	// build first level index and references
 	macho_unwind_info_section_header_index_entry<P>* indexTable = (macho_unwind_info_section_header_index_entry<P>*)&_header[indexSectionOffset];
 	uint32_t refOffset;
 	for (unsigned int i=0; i < secondLevelPageCount; ++i) {
-		unsigned int reverseIndex = secondLevelPageCount - 1 - i;
+		const SecondLevelPage& page = secondLevelPages[secondLevelPageCount - 1 - i];
+		const ld::Atom* firstFunc = uniqueEntries[page.startIndex].func;
 		indexTable[i].set_functionOffset(0);
-		indexTable[i].set_secondLevelPagesSectionOffset(secondLevelPagesStarts[reverseIndex]-_pages+headerEndSectionOffset);
-		indexTable[i].set_lsdaIndexArraySectionOffset(lsdaIndexOffsetMap[secondLevelFirstFuncs[reverseIndex]]+lsdaIndexArraySectionOffset); 
+		indexTable[i].set_secondLevelPagesSectionOffset(page.pageStart-_pages+headerEndSectionOffset);
+		indexTable[i].set_lsdaIndexArraySectionOffset(lsdaIndexOffsetMap[firstFunc]+lsdaIndexArraySectionOffset); 
 		refOffset = (uint8_t*)&indexTable[i] - _header;
-		this->addImageOffsetFixup(refOffset, secondLevelFirstFuncs[reverseIndex]);
+		this->addImageOffsetFixup(refOffset, firstFunc);
 	}
 	indexTable[secondLevelPageCount].set_functionOffset(0);
 	indexTable[secondLevelPageCount].set_secondLevelPagesSectionOffset(0);
@@ -362,62 +380,66 @@ void UnwindInfoAtom<A>::compressDuplicates(const std::vector<UnwindEntry>& entri
 }
 
 template <typename A>
-void UnwindInfoAtom<A>::makePersonalityIndexes(std::vector<UnwindEntry>& entries, std::map<const ld::Atom*, uint32_t>& personalityIndexMap)
+void UnwindInfoAtom<A>::makePersonalityIndexes(std::vector<UnwindEntry>& entries, std::vector<const ld::Atom*>& personalities)
 {
+	// personality index is one based, and there are only ever a handful, so a linear search is fastest
 	for(std::vector<UnwindEntry>::iterator it=entries.begin(); it != entries.end(); ++it) {
 		if ( it->personalityPointer != NULL ) {
-			std::map<const ld::Atom*, uint32_t>::iterator pos = personalityIndexMap.find(it->personalityPointer);
-			if ( pos == personalityIndexMap.end() ) {
-				const uint32_t nextIndex = personalityIndexMap.size() + 1;
-				personalityIndexMap[it->personalityPointer] = nextIndex;
+			std::vector<const ld::Atom*>::iterator pos = std::find(personalities.begin(), personalities.end(), it->personalityPointer);
+			if ( pos == personalities.end() ) {
+				personalities.push_back(it->personalityPointer);
+				pos = personalities.end() - 1;
 			}
-			uint32_t personalityIndex = personalityIndexMap[it->personalityPointer];
+			uint32_t personalityIndex = (uint32_t)(pos - personalities.begin()) + 1;
 			it->encoding |= (personalityIndex << (__builtin_ctz(UNWIND_PERSONALITY_MASK)) );
 		}
 	}
-	if (_s_log) fprintf(stderr, "makePersonalityIndexes() %lu personality routines used\n", personalityIndexMap.size()); 
+	if (_s_log) fprintf(stderr, "makePersonalityIndexes() %lu personality routines used\n", personalities.size()); 
 }
 
 
 template <typename A>
-void UnwindInfoAtom<A>::findCommonEncoding(const std::vector<UnwindEntry>& entries, 
-											std::map<compact_unwind_encoding_t, unsigned int>& commonEncodings)
+void UnwindInfoAtom<A>::findCommonEncoding(const std::vector<UnwindEntry>& entries, EncodingToIndex& commonEncodings,
+											std::vector<compact_unwind_encoding_t>& commonEncodingsList)
 {
 	// scan infos to get frequency counts for each encoding
-	std::map<compact_unwind_encoding_t, unsigned int> encodingsUsed;
-	unsigned int mostCommonEncodingUsageCount = 0;
+	EncodingToIndex encodingsUsed;
 	for(std::vector<UnwindEntry>::const_iterator it=entries.begin(); it != entries.end(); ++it) {
 		// never put dwarf into common table
 		if ( encodingMeansUseDwarf(it->encoding) )
 			continue;
-		std::map<compact_unwind_encoding_t, unsigned int>::iterator pos = encodingsUsed.find(it->encoding);
-		if ( pos == encodingsUsed.end() ) {
-			encodingsUsed[it->encoding] = 1;
-		}
-		else {
-			encodingsUsed[it->encoding] += 1;
-			if ( mostCommonEncodingUsageCount < encodingsUsed[it->encoding] )
-				mostCommonEncodingUsageCount = encodingsUsed[it->encoding];
-		}
+		encodingsUsed[it->encoding] += 1;
+	}
+	// order candidates by most used first, then by encoding value, which is the order the common table has always used
+	std::vector<std::pair<compact_unwind_encoding_t, unsigned int>> candidates;
+	candidates.reserve(encodingsUsed.size());
+	for (const auto& usage : encodingsUsed) {
+		if ( usage.second > 1 )
+			candidates.push_back(usage);
 	}
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<compact_unwind_encoding_t, unsigned int>& left,
+													   const std::pair<compact_unwind_encoding_t, unsigned int>& right) {
+		if ( left.second != right.second )
+			return (left.second > right.second);
+		return (left.first < right.first);
+	});
 	// put the most common encodings into the common table, but at most 127 of them
-	for(unsigned int usages=mostCommonEncodingUsageCount; usages > 1; --usages) {
-		for (std::map<compact_unwind_encoding_t, unsigned int>::iterator euit=encodingsUsed.begin(); euit != encodingsUsed.end(); ++euit) {
-			if ( euit->second == usages ) {
-				unsigned int sz = commonEncodings.size();
-				if ( sz < 127 ) {
-					commonEncodings[euit->first] = sz;
-				}
-			}
-		}
+	if ( candidates.size() > 127 )
+		candidates.resize(127);
+	commonEncodings.reserve(candidates.size());
+	commonEncodingsList.reserve(candidates.size());
+	for (const auto& candidate : candidates) {
+		commonEncodings[candidate.first] = commonEncodingsList.size();
+		commonEncodingsList.push_back(candidate.first);
 	}
 	if (_s_log) fprintf(stderr, "findCommonEncoding() %lu common encodings found\n", commonEncodings.size()); 
 }
 
 
 template <typename A>
-void UnwindInfoAtom<A>::makeLsdaIndex(const std::vector<UnwindEntry>& entries, std::vector<LSDAEntry>& lsdaIndex, std::map<const ld::Atom*, uint32_t>& lsdaIndexOffsetMap)
+void UnwindInfoAtom<A>::makeLsdaIndex(const std::vector<UnwindEntry>& entries, std::vector<LSDAEntry>& lsdaIndex, AtomToOffset& lsdaIndexOffsetMap)
 {
+	lsdaIndexOffsetMap.reserve(entries.size());
 	for(std::vector<UnwindEntry>::const_iterator it=entries.begin(); it != entries.end(); ++it) {
 		lsdaIndexOffsetMap[it->func] = lsdaIndex.size() * sizeof(unwind_info_section_header_lsda_index_entry);
 		if ( it->lsda != NULL ) {
@@ -432,164 +454,164 @@ void UnwindInfoAtom<A>::makeLsdaIndex(const std::vector<UnwindEntry>& entries, s
 
 
 template <>
-void UnwindInfoAtom<x86>::addCompressedAddressOffsetFixup(uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
+void UnwindInfoAtom<x86>::addCompressedAddressOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<x86_64>::addCompressedAddressOffsetFixup(uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
+void UnwindInfoAtom<x86_64>::addCompressedAddressOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<arm64>::addCompressedAddressOffsetFixup(uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
+void UnwindInfoAtom<arm64>::addCompressedAddressOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 #if SUPPORT_ARCH_arm64_32
 template <>
-void UnwindInfoAtom<arm64_32>::addCompressedAddressOffsetFixup(uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
+void UnwindInfoAtom<arm64_32>::addCompressedAddressOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 #endif
 
 template <>
-void UnwindInfoAtom<arm>::addCompressedAddressOffsetFixup(uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
+void UnwindInfoAtom<arm>::addCompressedAddressOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func, const ld::Atom* fromFunc)
 {
 	if ( fromFunc->isThumb() ) {
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of4, ld::Fixup::kindSetTargetAddress, func));
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of4, ld::Fixup::kindSubtractTargetAddress, fromFunc));
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of4, ld::Fixup::kindSubtractAddend, 1));
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k4of4, ld::Fixup::kindStoreLittleEndianLow24of32));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of4, ld::Fixup::kindSetTargetAddress, func));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of4, ld::Fixup::kindSubtractTargetAddress, fromFunc));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of4, ld::Fixup::kindSubtractAddend, 1));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k4of4, ld::Fixup::kindStoreLittleEndianLow24of32));
 	}
 	else {
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
-		_fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of3, ld::Fixup::kindSetTargetAddress, func));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of3, ld::Fixup::kindSubtractTargetAddress, fromFunc));
+		fixups.push_back(ld::Fixup(offset, ld::Fixup::k3of3, ld::Fixup::kindStoreLittleEndianLow24of32));
 	}
 }
 
 template <>
-void UnwindInfoAtom<x86>::addCompressedEncodingFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<x86>::addCompressedEncodingFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<x86_64>::addCompressedEncodingFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<x86_64>::addCompressedEncodingFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<arm64>::addCompressedEncodingFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<arm64>::addCompressedEncodingFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 #if SUPPORT_ARCH_arm64_32
 template <>
-void UnwindInfoAtom<arm64_32>::addCompressedEncodingFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<arm64_32>::addCompressedEncodingFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 #endif
 
 template <>
-void UnwindInfoAtom<arm>::addCompressedEncodingFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<arm>::addCompressedEncodingFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<x86>::addRegularAddressFixup(uint32_t offset, const ld::Atom* func)
+void UnwindInfoAtom<x86>::addRegularAddressFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
 }
 
 template <>
-void UnwindInfoAtom<x86_64>::addRegularAddressFixup(uint32_t offset, const ld::Atom* func)
+void UnwindInfoAtom<x86_64>::addRegularAddressFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
 }
 
 template <>
-void UnwindInfoAtom<arm64>::addRegularAddressFixup(uint32_t offset, const ld::Atom* func)
+void UnwindInfoAtom<arm64>::addRegularAddressFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
 }
 
 #if SUPPORT_ARCH_arm64_32
 template <>
-void UnwindInfoAtom<arm64_32>::addRegularAddressFixup(uint32_t offset, const ld::Atom* func)
+void UnwindInfoAtom<arm64_32>::addRegularAddressFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
 }
 #endif
 
 template <>
-void UnwindInfoAtom<arm>::addRegularAddressFixup(uint32_t offset, const ld::Atom* func)
+void UnwindInfoAtom<arm>::addRegularAddressFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* func)
 {
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
-	_fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of2, ld::Fixup::kindSetTargetImageOffset, func));
+	fixups.push_back(ld::Fixup(offset, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndian32));
 }
 
 template <>
-void UnwindInfoAtom<x86>::addRegularFDEOffsetFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<x86>::addRegularFDEOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<x86_64>::addRegularFDEOffsetFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<x86_64>::addRegularFDEOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
-void UnwindInfoAtom<arm64>::addRegularFDEOffsetFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<arm64>::addRegularFDEOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 #if SUPPORT_ARCH_arm64_32
 template <>
-void UnwindInfoAtom<arm64_32>::addRegularFDEOffsetFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<arm64_32>::addRegularFDEOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 #endif
 
 template <>
-void UnwindInfoAtom<arm>::addRegularFDEOffsetFixup(uint32_t offset, const ld::Atom* fde)
+void UnwindInfoAtom<arm>::addRegularFDEOffsetFixup(std::vector<ld::Fixup>& fixups, uint32_t offset, const ld::Atom* fde)
 {
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
-	_fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k1of2, ld::Fixup::kindSetTargetSectionOffset, fde));
+	fixups.push_back(ld::Fixup(offset+4, ld::Fixup::k2of2, ld::Fixup::kindStoreLittleEndianLow24of32));
 }
 
 template <>
@@ -675,51 +697,65 @@ void UnwindInfoAtom<arm>::addImageOffsetFixupPlusAddend(uint32_t offset, const l
 
 
 template <typename A>
-unsigned int UnwindInfoAtom<A>::makeRegularSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos, uint32_t pageSize,  
-															unsigned int endIndex, uint8_t*& pageEnd)
+unsigned int UnwindInfoAtom<A>::layoutRegularSecondLevelPage(uint32_t pageSize, unsigned int endIndex, uint8_t*& pageEnd,
+															SecondLevelPage& page)
 {
 	const unsigned int maxEntriesPerPage = (pageSize - sizeof(unwind_info_regular_second_level_page_header))/sizeof(unwind_info_regular_second_level_entry);
 	const unsigned int entriesToAdd = ((endIndex > maxEntriesPerPage) ? maxEntriesPerPage : endIndex);
-	uint8_t* pageStart = pageEnd 
+	page.compressed = false;
+	page.startIndex = endIndex - entriesToAdd;
+	page.endIndex = endIndex;
+	page.pageStart = pageEnd 
 						- entriesToAdd*sizeof(unwind_info_regular_second_level_entry) 
 						- sizeof(unwind_info_regular_second_level_page_header);
-	macho_unwind_info_regular_second_level_page_header<P>* page = (macho_unwind_info_regular_second_level_page_header<P>*)pageStart;
-	page->set_kind(UNWIND_SECOND_LEVEL_REGULAR);
-	page->set_entryPageOffset(sizeof(macho_unwind_info_regular_second_level_page_header<P>));
-	page->set_entryCount(entriesToAdd);
-	macho_unwind_info_regular_second_level_entry<P>* entryTable = (macho_unwind_info_regular_second_level_entry<P>*)(pageStart + page->entryPageOffset());
-	for (unsigned int i=0; i < entriesToAdd; ++i) {
-		const UnwindEntry& info = uniqueInfos[endIndex-entriesToAdd+i];
+	page.pageSpecificEncodings.clear();
+	if (_s_log) fprintf(stderr, "regular page with %u entries\n", entriesToAdd);
+	pageEnd = page.pageStart;
+	return page.startIndex;
+}
+
+
+template <typename A>
+void UnwindInfoAtom<A>::fillRegularSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos, SecondLevelPage& page)
+{
+	const unsigned int entryCount = page.endIndex - page.startIndex;
+	macho_unwind_info_regular_second_level_page_header<P>* pageHeader = (macho_unwind_info_regular_second_level_page_header<P>*)page.pageStart;
+	pageHeader->set_kind(UNWIND_SECOND_LEVEL_REGULAR);
+	pageHeader->set_entryPageOffset(sizeof(macho_unwind_info_regular_second_level_page_header<P>));
+	pageHeader->set_entryCount(entryCount);
+	macho_unwind_info_regular_second_level_entry<P>* entryTable = (macho_unwind_info_regular_second_level_entry<P>*)(page.pageStart + pageHeader->entryPageOffset());
+	page.fixups.reserve(entryCount*2);
+	for (unsigned int i=0; i < entryCount; ++i) {
+		const UnwindEntry& info = uniqueInfos[page.startIndex+i];
 		entryTable[i].set_functionOffset(0);
 		entryTable[i].set_encoding(info.encoding);
 		// add fixup for address part of entry
 		uint32_t offset = (uint8_t*)(&entryTable[i]) - _pageAlignedPages;
-		this->addRegularAddressFixup(offset, info.func);
+		this->addRegularAddressFixup(page.fixups, offset, info.func);
 		if ( encodingMeansUseDwarf(info.encoding) ) {
 			// add fixup for dwarf offset part of page specific encoding
 			uint32_t encOffset = (uint8_t*)(&entryTable[i]) - _pageAlignedPages;
-			this->addRegularFDEOffsetFixup(encOffset, info.fde);
+			this->addRegularFDEOffsetFixup(page.fixups, encOffset, info.fde);
 		}
 	}
-	if (_s_log) fprintf(stderr, "regular page with %u entries\n", entriesToAdd);
-	pageEnd = pageStart;
-	return endIndex - entriesToAdd;
 }
 
 
 template <typename A>
-unsigned int UnwindInfoAtom<A>::makeCompressedSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos,   
-													const std::map<compact_unwind_encoding_t,unsigned int> commonEncodings,  
-													uint32_t pageSize, unsigned int endIndex, uint8_t*& pageEnd)
+unsigned int UnwindInfoAtom<A>::layoutCompressedSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos,   
+													const EncodingToIndex& commonEncodings, uint32_t pageSize,
+													unsigned int endIndex, uint8_t*& pageEnd, SecondLevelPage& page)
 {
-	if (_s_log) fprintf(stderr, "makeCompressedSecondLevelPage(pageSize=%u, endIndex=%u)\n", pageSize, endIndex);
-	// first pass calculates how many compressed entries we could fit in this sized page
+	if (_s_log) fprintf(stderr, "layoutCompressedSecondLevelPage(pageSize=%u, endIndex=%u)\n", pageSize, endIndex);
+	// calculate how many compressed entries we could fit in this sized page
 	// keep adding entries to page until:
 	//  1) encoding table plus entry table plus header exceed page size
 	//  2) the file offset delta from the first to last function > 24 bits
 	//  3) custom encoding index reaches 255
 	//  4) run out of uniqueInfos to encode
-	std::map<compact_unwind_encoding_t, unsigned int> pageSpecificEncodings;
+	EncodingToIndex pageSpecificEncodings;
+	pageSpecificEncodings.reserve(256);
+	page.pageSpecificEncodings.clear();
 	uint32_t space4 =  (pageSize - sizeof(unwind_info_compressed_second_level_page_header))/sizeof(uint32_t);
 	int index = endIndex-1;
 	int entryCount = 0;
@@ -729,10 +765,10 @@ unsigned int UnwindInfoAtom<A>::makeCompressedSecondLevelPage(const std::vector<
 		const UnwindEntry& info = uniqueInfos[index--];
 		// compute encoding index
 		unsigned int encodingIndex;
-		std::map<compact_unwind_encoding_t, unsigned int>::const_iterator pos = commonEncodings.find(info.encoding);
+		typename EncodingToIndex::const_iterator pos = commonEncodings.find(info.encoding);
 		if ( pos != commonEncodings.end() ) {
 			encodingIndex = pos->second;
-			if (_s_log) fprintf(stderr, "makeCompressedSecondLevelPage(): funcIndex=%d, re-use commonEncodings[%d]=0x%08X\n", index, encodingIndex, info.encoding);
+			if (_s_log) fprintf(stderr, "layoutCompressedSecondLevelPage(): funcIndex=%d, re-use commonEncodings[%d]=0x%08X\n", index, encodingIndex, info.encoding);
 		}
 		else {
 			// no commmon entry, so add one on this page
@@ -741,16 +777,17 @@ unsigned int UnwindInfoAtom<A>::makeCompressedSecondLevelPage(const std::vector<
 				// make unique pseudo encoding so this dwarf will gets is own encoding entry slot
 				encoding += (index+1);
 			}
-			std::map<compact_unwind_encoding_t, unsigned int>::iterator ppos = pageSpecificEncodings.find(encoding);
+			typename EncodingToIndex::iterator ppos = pageSpecificEncodings.find(encoding);
 			if ( ppos != pageSpecificEncodings.end() ) {
-				encodingIndex = pos->second;
-				if (_s_log) fprintf(stderr, "makeCompressedSecondLevelPage(): funcIndex=%d, re-use pageSpecificEncodings[%d]=0x%08X\n", index, encodingIndex, encoding);
+				encodingIndex = ppos->second;
+				if (_s_log) fprintf(stderr, "layoutCompressedSecondLevelPage(): funcIndex=%d, re-use pageSpecificEncodings[%d]=0x%08X\n", index, encodingIndex, encoding);
 			}
 			else {
 				encodingIndex = commonEncodings.size() + pageSpecificEncodings.size();
 				if ( encodingIndex <= 255 ) {
 					pageSpecificEncodings[encoding] = encodingIndex;
-					if (_s_log) fprintf(stderr, "makeCompressedSecondLevelPage(): funcIndex=%d, pageSpecificEncodings[%d]=0x%08X\n", index, encodingIndex, encoding);
+					page.pageSpecificEncodings.push_back(encoding);
+					if (_s_log) fprintf(stderr, "layoutCompressedSecondLevelPage(): funcIndex=%d, pageSpecificEncodings[%d]=0x%08X\n", index, encodingIndex, encoding);
 				}
 				else {
 					canDo = false; // case 3)
@@ -785,7 +822,7 @@ unsigned int UnwindInfoAtom<A>::makeCompressedSecondLevelPage(const std::vector<
 	if ( (compressPageUsed < (pageSize-4) && (index >= 0) ) ) {
 		const int regularEntriesPerPage = (pageSize - sizeof(unwind_info_regular_second_level_page_header))/sizeof(unwind_info_regular_second_level_entry);
 		if ( entryCount < regularEntriesPerPage ) {
-			return makeRegularSecondLevelPage(uniqueInfos, pageSize, endIndex, pageEnd);
+			return layoutRegularSecondLevelPage(pageSize, endIndex, pageEnd, page);
 		}
 	}
 	
@@ -794,54 +831,75 @@ unsigned int UnwindInfoAtom<A>::makeCompressedSecondLevelPage(const std::vector<
 	if ( compressPageUsed == (pageSize-4) )
 		pad = 4;
 
-	// second pass fills in page 
-	uint8_t* pageStart = pageEnd - compressPageUsed - pad;
-	CSLP* page = (CSLP*)pageStart;
-	page->set_kind(UNWIND_SECOND_LEVEL_COMPRESSED);
-	page->set_entryPageOffset(sizeof(CSLP));
-	page->set_entryCount(entryCount);
-	page->set_encodingsPageOffset(page->entryPageOffset()+entryCount*sizeof(uint32_t));
-	page->set_encodingsCount(pageSpecificEncodings.size());
-	uint32_t* const encodingsArray = (uint32_t*)&pageStart[page->encodingsPageOffset()];
+	page.compressed = true;
+	page.startIndex = endIndex - entryCount;
+	page.endIndex = endIndex;
+	page.pageStart = pageEnd - compressPageUsed - pad;
+	if (_s_log) fprintf(stderr, "compressed page with %u entries, %lu custom encodings\n", entryCount, pageSpecificEncodings.size());
+	
+	// update pageEnd;
+	pageEnd = page.pageStart;
+	return page.startIndex;  // endIndex for next page
+}
+
+
+template <typename A>
+void UnwindInfoAtom<A>::fillCompressedSecondLevelPage(const std::vector<UnwindEntry>& uniqueInfos,
+												const EncodingToIndex& commonEncodings, SecondLevelPage& page)
+{
+	// rebuild lookup of the encodings chosen for this page during layout
+	EncodingToIndex pageSpecificEncodings;
+	pageSpecificEncodings.reserve(page.pageSpecificEncodings.size());
+	for (unsigned int i=0; i < page.pageSpecificEncodings.size(); ++i)
+		pageSpecificEncodings[page.pageSpecificEncodings[i]] = commonEncodings.size() + i;
+
+	const unsigned int entryCount = page.endIndex - page.startIndex;
+	uint8_t* const pageStart = page.pageStart;
+	CSLP* pageHeader = (CSLP*)pageStart;
+	pageHeader->set_kind(UNWIND_SECOND_LEVEL_COMPRESSED);
+	pageHeader->set_entryPageOffset(sizeof(CSLP));
+	pageHeader->set_entryCount(entryCount);
+	pageHeader->set_encodingsPageOffset(pageHeader->entryPageOffset()+entryCount*sizeof(uint32_t));
+	pageHeader->set_encodingsCount(page.pageSpecificEncodings.size());
+	uint32_t* const encodingsArray = (uint32_t*)&pageStart[pageHeader->encodingsPageOffset()];
 	// fill in entry table
-	uint32_t* const entiresArray = (uint32_t*)&pageStart[page->entryPageOffset()];
-	const ld::Atom* firstFunc = uniqueInfos[endIndex-entryCount].func;
-	for(unsigned int i=endIndex-entryCount; i < endIndex; ++i) {
+	uint32_t* const entiresArray = (uint32_t*)&pageStart[pageHeader->entryPageOffset()];
+	const ld::Atom* firstFunc = uniqueInfos[page.startIndex].func;
+	page.fixups.reserve(entryCount*3);
+	for(unsigned int i=page.startIndex; i < page.endIndex; ++i) {
 		const UnwindEntry& info = uniqueInfos[i];
 		uint8_t encodingIndex;
 		if ( encodingMeansUseDwarf(info.encoding) ) {
 			// dwarf entries are always in page specific encodings
-			assert(pageSpecificEncodings.find(info.encoding+i) != pageSpecificEncodings.end());
-			encodingIndex = pageSpecificEncodings[info.encoding+i];
+			typename EncodingToIndex::const_iterator ppos = pageSpecificEncodings.find(info.encoding+i);
+			assert(ppos != pageSpecificEncodings.end());
+			encodingIndex = ppos->second;
 		}
 		else {
-			std::map<uint32_t, unsigned int>::const_iterator pos = commonEncodings.find(info.encoding);
-			if ( pos != commonEncodings.end() ) 
+			typename EncodingToIndex::const_iterator pos = commonEncodings.find(info.encoding);
+			if ( pos != commonEncodings.end() ) {
 				encodingIndex = pos->second;
-			else 
-				encodingIndex = pageSpecificEncodings[info.encoding];
+			}
+			else {
+				typename EncodingToIndex::const_iterator ppos = pageSpecificEncodings.find(info.encoding);
+				assert(ppos != pageSpecificEncodings.end());
+				encodingIndex = ppos->second;
+			}
 		}
-		uint32_t entryIndex = i - endIndex + entryCount;
+		uint32_t entryIndex = i - page.startIndex;
 		E::set32(entiresArray[entryIndex], encodingIndex << 24);
 		// add fixup for address part of entry
 		uint32_t offset = (uint8_t*)(&entiresArray[entryIndex]) - _pageAlignedPages;
-		this->addCompressedAddressOffsetFixup(offset, info.func, firstFunc);
+		this->addCompressedAddressOffsetFixup(page.fixups, offset, info.func, firstFunc);
 		if ( encodingMeansUseDwarf(info.encoding) ) {
 			// add fixup for dwarf offset part of page specific encoding
 			uint32_t encOffset = (uint8_t*)(&encodingsArray[encodingIndex-commonEncodings.size()]) - _pageAlignedPages;
-			this->addCompressedEncodingFixup(encOffset, info.fde);
+			this->addCompressedEncodingFixup(page.fixups, encOffset, info.fde);
 		}
 	}
 	// fill in encodings table
-	for(std::map<uint32_t, unsigned int>::const_iterator it = pageSpecificEncodings.begin(); it != pageSpecificEncodings.end(); ++it) {
-		E::set32(encodingsArray[it->second-commonEncodings.size()], it->first);
-	}
-	
-	if (_s_log) fprintf(stderr, "compressed page with %u entries, %lu custom encodings\n", entryCount, pageSpecificEncodings.size());
-	
-	// update pageEnd;
-	pageEnd = pageStart;
-	return endIndex-entryCount;  // endIndex for next page
+	for (unsigned int i=0; i < page.pageSpecificEncodings.size(); ++i)
+		E::set32(encodingsArray[i], page.pageSpecificEncodings[i]);
 }
 
 
@@ -975,36 +1033,41 @@ static void makeFinalLinkedImageCompactUnwindSection(const Options& opts, ld::In
 	uint64_t ehFrameSize = calculateEHFrameSize(state);
 
 	// create atom that contains the whole compact unwind table
-	switch ( opts.architecture() ) {
+#if SUPPORT_ARCH_arm_any
+	if ( (opts.architecture() == CPU_TYPE_ARM) && !opts.armUsesZeroCostExceptions() )
+		return;
+#endif
+	state.addAtom(*makeUnwindInfoAtom(opts.architecture(), entries, ehFrameSize));
+}
+
+
+ld::Atom* makeUnwindInfoAtom(cpu_type_t arch, const std::vector<UnwindEntry>& entries, uint64_t ehFrameSize)
+{
+	switch ( arch ) {
 #if SUPPORT_ARCH_x86_64
 		case CPU_TYPE_X86_64:
-			state.addAtom(*new UnwindInfoAtom<x86_64>(entries, ehFrameSize));
-			break;
+			return new UnwindInfoAtom<x86_64>(entries, ehFrameSize);
 #endif
 #if SUPPORT_ARCH_i386
 		case CPU_TYPE_I386:
-			state.addAtom(*new UnwindInfoAtom<x86>(entries, ehFrameSize));
-			break;
+			return new UnwindInfoAtom<x86>(entries, ehFrameSize);
 #endif
 #if SUPPORT_ARCH_arm64
 		case CPU_TYPE_ARM64:
-			state.addAtom(*new UnwindInfoAtom<arm64>(entries, ehFrameSize));
-			break;
+			return new UnwindInfoAtom<arm64>(entries, ehFrameSize);
 #endif
 #if SUPPORT_ARCH_arm64_32
 		case CPU_TYPE_ARM64_32:
-			state.addAtom(*new UnwindInfoAtom<arm64_32>(entries, ehFrameSize));
-			break;
+			return new UnwindInfoAtom<arm64_32>(entries, ehFrameSize);
 #endif
 #if SUPPORT_ARCH_arm_any
 		case CPU_TYPE_ARM:
-			if ( opts.armUsesZeroCostExceptions() )
-				state.addAtom(*new UnwindInfoAtom<arm>(entries, ehFrameSize));
-			break;
+			return new UnwindInfoAtom<arm>(entries, ehFrameSize);
 #endif
 		default:
 			assert(0 && "no compact unwind for arch");
 	}	
+	return NULL;
 }
 
 
@@ -26,6 +26,11 @@
 #ifndef __COMPACT_UNWIND_H__
 #define __COMPACT_UNWIND_H__
 
+#include <mach/machine.h>
+#include <mach-o/compact_unwind_encoding.h>
+
+#include <vector>
+
 #include "Options.h"
 #include "ld.hpp"
 
@@ -34,9 +39,26 @@ namespace ld {
 namespace passes {
 namespace compact_unwind {
 
+struct UnwindEntry { 
+						UnwindEntry(const ld::Atom* f, uint64_t a, uint32_t o, const ld::Atom* d, 
+															const ld::Atom* l, const ld::Atom* p, uint32_t en)
+							: func(f), fde(d), lsda(l), personalityPointer(p), funcTentAddress(a), 
+								functionOffset(o), encoding(en) { }
+	const ld::Atom*				func; 
+	const ld::Atom*				fde; 
+	const ld::Atom*				lsda; 
+	const ld::Atom*				personalityPointer; 
+	uint64_t					funcTentAddress;
+	uint32_t					functionOffset;
+	compact_unwind_encoding_t	encoding; 
+};
+
 // called by linker to add __unwind_info section table 
 extern void doPass(const Options& opts, ld::Internal& internal);
 
+// builds __unwind_info atom from entries sorted by address (also used by ld-bench)
+extern ld::Atom* makeUnwindInfoAtom(cpu_type_t arch, const std::vector<UnwindEntry>& entries, uint64_t ehFrameSize);
+
 
 } // namespace compact_unwind
 } // namespace passes 
@@ -0,0 +1,274 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <dispatch/dispatch.h>
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ld.hpp"
+#include "cstring_tail_merge.h"
+
+namespace ld {
+namespace passes {
+namespace cstring_tail_merge {
+
+
+//
+// Stands in for a cstring whose tail is the content of the atoms laid out after it.
+// Its address is the address of the whole string, but only the leading bytes that
+// no other string shares are in this atom.
+//
+class CStringPrefixAtom : public ld::Atom
+{
+public:
+										CStringPrefixAtom(const ld::Atom* string, uint64_t prefixSize) :
+											ld::Atom(string->section(), string->definition(), string->combine(),
+													string->scope(), string->contentType(), string->symbolTableInclusion(),
+													string->dontDeadStrip(), false, false, string->alignment()),
+											_string(string), _size(prefixSize) { setAttributesFromAtom(*string); }
+
+	virtual const ld::File*				file() const		{ return _string->file(); }
+	virtual const char*					name() const		{ return _string->name(); }
+	virtual uint64_t					size() const		{ return _size; }
+	virtual uint64_t					objectAddress() const { return _string->objectAddress(); }
+	virtual void						copyRawContent(uint8_t buffer[]) const
+															{ memcpy(buffer, _string->rawContentPointer(), _size); }
+	// the whole string, as the map file and other users of cstring content expect
+	virtual const uint8_t*				rawContentPointer() const { return _string->rawContentPointer(); }
+
+private:
+	const ld::Atom*						_string;
+	uint64_t							_size;
+};
+
+
+struct Entry {
+	const ld::Atom*		atom;
+	const char*			content;
+	uint32_t			length;		// not counting the trailing zero
+	uint32_t			order;		// position in section, to break ties
+};
+
+// orders strings by their content read backwards, so each string comes right before
+// the strings it is the tail of
+static bool reversedLessThan(const Entry& left, const Entry& right)
+{
+	const uint32_t count = std::min(left.length, right.length);
+	const uint8_t* l = (uint8_t*)left.content;
+	const uint8_t* r = (uint8_t*)right.content;
+	for (uint32_t i=1; i <= count; ++i) {
+		const uint8_t lc = l[left.length - i];
+		const uint8_t rc = r[right.length - i];
+		if ( lc != rc )
+			return (lc < rc);
+	}
+	if ( left.length != right.length )
+		return (left.length < right.length);
+	return (left.order < right.order);
+}
+
+static bool isTailOf(const Entry& tail, const Entry& string)
+{
+	if ( tail.length >= string.length )
+		return false;
+	return (memcmp(tail.content, &string.content[string.length - tail.length], tail.length) == 0);
+}
+
+// strings with symbols, fixups, or alignment are left where they are
+static bool canShareTail(const ld::Atom* atom)
+{
+	if ( atom->contentType() != ld::Atom::typeCString )
+		return false;
+	if ( atom->symbolTableInclusion() != ld::Atom::symbolTableNotIn )
+		return false;
+	if ( (atom->alignment().powerOf2 != 0) || (atom->alignment().modulus != 0) )
+		return false;
+	if ( atom->fixupsBegin() != atom->fixupsEnd() )
+		return false;
+	const char* content = (char*)atom->rawContentPointer();
+	const uint64_t size = atom->size();
+	if ( (content == NULL) || (size == 0) || (size > UINT32_MAX) )
+		return false;
+	// must be exactly one string
+	return (strnlen(content, size) == size-1);
+}
+
+static void sortReversed(std::vector<Entry>& entries)
+{
+	const size_t kEntriesPerChunk = 64*1024;
+	const size_t count = entries.size();
+	if ( count < 2*kEntriesPerChunk ) {
+		std::sort(entries.begin(), entries.end(), &reversedLessThan);
+		return;
+	}
+	// sort chunks in parallel, then merge pairs of runs in parallel until one run is left
+	Entry* data = &entries[0];
+	dispatch_apply((count + kEntriesPerChunk - 1)/kEntriesPerChunk, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunk) {
+		Entry* begin = &data[chunk*kEntriesPerChunk];
+		Entry* end = &data[std::min(count, (chunk+1)*kEntriesPerChunk)];
+		std::sort(begin, end, &reversedLessThan);
+	});
+	std::vector<Entry> scratch(count);
+	Entry* from = data;
+	Entry* to = &scratch[0];
+	for (size_t run = kEntriesPerChunk; run < count; run *= 2) {
+		dispatch_apply((count + 2*run - 1)/(2*run), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t pair) {
+			const size_t start = pair*2*run;
+			const size_t middle = std::min(count, start + run);
+			const size_t end = std::min(count, start + 2*run);
+			std::merge(&from[start], &from[middle], &from[middle], &from[end], &to[start], &reversedLessThan);
+		});
+		std::swap(from, to);
+	}
+	if ( from != data )
+		std::copy(from, from + count, data);
+}
+
+
+static uint64_t tailMergeSection(ld::Internal& state, ld::Internal::FinalSection* sect,
+								 std::unordered_map<const ld::Atom*, const ld::Atom*>& replacements, uint32_t& mergedCount)
+{
+	std::vector<Entry> entries;
+	entries.reserve(sect->atoms.size());
+	for (uint32_t i=0; i < sect->atoms.size(); ++i) {
+		const ld::Atom* atom = sect->atoms[i];
+		if ( !canShareTail(atom) )
+			continue;
+		Entry entry;
+		entry.atom		= atom;
+		entry.content	= (char*)atom->rawContentPointer();
+		entry.length	= (uint32_t)atom->size() - 1;
+		entry.order		= i;
+		entries.push_back(entry);
+	}
+	sortReversed(entries);
+
+	// After sorting, each run of strings where every string is the tail of the next one
+	// becomes one chain.  The chain is laid out longest first, each string only keeping
+	// the bytes in front of the next (shorter) string, and the shortest kept whole.
+	std::unordered_map<const ld::Atom*, std::vector<const ld::Atom*>> chainAtFirstAtom;
+	std::unordered_set<const ld::Atom*> inChain;
+	uint64_t savedBytes = 0;
+	for (size_t start=0; start < entries.size(); ) {
+		size_t end = start + 1;
+		while ( (end < entries.size()) && isTailOf(entries[end-1], entries[end]) )
+			++end;
+		if ( end - start > 1 ) {
+			std::vector<const ld::Atom*> chain;
+			uint32_t firstOrder = entries[start].order;
+			for (size_t i=end-1; i > start; --i) {
+				const ld::Atom* prefix = new CStringPrefixAtom(entries[i].atom, entries[i].length - entries[i-1].length);
+				replacements[entries[i].atom] = prefix;
+				chain.push_back(prefix);
+				firstOrder = std::min(firstOrder, entries[i].order);
+				savedBytes += entries[i-1].length + 1;
+			}
+			chain.push_back(entries[start].atom);
+			for (size_t i=start; i < end; ++i)
+				inChain.insert(entries[i].atom);
+			chainAtFirstAtom[sect->atoms[firstOrder]].swap(chain);
+			mergedCount += (end - start - 1);
+		}
+		start = end;
+	}
+	if ( savedBytes == 0 )
+		return 0;
+
+	// each chain goes where the earliest of its strings was
+	std::vector<const ld::Atom*> newAtoms;
+	newAtoms.reserve(sect->atoms.size());
+	for (const ld::Atom* atom : sect->atoms) {
+		if ( inChain.count(atom) == 0 ) {
+			newAtoms.push_back(atom);
+			continue;
+		}
+		auto pos = chainAtFirstAtom.find(atom);
+		if ( pos == chainAtFirstAtom.end() )
+			continue;
+		for (const ld::Atom* chainAtom : pos->second) {
+			newAtoms.push_back(chainAtom);
+			state.atomToSection[chainAtom] = sect;
+		}
+	}
+	sect->atoms.swap(newAtoms);
+	return savedBytes;
+}
+
+
+void doPass(const Options& opts, ld::Internal& state)
+{
+	// only tail merge in final linked images
+	if ( opts.outputKind() == Options::kObjectFile )
+		return;
+
+	// support -tail_merge_cstrings to run this pass
+	if ( ! opts.tailMergeCStrings() )
+		return;
+
+	std::unordered_map<const ld::Atom*, const ld::Atom*> replacements;
+	for (ld::Internal::FinalSection* sect : state.sections) {
+		if ( sect->type() != ld::Section::typeCString )
+			continue;
+		uint32_t mergedCount = 0;
+		uint64_t savedBytes = tailMergeSection(state, sect, replacements, mergedCount);
+		if ( opts.printStatistics() )
+			fprintf(stderr, "cstring tail merging: %u strings share the tail of another, saving %llu bytes of %s\n",
+					mergedCount, savedBytes, sect->sectionName());
+	}
+	if ( replacements.empty() )
+		return;
+
+	// walk all atoms and replace references to cut down strings with references to their prefix atoms
+	for (const ld::Atom*& atom : state.indirectBindingTable) {
+		auto pos = replacements.find(atom);
+		if ( pos != replacements.end() )
+			atom = pos->second;
+	}
+	for (ld::Internal::FinalSection* sect : state.sections) {
+		for (const ld::Atom* atom : sect->atoms) {
+			for (ld::Fixup::iterator fit = atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
+				if ( (fit->binding != ld::Fixup::bindingDirectlyBound) && (fit->binding != ld::Fixup::bindingByContentBound) )
+					continue;
+				auto pos = replacements.find(fit->u.target);
+				if ( pos != replacements.end() )
+					fit->u.target = pos->second;
+			}
+		}
+	}
+	for (auto& entry : replacements) {
+		(const_cast<ld::Atom*>(entry.first))->setCoalescedAway();
+		state.atomToSection.erase(entry.first);
+	}
+}
+
+
+} // namespace cstring_tail_merge
+} // namespace passes 
+} // namespace ld 
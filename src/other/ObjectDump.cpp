@@ -1283,6 +1283,9 @@ static ld::relocatable::File* createReader(const char* path)
 	objOpts.treateBitcodeAsData = false;
 	objOpts.usingBitcode		= true;
 	objOpts.forceHidden			= false;
+	objOpts.parseCacheDir		= NULL;
+	objOpts.parseCacheMaxSize	= 0;
+	objOpts.literalPool			= NULL;
 #if 1
 	if ( ! foundFatSlice ) {
 		cpu_type_t archOfObj;
@@ -40,6 +40,7 @@
 #include "MachOFileAbstraction.hpp"
 #include "Architectures.hpp"
 #include "MachOTrie.hpp"
+#include "MachOAddressIndex.hpp"
 #include "../ld/code-sign-blobs/superblob.h"
 
 static bool printRebase = false;
@@ -55,6 +56,7 @@ static bool printFunctionStarts = false;
 static bool printDylibs = false;
 static bool printDRs = false;
 static bool printDataCode = false;
+static bool printChainStats = false;
 static cpu_type_t	sPreferredArch = 0;
 static cpu_type_t	sPreferredSubArch = 0;
 
@@ -73,6 +75,109 @@ static void throwf(const char* format, ...)
 }
 
 
+//
+// Formats large tables into a buffer that is written with fwrite(), instead of a
+// printf() per line.  An image with a million chained fixups spends most of its
+// dyldinfo time in printf's format parsing and per-call stdio locking.
+//
+class OutputWriter
+{
+public:
+					OutputWriter() : fUsed(0) { }
+					~OutputWriter() { flush(); }
+
+	void			flush();
+	OutputWriter&	str(const char* s);
+	OutputWriter&	chr(char c)									{ reserve(1); fBuffer[fUsed++] = c; return *this; }
+	OutputWriter&	padRight(const char* s, unsigned width);	// like %-Ns
+	OutputWriter&	padLeft(const char* s, unsigned width);		// like %Ns
+	OutputWriter&	hex(uint64_t value, unsigned minDigits);	// like 0x%0NllX
+	OutputWriter&	dec(int64_t value, unsigned width=0);		// like %Nlld
+
+private:
+	void			reserve(size_t amount)						{ if ( fUsed + amount > sizeof(fBuffer) ) flush(); }
+
+	char			fBuffer[64*1024];
+	size_t			fUsed;
+};
+
+void OutputWriter::flush()
+{
+	if ( fUsed != 0 )
+		fwrite(fBuffer, 1, fUsed, stdout);
+	fUsed = 0;
+}
+
+OutputWriter& OutputWriter::str(const char* s)
+{
+	size_t len = strlen(s);
+	while ( len > sizeof(fBuffer) - fUsed ) {
+		size_t amount = sizeof(fBuffer) - fUsed;
+		memcpy(&fBuffer[fUsed], s, amount);
+		fUsed += amount;
+		s += amount;
+		len -= amount;
+		flush();
+	}
+	memcpy(&fBuffer[fUsed], s, len);
+	fUsed += len;
+	return *this;
+}
+
+OutputWriter& OutputWriter::padRight(const char* s, unsigned width)
+{
+	str(s);
+	for (size_t len = strlen(s); len < width; ++len)
+		chr(' ');
+	return *this;
+}
+
+OutputWriter& OutputWriter::padLeft(const char* s, unsigned width)
+{
+	for (size_t len = strlen(s); len < width; ++len)
+		chr(' ');
+	return str(s);
+}
+
+OutputWriter& OutputWriter::hex(uint64_t value, unsigned minDigits)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	char buf[16];
+	unsigned count = 0;
+	do {
+		buf[count++] = digits[value & 0xF];
+		value >>= 4;
+	} while ( value != 0 );
+	reserve(2 + 16 + minDigits);
+	fBuffer[fUsed++] = '0';
+	fBuffer[fUsed++] = 'x';
+	for (unsigned i=count; i < minDigits; ++i)
+		fBuffer[fUsed++] = '0';
+	while ( count != 0 )
+		fBuffer[fUsed++] = buf[--count];
+	return *this;
+}
+
+OutputWriter& OutputWriter::dec(int64_t value, unsigned width)
+{
+	char buf[24];
+	unsigned count = 0;
+	uint64_t magnitude = (value < 0) ? (0 - (uint64_t)value) : (uint64_t)value;
+	do {
+		buf[count++] = '0' + (magnitude % 10);
+		magnitude /= 10;
+	} while ( magnitude != 0 );
+	if ( value < 0 )
+		buf[count++] = '-';
+	reserve(24 + width);
+	for (unsigned i=count; i < width; ++i)
+		fBuffer[fUsed++] = ' ';
+	while ( count != 0 )
+		fBuffer[fUsed++] = buf[--count];
+	return *this;
+}
+
+
 template <typename A>
 class DyldInfoPrinter
 {
@@ -110,6 +215,9 @@ private:
 	void										printDylibsInfo();
 	void										printDRInfo();
 	void										printDataInCode();
+	void										printChainedRebaseInfo();
+	void										printChainedBindInfo();
+	void										printChainedFixupStats();
 	void										printFunctionStartLine(uint64_t addr);
 	const uint8_t*								printSharedRegionV1InfoForEachULEB128Address(const uint8_t* p, const uint8_t* end, uint8_t kind);
 	const uint8_t*								printSharedRegionV2InfoForEachULEB128Address(const uint8_t* p, const uint8_t* end);
@@ -140,6 +248,37 @@ private:
 	const char*									symbolNameForAddress(uint64_t);
 	const char*									closestSymbolNameForAddress(uint64_t addr, uint64_t* offset, uint8_t sectIndex=0);
 
+	struct ChainedImport
+	{
+		const char*		name;
+		int				libOrdinal;
+		bool			weakImport;
+		int64_t			addend;
+	};
+	struct ChainedFixup
+	{
+		uint64_t		address;
+		uint64_t		target;			// rebase: target address, bind: import index
+		int64_t			addend;			// inline addend in the bind pointer
+		uint32_t		chainIndex;
+		uint32_t		pageIndex;
+		uint16_t		pointerFormat;
+		uint16_t		diversity;
+		uint8_t			segIndex;
+		uint8_t			key;
+		bool			isBind;
+		bool			isAuth;
+		bool			addrDiv;
+		bool			nonPointer;		// 32-bit formats: value above max_valid_pointer
+	};
+	bool										hasChainedFixups() const { return (fChainedFixups != NULL) || (fChainStarts != NULL); }
+	void										parseChainedImports();
+	void										forEachChainedFixup(void (^handler)(const ChainedFixup& fixup));
+	void										walkChain(uint64_t fileOffset, uint16_t pointerFormat, uint32_t maxValidPointer,
+														uint32_t pageSize, uint32_t chainIndex,
+														void (^handler)(const ChainedFixup& fixup));
+	static const char*							chainedPointerFormatName(uint16_t pointerFormat);
+
 		
 	const char*									fPath;
 	const macho_header<P>*						fHeader;
@@ -153,6 +292,8 @@ private:
 	const macho_linkedit_data_command<P>*		fFunctionStartsInfo;
 	const macho_linkedit_data_command<P>*		fDataInCode;
 	const macho_linkedit_data_command<P>*		fDRInfo;
+	const macho_linkedit_data_command<P>*		fChainedFixups;
+	const macho_section<P>*						fChainStarts;
 	uint64_t									fBaseAddress;
 	const macho_dysymtab_command<P>*			fDynamicSymbolTable;
 	const macho_segment_command<P>*				fFirstSegment;
@@ -163,6 +304,11 @@ private:
 	std::vector<const char*>					fDylibs;
 	std::vector<const macho_dylib_command<P>*>	fDylibLoadCommands;
 	macho_section<P>							fMachHeaderPseudoSection;
+	mach_o::address_index::AddressIndex<P>		fSymbolIndex;
+	bool										fSymbolIndexBuilt;
+	bool										fChainedImportsParsed;
+	std::vector<ChainedImport>					fChainedImports;
+	uint32_t									fChainedImportsFormat;
 };
 
 
@@ -318,8 +464,9 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
  : fHeader(NULL), fLength(fileLength), 
    fStrings(NULL), fStringsEnd(NULL), fSymbols(NULL), fSymbolCount(0), fInfo(NULL), 
    fSharedRegionInfo(NULL), fFunctionStartsInfo(NULL), fDataInCode(NULL), fDRInfo(NULL), 
+   fChainedFixups(NULL), fChainStarts(NULL),
    fBaseAddress(0), fDynamicSymbolTable(NULL), fFirstSegment(NULL), fFirstWritableSegment(NULL),
-   fWriteableSegmentWithAddrOver4G(false)
+   fWriteableSegmentWithAddrOver4G(false), fSymbolIndexBuilt(false), fChainedImportsParsed(false), fChainedImportsFormat(0)
 {
 	// sanity check
 	if ( ! validFile(fileContent) )
@@ -371,8 +518,12 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 				}
 				const macho_section<P>* const sectionsStart = (macho_section<P>*)((char*)segCmd + sizeof(macho_segment_command<P>));
 				const macho_section<P>* const sectionsEnd = &sectionsStart[segCmd->nsects()];
-				for(const macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect)
+				for(const macho_section<P>* sect = sectionsStart; sect < sectionsEnd; ++sect) {
 					fSections.push_back(sect);
+					// firmware and other preload images record their chain starts in a section
+					if ( (strcmp(sect->segname(), "__TEXT") == 0) && (strncmp(sect->sectname(), "__chain_starts", 16) == 0) )
+						fChainStarts = sect;
+				}
 				}
 				break;
 			case LC_LOAD_DYLIB:
@@ -420,6 +571,9 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 			case LC_DYLIB_CODE_SIGN_DRS:
 				fDRInfo = (macho_linkedit_data_command<P>*)cmd;
 				break;
+			case LC_DYLD_CHAINED_FIXUPS:
+				fChainedFixups = (macho_linkedit_data_command<P>*)cmd;
+				break;
 		}
 		cmd = (const macho_load_command<P>*)endOfCmd;
 	}
@@ -437,12 +591,16 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 	if ( printRebase ) {
 		if ( fInfo != NULL )
 			printRebaseInfo();
+		else if ( hasChainedFixups() )
+			printChainedRebaseInfo();
 		else
 			printRelocRebaseInfo();
 	}
 	if ( printBind ) {
 		if ( fInfo != NULL )
 			printBindingInfo();
+		else if ( hasChainedFixups() )
+			printChainedBindInfo();
 		else
 			printClassicBindingInfo();
 	}
@@ -480,6 +638,8 @@ DyldInfoPrinter<A>::DyldInfoPrinter(const uint8_t* fileContent, uint32_t fileLen
 		printDRInfo();
 	if ( printDataCode )
 		printDataInCode();
+	if ( printChainStats )
+		printChainedFixupStats();
 }
 
 static uint64_t read_uleb128(const uint8_t*& p, const uint8_t* end)
@@ -672,6 +832,470 @@ const char* DyldInfoPrinter<A>::classicOrdinalName(int libraryOrdinal)
 	return fDylibs[libraryOrdinal-1];
 }
 
+template <typename A>
+const char* DyldInfoPrinter<A>::chainedPointerFormatName(uint16_t pointerFormat)
+{
+	switch ( pointerFormat ) {
+		case DYLD_CHAINED_PTR_ARM64E:
+			return "DYLD_CHAINED_PTR_ARM64E";
+		case DYLD_CHAINED_PTR_64:
+			return "DYLD_CHAINED_PTR_64";
+		case DYLD_CHAINED_PTR_32:
+			return "DYLD_CHAINED_PTR_32";
+		case DYLD_CHAINED_PTR_32_CACHE:
+			return "DYLD_CHAINED_PTR_32_CACHE";
+		case DYLD_CHAINED_PTR_32_FIRMWARE:
+			return "DYLD_CHAINED_PTR_32_FIRMWARE";
+		case DYLD_CHAINED_PTR_64_OFFSET:
+			return "DYLD_CHAINED_PTR_64_OFFSET";
+		case DYLD_CHAINED_PTR_ARM64E_KERNEL:
+			return "DYLD_CHAINED_PTR_ARM64E_KERNEL";
+		case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+			return "DYLD_CHAINED_PTR_ARM64E_USERLAND";
+		case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
+			return "DYLD_CHAINED_PTR_ARM64E_FIRMWARE";
+		case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
+			return "DYLD_CHAINED_PTR_ARM64E_USERLAND24";
+	}
+	return "??";
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::parseChainedImports()
+{
+	// only the options that show binds need the imports, so a format this can't decode doesn't stop the others
+	if ( fChainedImportsParsed || (fChainedFixups == NULL) )
+		return;
+	fChainedImportsParsed = true;
+	const uint8_t* const start = (uint8_t*)fHeader + fChainedFixups->dataoff();
+	const uint8_t* const end = start + fChainedFixups->datasize();
+	if ( end > (uint8_t*)fHeader + fLength )
+		throw "chained fixups extend beyond end of file";
+	if ( fChainedFixups->datasize() < sizeof(dyld_chained_fixups_header) )
+		throw "chained fixups too small";
+	const dyld_chained_fixups_header* header = (dyld_chained_fixups_header*)start;
+	if ( header->fixups_version != 0 )
+		throwf("unknown chained fixups version %u", header->fixups_version);
+	if ( header->symbols_format != 0 )
+		throwf("unsupported chained fixups symbols format %u", header->symbols_format);
+	fChainedImportsFormat = header->imports_format;
+	const uint8_t* const imports = start + header->imports_offset;
+	const char* const symbols = (char*)start + header->symbols_offset;
+	fChainedImports.resize(header->imports_count);
+	for (uint32_t i=0; i < header->imports_count; ++i) {
+		ChainedImport& imp = fChainedImports[i];
+		uint32_t nameOffset;
+		switch ( header->imports_format ) {
+			case DYLD_CHAINED_IMPORT: {
+				const dyld_chained_import* import = &((dyld_chained_import*)imports)[i];
+				if ( (uint8_t*)(import+1) > end )
+					throw "chained imports extend beyond chained fixups";
+				// ordinals above 0xF0 are the negative BIND_SPECIAL_DYLIB_* values
+				imp.libOrdinal = (import->lib_ordinal > 0xF0) ? (int8_t)import->lib_ordinal : import->lib_ordinal;
+				imp.weakImport = import->weak_import;
+				imp.addend     = 0;
+				nameOffset     = import->name_offset;
+				break;
+			}
+			case DYLD_CHAINED_IMPORT_ADDEND: {
+				const dyld_chained_import_addend* import = &((dyld_chained_import_addend*)imports)[i];
+				if ( (uint8_t*)(import+1) > end )
+					throw "chained imports extend beyond chained fixups";
+				imp.libOrdinal = (import->lib_ordinal > 0xF0) ? (int8_t)import->lib_ordinal : import->lib_ordinal;
+				imp.weakImport = import->weak_import;
+				imp.addend     = import->addend;
+				nameOffset     = import->name_offset;
+				break;
+			}
+			case DYLD_CHAINED_IMPORT_ADDEND64: {
+				const dyld_chained_import_addend64* import = &((dyld_chained_import_addend64*)imports)[i];
+				if ( (uint8_t*)(import+1) > end )
+					throw "chained imports extend beyond chained fixups";
+				imp.libOrdinal = (import->lib_ordinal > 0xFFF0) ? (int16_t)import->lib_ordinal : import->lib_ordinal;
+				imp.weakImport = import->weak_import;
+				imp.addend     = import->addend;
+				nameOffset     = import->name_offset;
+				break;
+			}
+			default:
+				throwf("unknown chained imports format %u", header->imports_format);
+		}
+		if ( (uint8_t*)&symbols[nameOffset] >= end )
+			throw "chained import name extends beyond chained fixups";
+		imp.name = &symbols[nameOffset];
+	}
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::walkChain(uint64_t fileOffset, uint16_t pointerFormat, uint32_t maxValidPointer, uint32_t pageSize,
+								   uint32_t chainIndex, void (^handler)(const ChainedFixup& fixup))
+{
+	const macho_segment_command<P>* seg = NULL;
+	uint8_t segIndex = 0;
+	ChainedFixup fixup;
+	while ( true ) {
+		// firmware chains are not page based and can run from one segment into the next
+		if ( (seg == NULL) || (fileOffset < seg->fileoff()) || (fileOffset >= seg->fileoff()+seg->filesize()) ) {
+			seg = NULL;
+			for (unsigned i=0; i < fSegments.size(); ++i) {
+				if ( (fSegments[i]->fileoff() <= fileOffset) && (fileOffset < fSegments[i]->fileoff()+fSegments[i]->filesize()) ) {
+					seg = fSegments[i];
+					segIndex = i;
+					break;
+				}
+			}
+			if ( seg == NULL )
+				throwf("chained fixup at file offset 0x%llX is not in any segment", fileOffset);
+		}
+		const bool pointer32 = (pointerFormat == DYLD_CHAINED_PTR_32) || (pointerFormat == DYLD_CHAINED_PTR_32_CACHE)
+								|| (pointerFormat == DYLD_CHAINED_PTR_32_FIRMWARE);
+		if ( fileOffset + (pointer32 ? sizeof(uint32_t) : sizeof(uint64_t)) > fLength )
+			throwf("chained fixup at file offset 0x%llX extends beyond end of file", fileOffset);
+		const uint8_t* loc = (uint8_t*)fHeader + fileOffset;
+		memset(&fixup, 0, sizeof(fixup));
+		fixup.address		= seg->vmaddr() + (fileOffset - seg->fileoff());
+		fixup.chainIndex	= chainIndex;
+		fixup.pageIndex		= (uint32_t)((fileOffset - seg->fileoff()) / pageSize);
+		fixup.segIndex		= segIndex;
+		fixup.pointerFormat	= pointerFormat;
+		uint64_t next;
+		uint32_t stride = 4;
+		switch ( pointerFormat ) {
+			case DYLD_CHAINED_PTR_ARM64E:
+			case DYLD_CHAINED_PTR_ARM64E_KERNEL:
+			case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+			case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
+			case DYLD_CHAINED_PTR_ARM64E_USERLAND24: {
+				const uint64_t raw = E::get64(*(uint64_t*)loc);
+				fixup.isAuth = ((raw >> 63) & 1);
+				fixup.isBind = ((raw >> 62) & 1);
+				next = (raw >> 51) & 0x7FF;
+				if ( (pointerFormat != DYLD_CHAINED_PTR_ARM64E_KERNEL) && (pointerFormat != DYLD_CHAINED_PTR_ARM64E_FIRMWARE) )
+					stride = 8;
+				if ( fixup.isAuth ) {
+					fixup.diversity = (raw >> 32) & 0xFFFF;
+					fixup.addrDiv   = ((raw >> 48) & 1);
+					fixup.key       = (raw >> 49) & 3;
+				}
+				if ( fixup.isBind ) {
+					fixup.target = raw & ((pointerFormat == DYLD_CHAINED_PTR_ARM64E_USERLAND24) ? 0xFFFFFF : 0xFFFF);
+					// plain binds have a signed 19-bit addend in bits 32..50
+					if ( !fixup.isAuth )
+						fixup.addend = ((int64_t)(raw << 13)) >> 45;
+				}
+				else if ( fixup.isAuth ) {
+					// auth rebase targets are always an offset from the start of the image
+					fixup.target = (raw & 0xFFFFFFFF) + fBaseAddress;
+				}
+				else {
+					uint64_t target = raw & 0x7FFFFFFFFFFULL;
+					if ( (pointerFormat != DYLD_CHAINED_PTR_ARM64E) && (pointerFormat != DYLD_CHAINED_PTR_ARM64E_FIRMWARE) )
+						target += fBaseAddress;
+					fixup.target = (((raw >> 43) & 0xFF) << 56) | target;
+				}
+				break;
+			}
+			case DYLD_CHAINED_PTR_64:
+			case DYLD_CHAINED_PTR_64_OFFSET: {
+				const uint64_t raw = E::get64(*(uint64_t*)loc);
+				fixup.isBind = ((raw >> 63) & 1);
+				next = (raw >> 51) & 0xFFF;
+				if ( fixup.isBind ) {
+					fixup.target = raw & 0xFFFFFF;
+					fixup.addend = (raw >> 24) & 0xFF;
+				}
+				else {
+					uint64_t target = raw & 0xFFFFFFFFFULL;
+					if ( pointerFormat == DYLD_CHAINED_PTR_64_OFFSET )
+						target += fBaseAddress;
+					fixup.target = (((raw >> 36) & 0xFF) << 56) | target;
+				}
+				break;
+			}
+			case DYLD_CHAINED_PTR_32: {
+				const uint32_t raw = E::get32(*(uint32_t*)loc);
+				fixup.isBind = ((raw >> 31) & 1);
+				next = (raw >> 26) & 0x1F;
+				if ( fixup.isBind ) {
+					fixup.target = raw & 0xFFFFF;
+					fixup.addend = (raw >> 20) & 0x3F;
+				}
+				else {
+					fixup.target = raw & 0x3FFFFFF;
+					if ( fixup.target > maxValidPointer ) {
+						// a value too big to leave in the chain, stored biased to the top of the range
+						const uint32_t bias = (0x04000000 + maxValidPointer)/2;
+						fixup.target -= bias;
+						fixup.nonPointer = true;
+					}
+				}
+				break;
+			}
+			case DYLD_CHAINED_PTR_32_CACHE: {
+				// target is an offset from the start of the shared cache
+				const uint32_t raw = E::get32(*(uint32_t*)loc);
+				fixup.target = raw & 0x3FFFFFFF;
+				next = (raw >> 30) & 0x3;
+				break;
+			}
+			case DYLD_CHAINED_PTR_32_FIRMWARE: {
+				const uint32_t raw = E::get32(*(uint32_t*)loc);
+				fixup.target = raw & 0x3FFFFFF;
+				next = (raw >> 26) & 0x3F;
+				break;
+			}
+			default:
+				throwf("unknown chained pointer format %d", pointerFormat);
+		}
+		handler(fixup);
+		if ( next == 0 )
+			break;
+		fileOffset += next * stride;
+	}
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::forEachChainedFixup(void (^handler)(const ChainedFixup& fixup))
+{
+	uint32_t chainIndex = 0;
+	if ( fChainedFixups != NULL ) {
+		const uint8_t* const start = (uint8_t*)fHeader + fChainedFixups->dataoff();
+		const uint8_t* const end = start + fChainedFixups->datasize();
+		const dyld_chained_fixups_header* header = (dyld_chained_fixups_header*)start;
+		const dyld_chained_starts_in_image* image = (dyld_chained_starts_in_image*)(start + header->starts_offset);
+		if ( (uint8_t*)&image->seg_info_offset[image->seg_count] > end )
+			throw "chained starts extend beyond chained fixups";
+		for (uint32_t segIndex=0; segIndex < image->seg_count; ++segIndex) {
+			if ( image->seg_info_offset[segIndex] == 0 )
+				continue;
+			if ( segIndex >= fSegments.size() )
+				throwf("chained starts for segment %u, but there are only %lu segments", segIndex, fSegments.size());
+			const dyld_chained_starts_in_segment* segInfo = (dyld_chained_starts_in_segment*)((uint8_t*)image + image->seg_info_offset[segIndex]);
+			if ( (uint8_t*)&segInfo->page_start[segInfo->page_count] > end )
+				throw "chained starts extend beyond chained fixups";
+			const uint64_t segFileOffset = fSegments[segIndex]->fileoff();
+			for (uint32_t pageIndex=0; pageIndex < segInfo->page_count; ++pageIndex) {
+				const uint16_t offsetInPage = segInfo->page_start[pageIndex];
+				if ( offsetInPage == DYLD_CHAINED_PTR_START_NONE )
+					continue;
+				const uint64_t pageFileOffset = segFileOffset + (uint64_t)pageIndex * segInfo->page_size;
+				if ( offsetInPage & DYLD_CHAINED_PTR_START_MULTI ) {
+					// some 32-bit formats need several chains per page, listed after the page starts
+					uint32_t overflowIndex = offsetInPage & ~DYLD_CHAINED_PTR_START_MULTI;
+					bool lastChain = false;
+					while ( !lastChain ) {
+						if ( (uint8_t*)&segInfo->page_start[overflowIndex+1] > end )
+							throw "chained starts extend beyond chained fixups";
+						const uint16_t chainStart = segInfo->page_start[overflowIndex++];
+						lastChain = ((chainStart & DYLD_CHAINED_PTR_START_LAST) != 0);
+						walkChain(pageFileOffset + (chainStart & ~DYLD_CHAINED_PTR_START_LAST), segInfo->pointer_format,
+								  segInfo->max_valid_pointer, segInfo->page_size, chainIndex++, handler);
+					}
+				}
+				else {
+					walkChain(pageFileOffset + offsetInPage, segInfo->pointer_format, segInfo->max_valid_pointer,
+							  segInfo->page_size, chainIndex++, handler);
+				}
+			}
+		}
+	}
+	else if ( fChainStarts != NULL ) {
+		// starts are offsets from the start of __TEXT in the file
+		const macho_segment_command<P>* textSeg = NULL;
+		for (const macho_segment_command<P>* seg : fSegments) {
+			if ( strcmp(seg->segname(), "__TEXT") == 0 ) {
+				textSeg = seg;
+				break;
+			}
+		}
+		if ( textSeg == NULL )
+			throw "__chain_starts section but no __TEXT segment";
+		const dyld_chained_starts_offsets* starts = (dyld_chained_starts_offsets*)((uint8_t*)fHeader + fChainStarts->offset());
+		if ( (fChainStarts->offset() + fChainStarts->size() > fLength)
+			|| ((uint8_t*)&starts->chain_starts[starts->starts_count] > (uint8_t*)fHeader + fChainStarts->offset() + fChainStarts->size()) )
+			throw "__chain_starts section malformed";
+		for (uint32_t i=0; i < starts->starts_count; ++i)
+			walkChain(textSeg->fileoff() + starts->chain_starts[i], starts->pointer_format, 0, 0x1000, chainIndex++, handler);
+	}
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printChainedRebaseInfo()
+{
+	static const char* keyNames[] = { "IA", "IB", "DA", "DB" };
+	OutputWriter writer;
+	OutputWriter* out = &writer;
+	out->str("rebase information (from chained fixups):\n");
+	out->str("segment section          address     type         value\n");
+	forEachChainedFixup(^(const ChainedFixup& fixup) {
+		if ( fixup.isBind )
+			return;
+		out->padRight(segmentName(fixup.segIndex), 7).chr(' ').padRight(sectionName(fixup.segIndex, fixup.address), 16).chr(' ');
+		out->hex(fixup.address, 8).str("  ").str(fixup.nonPointer ? "value  " : "pointer").str("  ").hex(fixup.target, 8);
+		if ( fixup.isAuth ) {
+			out->str(" (JOP: diversity ").dec(fixup.diversity).str(", address ").str(fixup.addrDiv ? "true" : "false");
+			out->str(", ").str(keyNames[fixup.key]).chr(')');
+		}
+		out->chr('\n');
+	});
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printChainedBindInfo()
+{
+	static const char* keyNames[] = { "IA", "IB", "DA", "DB" };
+	OutputWriter writer;
+	OutputWriter* out = &writer;
+	out->str("bind information (from chained fixups):\n");
+	out->str("segment section          address        type    addend dylib            symbol\n");
+	parseChainedImports();
+	forEachChainedFixup(^(const ChainedFixup& fixup) {
+		if ( !fixup.isBind )
+			return;
+		if ( fixup.target >= fChainedImports.size() )
+			throwf("chained bind at 0x%08llX uses import %llu, but there are only %lu imports", fixup.address, fixup.target, fChainedImports.size());
+		const ChainedImport& import = fChainedImports[fixup.target];
+		out->padRight(segmentName(fixup.segIndex), 7).chr(' ').padRight(sectionName(fixup.segIndex, fixup.address), 16).chr(' ');
+		out->hex(fixup.address, 8).chr(' ').padLeft("pointer", 10).str("  ").dec(import.addend + fixup.addend, 5).chr(' ');
+		out->padRight(ordinalName(import.libOrdinal), 16).chr(' ').str(import.name);
+		if ( import.weakImport )
+			out->str(" (weak import)");
+		if ( fixup.isAuth ) {
+			out->str(" (JOP: diversity ").dec(fixup.diversity).str(", address ").str(fixup.addrDiv ? "true" : "false");
+			out->str(", ").str(keyNames[fixup.key]).chr(')');
+		}
+		out->chr('\n');
+	});
+}
+
+template <typename A>
+void DyldInfoPrinter<A>::printChainedFixupStats()
+{
+	if ( !hasChainedFixups() ) {
+		printf("no chained fixups\n");
+		return;
+	}
+	parseChainedImports();
+	struct SegmentStats
+	{
+		uint16_t				pointerFormat;
+		uint64_t				fixups;
+		std::vector<uint32_t>	fixupsPerPage;
+	};
+	std::vector<SegmentStats> segStats(fSegments.size());
+	std::vector<uint32_t> chainLengths;
+	std::vector<uint32_t> importUses(fChainedImports.size());
+	uint64_t counts[4] = { 0, 0, 0, 0 };	// rebases, binds, authenticated, non-pointers
+	SegmentStats* segs = &segStats[0];
+	std::vector<uint32_t>* chains = &chainLengths;
+	uint32_t* uses = importUses.empty() ? NULL : &importUses[0];
+	const size_t importCount = importUses.size();
+	uint64_t* totals = counts;
+	forEachChainedFixup(^(const ChainedFixup& fixup) {
+		SegmentStats& seg = segs[fixup.segIndex];
+		seg.pointerFormat = fixup.pointerFormat;
+		++seg.fixups;
+		if ( fixup.pageIndex >= seg.fixupsPerPage.size() )
+			seg.fixupsPerPage.resize(fixup.pageIndex+1);
+		++seg.fixupsPerPage[fixup.pageIndex];
+		if ( fixup.chainIndex >= chains->size() )
+			chains->resize(fixup.chainIndex+1);
+		++(*chains)[fixup.chainIndex];
+		if ( fixup.isBind ) {
+			++totals[1];
+			if ( fixup.target < importCount )
+				++uses[fixup.target];
+		}
+		else {
+			++totals[0];
+		}
+		if ( fixup.isAuth )
+			++totals[2];
+		if ( fixup.nonPointer )
+			++totals[3];
+	});
+
+	// fixups per page, for pages that have any, since those are the pages dyld must touch
+	static const uint32_t bucketLimits[] = { 1, 7, 31, 127, 511, UINT32_MAX };
+	static const char* bucketNames[] = { "1", "2-7", "8-31", "32-127", "128-511", "512+" };
+	uint64_t buckets[6] = { 0, 0, 0, 0, 0, 0 };
+	uint64_t pagesWithFixups = 0;
+	uint32_t minPerPage = UINT32_MAX;
+	uint32_t maxPerPage = 0;
+	printf("chained fixups:\n");
+	printf("  segment          format                              fixups  pages with fixups\n");
+	for (unsigned i=0; i < segStats.size(); ++i) {
+		const SegmentStats& seg = segStats[i];
+		if ( seg.fixups == 0 )
+			continue;
+		uint64_t segPages = 0;
+		for (uint32_t count : seg.fixupsPerPage) {
+			if ( count == 0 )
+				continue;
+			++segPages;
+			minPerPage = std::min(minPerPage, count);
+			maxPerPage = std::max(maxPerPage, count);
+			for (unsigned b=0; b < 6; ++b) {
+				if ( count <= bucketLimits[b] ) {
+					++buckets[b];
+					break;
+				}
+			}
+		}
+		pagesWithFixups += segPages;
+		printf("  %-16s %-34s %8llu  %8llu\n", segmentName(i), chainedPointerFormatName(seg.pointerFormat), seg.fixups, segPages);
+	}
+	const uint64_t fixupCount = counts[0] + counts[1];
+	printf("  fixups:            %llu (rebases %llu, binds %llu, authenticated %llu, non-pointers %llu)\n",
+			fixupCount, counts[0], counts[1], counts[2], counts[3]);
+	if ( pagesWithFixups != 0 ) {
+		printf("  pages with fixups: %llu, fixups per page min %u, avg %.1f, max %u\n",
+				pagesWithFixups, minPerPage, (double)fixupCount/pagesWithFixups, maxPerPage);
+		printf("  fixups per page:\n");
+		for (unsigned b=0; b < 6; ++b)
+			printf("    %-8s %8llu pages\n", bucketNames[b], buckets[b]);
+	}
+
+	uint64_t chainCount = 0;
+	uint32_t maxChain = 0;
+	for (uint32_t length : chainLengths) {
+		if ( length == 0 )
+			continue;
+		++chainCount;
+		maxChain = std::max(maxChain, length);
+	}
+	if ( chainCount != 0 )
+		printf("  chains:            %llu, length avg %.1f, max %u\n", chainCount, (double)fixupCount/chainCount, maxChain);
+
+	if ( fChainedFixups != NULL ) {
+		static const char* importFormatNames[] = { "??", "DYLD_CHAINED_IMPORT", "DYLD_CHAINED_IMPORT_ADDEND", "DYLD_CHAINED_IMPORT_ADDEND64" };
+		uint64_t usedImports = 0;
+		uint64_t weakImports = 0;
+		std::vector<uint64_t> perDylib(fDylibs.size()+1);
+		uint64_t specialOrdinals = 0;
+		for (size_t i=0; i < fChainedImports.size(); ++i) {
+			const ChainedImport& import = fChainedImports[i];
+			if ( importUses[i] != 0 )
+				++usedImports;
+			if ( import.weakImport )
+				++weakImports;
+			if ( (import.libOrdinal > 0) && (import.libOrdinal <= (int)fDylibs.size()) )
+				++perDylib[import.libOrdinal];
+			else
+				++specialOrdinals;
+		}
+		printf("  imports:           %lu (%s), used %llu, weak %llu\n", fChainedImports.size(),
+				importFormatNames[(fChainedImportsFormat < 4) ? fChainedImportsFormat : 0], usedImports, weakImports);
+		for (size_t i=1; i < perDylib.size(); ++i) {
+			if ( perDylib[i] != 0 )
+				printf("    %-16s %8llu\n", fDylibs[i-1], perDylib[i]);
+		}
+		if ( specialOrdinals != 0 )
+			printf("    %-16s %8llu\n", "(special)", specialOrdinals);
+	}
+}
+
+
 template <typename A>
 void DyldInfoPrinter<A>::printRebaseInfo()
 {
@@ -2458,48 +3082,24 @@ void DyldInfoPrinter<A>::printSymbolTableExportInfo()
 template <typename A>
 const char* DyldInfoPrinter<A>::closestSymbolNameForAddress(uint64_t addr, uint64_t* offset, uint8_t sectIndex)
 {
-	const macho_nlist<P>* bestSymbol = NULL;
-	if ( fDynamicSymbolTable != NULL ) {
-		// find closest match in globals
-		const macho_nlist<P>* const globalsStart = &fSymbols[fDynamicSymbolTable->iextdefsym()];
-		const macho_nlist<P>* const globalsEnd   = &globalsStart[fDynamicSymbolTable->nextdefsym()];
-		for (const macho_nlist<P>* s = globalsStart; s < globalsEnd; ++s) {
-			if ( (s->n_type() & N_TYPE) == N_SECT ) {
-				if ( (s->n_value() <= addr) && ((s->n_sect() == sectIndex) || (sectIndex ==0)) ) {
-					if ( (bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value()) )
-						bestSymbol = s;
-				}
-			}
-		}
-
-		// find closest match in locals
-		const macho_nlist<P>* const localsStart = &fSymbols[fDynamicSymbolTable->ilocalsym()];
-		const macho_nlist<P>* const localsEnd   = &localsStart[fDynamicSymbolTable->nlocalsym()];
-		for (const macho_nlist<P>* s = localsStart; s < localsEnd; ++s) {
-			if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) ) {
-				if ( (s->n_value() <= addr) && ((s->n_sect() == sectIndex) || (sectIndex ==0)) ) {
-					if ( (bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value()) )
-						bestSymbol = s;
-				}
-			}
+	// index the symbols the first time one is looked up, globals before locals so that they win ties
+	if ( !fSymbolIndexBuilt ) {
+		if ( fDynamicSymbolTable != NULL ) {
+			const macho_nlist<P>* const globalsStart = &fSymbols[fDynamicSymbolTable->iextdefsym()];
+			fSymbolIndex.addSymbols(globalsStart, &globalsStart[fDynamicSymbolTable->nextdefsym()], fStrings);
+			const macho_nlist<P>* const localsStart = &fSymbols[fDynamicSymbolTable->ilocalsym()];
+			fSymbolIndex.addSymbols(localsStart, &localsStart[fDynamicSymbolTable->nlocalsym()], fStrings);
 		}
-	}
-	else {
-		// find closest match in locals
-		const macho_nlist<P>* const allStart = &fSymbols[0];
-		const macho_nlist<P>* const allEnd   = &fSymbols[fSymbolCount];
-		for (const macho_nlist<P>* s = allStart; s < allEnd; ++s) {
-			if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) ) {
-				if ( (s->n_value() <= addr) && ((s->n_sect() == sectIndex) || (sectIndex ==0)) ) {
-					if ( (bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value()) )
-						bestSymbol = s;
-				}
-			}
+		else {
+			fSymbolIndex.addSymbols(&fSymbols[0], &fSymbols[fSymbolCount], fStrings);
 		}
+		fSymbolIndex.finalize();
+		fSymbolIndexBuilt = true;
 	}
+	const mach_o::address_index::Entry* bestSymbol = fSymbolIndex.closest(addr, sectIndex);
 	if ( bestSymbol != NULL ) {
-		*offset = addr - bestSymbol->n_value();
-		return &fStrings[bestSymbol->n_strx()];
+		*offset = addr - bestSymbol->address;
+		return bestSymbol->name;
 	}
 	*offset = 0;
 	return NULL;
@@ -2772,6 +3372,7 @@ static void usage()
 			"\t-function_starts  print table of function start addresses\n"
 			"\t-export_dot       print a GraphViz .dot file of the exported symbols trie\n"
 			"\t-data_in_code     print any data-in-code information\n"
+			"\t-stats            print chained fixup counts per segment, fixups per page, chain lengths, and imports\n"
 		);
 }
 
@@ -2850,6 +3451,9 @@ int main(int argc, const char* argv[])
 				else if ( strcmp(arg, "-data_in_code") == 0 ) {
 					printDataCode = true;
 				}
+				else if ( strcmp(arg, "-stats") == 0 ) {
+					printChainStats = true;
+				}
 				else {
 					throwf("unknown option: %s\n", arg);
 				}
@@ -32,15 +32,27 @@
 #include <unistd.h>
 #include <errno.h>
 
+#include <fts.h>
+#include <dispatch/dispatch.h>
+
 #include <vector>
 #include <set>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <atomic>
 #include <unordered_set>
 
 #include "configure.h"
 
 #include "MachOFileAbstraction.hpp"
 #include "Architectures.hpp"
+#include "MachOAddressIndex.hpp"
+
 
+// the message of the last throwf() on this thread.  Batch mode checks thousands of files,
+// so the message is freed once reported, or by the next throwf() if it was caught and rethrown.
+static thread_local char* sThrownMessage = NULL;
 
  __attribute__((noreturn))
 void throwf(const char* format, ...) 
@@ -51,10 +63,60 @@ void throwf(const char* format, ...)
 	vasprintf(&p, format, list);
 	va_end(list);
 	
+	free(sThrownMessage);
+	sThrownMessage = p;
 	const char*	t = p;
 	throw t;
 }
 
+// frees msg if throwf() allocated it, other errors are string literals
+static void freeThrownMessage(const char* msg)
+{
+	if ( msg == sThrownMessage ) {
+		free(sThrownMessage);
+		sThrownMessage = NULL;
+	}
+}
+
+// extra detail for the error about to be thrown, reported after it so error texts stay unchanged
+static thread_local std::string sErrorNote;
+
+__attribute__((format(printf, 1, 2)))
+static void noteForError(const char* format, ...)
+{
+	va_list	list;
+	char*	p;
+	va_start(list, format);
+	vasprintf(&p, format, list);
+	va_end(list);
+	sErrorNote = p;
+	free(p);
+}
+
+// in batch mode, each file's verifier messages are collected instead of printed
+static thread_local std::vector<std::string>* sVerifierMessages = NULL;
+
+__attribute__((format(printf, 1, 2)))
+static void verifierMessage(const char* format, ...)
+{
+	va_list	list;
+	va_start(list, format);
+	if ( sVerifierMessages != NULL ) {
+		char* p;
+		vasprintf(&p, format, list);
+		std::string message = p;
+		free(p);
+		if ( !message.empty() && (message.back() == '\n') )
+			message.pop_back();
+		sVerifierMessages->push_back(message);
+	}
+	else {
+		vprintf(format, list);
+	}
+	va_end(list);
+}
+
+
 static uint64_t read_uleb128(const uint8_t*& p, const uint8_t* end)
 {
 	uint64_t result = 0;
@@ -154,6 +216,7 @@ private:
 	pint_t										segStartAddress(uint8_t segIndex);
 	bool										addressIsRebaseSite(pint_t addr, pint_t& pointeeAddr);
 	bool										addressIsBindingSite(pint_t addr);
+	const char*									symbolNameForAddress(pint_t addr);
 	pint_t										getInitialStackPointer(const macho_thread_command<P>*);
 	pint_t										getEntryPoint(const macho_thread_command<P>*);
 	const char*									archName();
@@ -187,6 +250,8 @@ private:
 	uint32_t									fSectionCount;
 	std::vector<const macho_segment_command<P>*>fSegments;
 	const std::vector<const char*>& 			fMergeRootPaths;
+	mach_o::address_index::AddressIndex<P>		fSymbolIndex;
+	bool										fSymbolIndexBuilt = false;
 };
 
 
@@ -976,9 +1041,9 @@ void MachOChecker<A>::verifyInstallName()
 {
 	// Don't allow @rpath to be used as -install_name for OS dylibs
 	if ( strncmp(fInstallName, "@rpath/", 7) == 0 ) {
-		printf("os_dylib_rpath_install_name\tfatal\t-install_name uses @rpath in arch %s\n", archName());
+		verifierMessage("os_dylib_rpath_install_name\tfatal\t-install_name uses @rpath in arch %s\n", archName());
 	} else if ( strstr(fInstallName, "//") != NULL) {
-		printf("os_dylib_bad_install_name\twarn\t-install_name does not match install location in arch %s\n", archName());
+		verifierMessage("os_dylib_bad_install_name\twarn\t-install_name does not match install location in arch %s\n", archName());
 	}
 	else {
 		// Verify -install_name match actual path of dylib
@@ -1001,7 +1066,7 @@ void MachOChecker<A>::verifyInstallName()
 				}
 			}
 			if ( !symlinkToDylib )
-				printf("os_dylib_bad_install_name\twarn\t-install_name does not match install location in arch %s\n", archName());
+				verifierMessage("os_dylib_bad_install_name\twarn\t-install_name does not match install location in arch %s\n", archName());
 		}
 	}
 
@@ -1012,7 +1077,7 @@ void MachOChecker<A>::verifyNoRpaths()
 {
 	// Don't allow OS dylibs to add rpaths
 	if ( fHasLC_RPATH ) {
-		printf("os_dylib_rpath\twarn\tcontains LC_RPATH load command in arch %s\n", archName());
+		verifierMessage("os_dylib_rpath\twarn\tcontains LC_RPATH load command in arch %s\n", archName());
 	}
 }
 
@@ -1021,7 +1086,7 @@ template <typename A>
 void MachOChecker<A>::verifyNoFlatLookups()
 {
 	if ( (fHeader->flags() & MH_TWOLEVEL) == 0 ) {
-		printf("os_dylib_flat_namespace\twarn\tbuilt with -flat_namespace in arch %s\n", archName());
+		verifierMessage("os_dylib_flat_namespace\twarn\tbuilt with -flat_namespace in arch %s\n", archName());
 		return;
 	}
 
@@ -1032,7 +1097,7 @@ void MachOChecker<A>::verifyNoFlatLookups()
 			//printf("0x%04X %s\n", sym->n_desc(), &fStrings[sym->n_strx()]);
 			if ( GET_LIBRARY_ORDINAL(sym->n_desc()) == DYNAMIC_LOOKUP_ORDINAL ) {
 				const char* symName = &fStrings[sym->n_strx()];
-				printf("os_dylib_undefined_dynamic_lookup\twarn\tbuilt with -undefined dynamic_lookup for symbol %s in arch %s\n", symName, archName());
+				verifierMessage("os_dylib_undefined_dynamic_lookup\twarn\tbuilt with -undefined dynamic_lookup for symbol %s in arch %s\n", symName, archName());
 			}
 		}
 	}
@@ -1051,7 +1116,7 @@ void MachOChecker<A>::verifyNoDylibMain()
 	for(const macho_nlist<P>* p = exportedStart; p < exportedEnd; ++p, ++i) {
 		const char* symName = &fStrings[p->n_strx()];
 		if ( strcmp(symName, "_main") == 0 ) {
-			printf("os_dylib_exports_main\twarn\tdylibs should export '_main' symbol in arch %s\n", archName());
+			verifierMessage("os_dylib_exports_main\twarn\tdylibs should export '_main' symbol in arch %s\n", archName());
 			return;
 		}
 	}
@@ -1085,7 +1150,7 @@ void MachOChecker<A>::verifyiOSMac()
 			cmd = (const macho_load_command<P>*)(((uint8_t*)cmd)+cmd->cmdsize());
 		}
 		if ( bad )
-			printf("macos_in_ios_support\twarn\tnon-iOSMac in /System/iOSSupport/ in arch %s\n", archName());
+			verifierMessage("macos_in_ios_support\twarn\tnon-iOSMac in /System/iOSSupport/ in arch %s\n", archName());
 	}
 	else {
 		// maybe someday warn about iOSMac only stuff not in /System/iOSSupport/
@@ -1255,11 +1320,15 @@ void MachOChecker<A>::checkInitTerms()
 							pint_t sectionBeginAddr = sect->addr();
 							pint_t sectionEndddr = sect->addr() + sect->size();
 							for(pint_t addr = sectionBeginAddr, *p = arrayStart; addr < sectionEndddr; addr += sizeof(pint_t), ++p) {
-								if ( addressIsBindingSite(addr) )
+								if ( addressIsBindingSite(addr) ) {
+									noteForError("%s at 0x%0llX is in %s", kind, (long long)addr, symbolNameForAddress(addr));
 									throwf("%s at 0x%0llX has binding to external symbol", kind, (long long)addr);
+								}
 								pint_t pointer = P::getP(*p);
-								if ( ! addressIsRebaseSite(addr, pointer) )
+								if ( ! addressIsRebaseSite(addr, pointer) ) {
+									noteForError("%s at 0x%0llX is in %s", kind, (long long)addr, symbolNameForAddress(addr));
 									throwf("%s at 0x%0llX is not rebased", kind, (long long)addr);
+								}
 								// check each pointer in array points within TEXT
 								if ( (pointer < fTEXTSegment->vmaddr()) ||  (pointer >= (fTEXTSegment->vmaddr()+fTEXTSegment->vmsize())) )
 									throwf("%s 0x%08llX points outside __TEXT segment", kind, (long long)pointer);
@@ -1447,6 +1516,21 @@ arm64_32::P::uint_t MachOChecker<arm64_32>::relocBase()
 }
 #endif
 
+template <typename A>
+const char* MachOChecker<A>::symbolNameForAddress(pint_t addr)
+{
+	if ( !fSymbolIndexBuilt ) {
+		if ( fSymbols != NULL )
+			fSymbolIndex.addSymbols(&fSymbols[0], &fSymbols[fSymbolCount], fStrings);
+		fSymbolIndex.finalize();
+		fSymbolIndexBuilt = true;
+	}
+	const mach_o::address_index::Entry* entry = fSymbolIndex.closest(addr);
+	if ( entry == NULL )
+		return "?";
+	return entry->name;
+}
+
 template <typename A>
 bool MachOChecker<A>::addressInWritableSegment(pint_t address)
 {
@@ -2088,6 +2172,7 @@ bool MachOChecker<A>::addressIsBindingSite(pint_t targetAddr)
 static void check(const char* path, const char* verifierDstRoot, const std::vector<const char*>& mergeRootPaths)
 {
 	struct stat stat_buf;
+	uint8_t* p = NULL;
 	
 	try {
 		int fd = ::open(path, O_RDONLY, 0);
@@ -2096,9 +2181,12 @@ static void check(const char* path, const char* verifierDstRoot, const std::vect
 		if ( ::fstat(fd, &stat_buf) != 0 ) 
 			throwf("fstat(%s) failed, errno=%d\n", path, errno);
 		uint32_t length = stat_buf.st_size;
-		uint8_t* p = (uint8_t*)::mmap(NULL, stat_buf.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
-		if ( p == ((uint8_t*)(-1)) )
+		p = (uint8_t*)::mmap(NULL, stat_buf.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+		if ( p == ((uint8_t*)(-1)) ) {
+			p = NULL;
+			::close(fd);
 			throw "cannot map file";
+		}
 		::close(fd);
 		const mach_header* mh = (mach_header*)p;
 		if ( mh->magic == OSSwapBigToHostInt32(FAT_MAGIC) ) {
@@ -2112,20 +2200,20 @@ static void check(const char* path, const char* verifierDstRoot, const std::vect
 				switch(cputype) {
 				case CPU_TYPE_I386:
 					if ( MachOChecker<x86>::validFile(p + offset) )
-						MachOChecker<x86>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
+						delete MachOChecker<x86>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
 					else
 						throw "in universal file, i386 slice does not contain i386 mach-o";
 					break;
 				case CPU_TYPE_X86_64:
 					if ( MachOChecker<x86_64>::validFile(p + offset) )
-						MachOChecker<x86_64>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
+						delete MachOChecker<x86_64>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
 					else
 						throw "in universal file, x86_64 slice does not contain x86_64 mach-o";
 					break;
 #if SUPPORT_ARCH_arm_any
 				case CPU_TYPE_ARM:
 					if ( MachOChecker<arm>::validFile(p + offset) )
-						MachOChecker<arm>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
+						delete MachOChecker<arm>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
 					else
 						throw "in universal file, arm slice does not contain arm mach-o";
 					break;
@@ -2133,7 +2221,7 @@ static void check(const char* path, const char* verifierDstRoot, const std::vect
 #if SUPPORT_ARCH_arm64
 				case CPU_TYPE_ARM64:
 					if ( MachOChecker<arm64>::validFile(p + offset) )
-						MachOChecker<arm64>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
+						delete MachOChecker<arm64>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
 					else
 						throw "in universal file, arm64 slice does not contain arm mach-o";
 					break;
@@ -2141,7 +2229,7 @@ static void check(const char* path, const char* verifierDstRoot, const std::vect
 #if SUPPORT_ARCH_arm64_32
 				case CPU_TYPE_ARM64_32:
 					if ( MachOChecker<arm64_32>::validFile(p + offset) )
-						MachOChecker<arm64_32>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
+						delete MachOChecker<arm64_32>::make(p + offset, size, path, verifierDstRoot, mergeRootPaths);
 					else
 						throw "in universal file, arm64_32 slice does not contain arm64_32 mach-o";
 					break;
@@ -2152,41 +2240,210 @@ static void check(const char* path, const char* verifierDstRoot, const std::vect
 			}
 		}
 		else if ( MachOChecker<x86>::validFile(p) ) {
-			MachOChecker<x86>::make(p, length, path, verifierDstRoot, mergeRootPaths);
+			delete MachOChecker<x86>::make(p, length, path, verifierDstRoot, mergeRootPaths);
 		}
 		else if ( MachOChecker<x86_64>::validFile(p) ) {
-			MachOChecker<x86_64>::make(p, length, path, verifierDstRoot, mergeRootPaths);
+			delete MachOChecker<x86_64>::make(p, length, path, verifierDstRoot, mergeRootPaths);
 		}
 #if SUPPORT_ARCH_arm_any
 		else if ( MachOChecker<arm>::validFile(p) ) {
-			MachOChecker<arm>::make(p, length, path, verifierDstRoot, mergeRootPaths);
+			delete MachOChecker<arm>::make(p, length, path, verifierDstRoot, mergeRootPaths);
 		}
 #endif
 #if SUPPORT_ARCH_arm64
 		else if ( MachOChecker<arm64>::validFile(p) ) {
-			MachOChecker<arm64>::make(p, length, path, verifierDstRoot, mergeRootPaths);
+			delete MachOChecker<arm64>::make(p, length, path, verifierDstRoot, mergeRootPaths);
 		}
 #endif
 #if SUPPORT_ARCH_arm64_32
 		else if ( MachOChecker<arm64_32>::validFile(p) ) {
-			MachOChecker<arm64_32>::make(p, length, path, verifierDstRoot, mergeRootPaths);
+			delete MachOChecker<arm64_32>::make(p, length, path, verifierDstRoot, mergeRootPaths);
 		}
 #endif
 		else {
 			throw "not a known file type";
 		}
+		::munmap(p, stat_buf.st_size);
 	}
 	catch (const char* msg) {
+		// batch mode checks many files in one process, so don't leave the mapping behind
+		if ( p != NULL )
+			::munmap(p, stat_buf.st_size);
 		throwf("%s in %s", msg, path);
 	}
 }
 
 
+// in batch mode, directories are walked for anything with a mach-o or universal header
+static bool isMachOFile(const char* path)
+{
+	int fd = ::open(path, O_RDONLY, 0);
+	if ( fd == -1 )
+		return false;
+	uint32_t header[2];
+	bool result = false;
+	if ( ::pread(fd, header, sizeof(header), 0) == sizeof(header) ) {
+		switch ( header[0] ) {
+			case MH_MAGIC:
+			case MH_MAGIC_64:
+			case MH_CIGAM:
+			case MH_CIGAM_64:
+				result = true;
+				break;
+			case OSSwapHostToBigConstInt32(FAT_MAGIC):
+				// java class files also start with 0xCAFEBABE, but have a large version where nfat_arch would be
+				result = (OSSwapBigToHostInt32(header[1]) < 32);
+				break;
+		}
+	}
+	::close(fd);
+	return result;
+}
+
+static void addFilesInDirectory(const char* dirPath, std::vector<std::string>& paths)
+{
+	char* const roots[] = { (char*)dirPath, NULL };
+	FTS* fts = ::fts_open(roots, FTS_PHYSICAL | FTS_NOCHDIR, NULL);
+	if ( fts == NULL )
+		throwf("cannot open directory %s, errno=%d", dirPath, errno);
+	while ( FTSENT* entry = ::fts_read(fts) ) {
+		if ( entry->fts_info == FTS_F )
+			paths.push_back(entry->fts_path);
+	}
+	::fts_close(fts);
+}
+
+static void addFilesInList(const char* listPath, std::vector<std::string>& paths)
+{
+	FILE* file = ::fopen(listPath, "r");
+	if ( file == NULL )
+		throwf("cannot open file list %s, errno=%d", listPath, errno);
+	char line[PATH_MAX];
+	while ( ::fgets(line, PATH_MAX, file) != NULL ) {
+		size_t len = strlen(line);
+		if ( (len > 0) && (line[len-1] == '\n') )
+			line[--len] = '\0';
+		if ( len > 0 )
+			paths.push_back(line);
+	}
+	::fclose(file);
+}
+
+static void appendJSONString(std::string& out, const char* str)
+{
+	out += '"';
+	for (const char* s = str; *s != '\0'; ++s) {
+		const unsigned char c = *s;
+		if ( (c == '"') || (c == '\\') ) {
+			out += '\\';
+			out += c;
+		}
+		else if ( c < 0x20 ) {
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04X", c);
+			out += escape;
+		}
+		else {
+			out += c;
+		}
+	}
+	out += '"';
+}
+
+//
+// Checks files concurrently on 'jobs' workers.  Each result is printed as one JSON object per
+// line as soon as the file is done, e.g.
+//	{"path":"/usr/lib/libfoo.dylib", "result":"failed", "ms":1.523, "error":"...", "verifier":[...]}
+// Errors have the same text as when checking files one at a time.  With -verifier_dstroot, a
+// malformed file is reported as an os_dylib_malformed verifier message, and is not a failure.
+// Returns 1 if any file failed.
+//
+static int checkBatch(const std::vector<std::string>& paths, const std::vector<bool>& onlyIfMachO, unsigned jobs,
+					  const char* verifierDstRoot, const std::vector<const char*>& mergeRootPaths)
+{
+	std::atomic<size_t> nextIndex(0);
+	std::atomic<bool> anyFailed(false);
+	std::mutex outputLock;
+	std::atomic<size_t>* nextIndexPtr = &nextIndex;
+	std::atomic<bool>* anyFailedPtr = &anyFailed;
+	std::mutex* outputLockPtr = &outputLock;
+	const std::vector<std::string>* pathsPtr = &paths;
+	const std::vector<bool>* onlyIfMachOPtr = &onlyIfMachO;
+	const std::vector<const char*>* mergeRootPathsPtr = &mergeRootPaths;
+	dispatch_apply(jobs, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t worker) {
+		for (size_t index = (*nextIndexPtr)++; index < pathsPtr->size(); index = (*nextIndexPtr)++) {
+			const char* path = (*pathsPtr)[index].c_str();
+			if ( (*onlyIfMachOPtr)[index] && !isMachOFile(path) )
+				continue;
+			std::vector<std::string> verifierMessages;
+			const char* error = NULL;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			sVerifierMessages = &verifierMessages;
+			sErrorNote.clear();
+			try {
+				check(path, verifierDstRoot, *mergeRootPathsPtr);
+			}
+			catch (const char* msg) {
+				error = msg;
+			}
+			sVerifierMessages = NULL;
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			const char* result = "ok";
+			if ( error != NULL ) {
+				if ( verifierDstRoot != NULL ) {
+					verifierMessages.push_back(std::string("os_dylib_malformed\twarn\t") + error);
+					result = "malformed";
+				}
+				else {
+					result = "failed";
+					*anyFailedPtr = true;
+				}
+			}
+			std::string line = "{\"path\":";
+			appendJSONString(line, path);
+			line += ", \"result\":\"";
+			line += result;
+			char timing[64];
+			snprintf(timing, sizeof(timing), "\", \"ms\":%.3f", ms);
+			line += timing;
+			if ( (error != NULL) && (verifierDstRoot == NULL) ) {
+				line += ", \"error\":";
+				appendJSONString(line, error);
+				if ( !sErrorNote.empty() ) {
+					line += ", \"note\":";
+					appendJSONString(line, sErrorNote.c_str());
+				}
+			}
+			if ( !verifierMessages.empty() ) {
+				line += ", \"verifier\":[";
+				for (size_t i=0; i < verifierMessages.size(); ++i) {
+					if ( i != 0 )
+						line += ", ";
+					appendJSONString(line, verifierMessages[i].c_str());
+				}
+				line += "]";
+			}
+			line += "}\n";
+			if ( error != NULL )
+				freeThrownMessage(error);
+			std::lock_guard<std::mutex> guard(*outputLockPtr);
+			fwrite(line.data(), line.size(), 1, stdout);
+			fflush(stdout);
+		}
+	});
+	return anyFailed ? 1 : 0;
+}
+
+
 int main(int argc, const char* argv[])
 {
 	std::vector<const char*> mergeRootPaths;
 	bool progress = false;
 	const char* verifierDstRoot = NULL;
+	std::vector<std::string> batchPaths;
+	std::vector<bool> batchOnlyIfMachO;
+	unsigned jobs = 0;
 	int result = 0;
 	for(int i=1; i < argc; ++i) {
 		const char* arg = argv[i];
@@ -2213,12 +2470,34 @@ int main(int argc, const char* argv[])
 				if ( strcmp(mergeRoot, "/") != 0 )
 					mergeRootPaths.push_back(mergeRoot);
 			}
+			else if ( strcmp(arg, "-batch_dir") == 0 ) {
+				const char* dirPath = argv[++i];
+				if ( dirPath == NULL )
+					throw "-batch_dir missing path";
+				addFilesInDirectory(dirPath, batchPaths);
+				batchOnlyIfMachO.resize(batchPaths.size(), true);
+			}
+			else if ( strcmp(arg, "-batch_list") == 0 ) {
+				const char* listPath = argv[++i];
+				if ( listPath == NULL )
+					throw "-batch_list missing path";
+				addFilesInList(listPath, batchPaths);
+				batchOnlyIfMachO.resize(batchPaths.size(), false);
+			}
+			else if ( strcmp(arg, "-jobs") == 0 ) {
+				// limits how many files -batch_dir/-batch_list check at once, at most the CPU count
+				const char* count = argv[++i];
+				if ( (count == NULL) || (atoi(count) <= 0) )
+					throw "-jobs must be followed by a positive number";
+				jobs = atoi(count);
+			}
 			else {
 				throwf("unknown option: %s\n", arg);
 			}
 		}
 		else {
 			bool success = true;
+			sErrorNote.clear();
 			try {
 				check(arg, verifierDstRoot, mergeRootPaths);
 			}
@@ -2228,6 +2507,8 @@ int main(int argc, const char* argv[])
 				}
 				else {
 					fprintf(stderr, "machocheck failed: %s\n", msg);
+					if ( !sErrorNote.empty() )
+						fprintf(stderr, "machocheck note: %s\n", sErrorNote.c_str());
 					result = 1;
 					success = false;
 				}
@@ -2236,6 +2517,15 @@ int main(int argc, const char* argv[])
 				printf("ok: %s\n", arg);
 		}
 	}
+
+	if ( !batchPaths.empty() ) {
+		// dispatch_apply() runs at most one worker per CPU, so -jobs can only lower the parallelism
+		const unsigned cpuCount = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+		if ( (jobs == 0) || (jobs > cpuCount) )
+			jobs = cpuCount;
+		if ( checkBatch(batchPaths, batchOnlyIfMachO, jobs, verifierDstRoot, mergeRootPaths) != 0 )
+			result = 1;
+	}
 	
 	return result;
 }
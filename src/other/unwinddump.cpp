@@ -38,6 +38,7 @@
 #include "configure.h"
 #include "MachOFileAbstraction.hpp"
 #include "Architectures.hpp"
+#include "MachOAddressIndex.hpp"
 
 
  __attribute__((noreturn))
@@ -93,6 +94,7 @@ private:
 	const macho_nlist<P>*						fSymbols;
 	uint32_t									fSymbolCount;
 	pint_t										fMachHeaderAddress;
+	mach_o::address_index::AddressIndex<P>		fSymbolIndex;
 };
 
 
@@ -252,44 +254,39 @@ void UnwindPrinter<A>::getSymbolTableInfo()
 		}
 		cmd = (const macho_load_command<P>*)endOfCmd;
 	}
+	if ( fSymbols != NULL ) {
+		fSymbolIndex.addSymbols(&fSymbols[0], &fSymbols[fSymbolCount], fStrings);
+		fSymbolIndex.finalize();
+	}
 }
 
 template <typename A>
 const char* UnwindPrinter<A>::functionName(pint_t addr, uint32_t* offset)
 {
-	const macho_nlist<P>* closestSymbol = NULL;
 	if ( offset != NULL )
 		*offset = 0;
-	for (uint32_t i=0; i < fSymbolCount; ++i) {
-		uint8_t type = fSymbols[i].n_type();
-		if ( ((type & N_STAB) == 0) && ((type & N_TYPE) == N_SECT) ) {
-			pint_t value = fSymbols[i].n_value();
-			if ( value == addr ) {
-				const char* r = &fStrings[fSymbols[i].n_strx()];
-				return r;
-			}
-			if ( fSymbols[i].n_desc() & N_ARM_THUMB_DEF ) 
-				value |= 1;
-			if ( value == addr ) {
-				const char* r = &fStrings[fSymbols[i].n_strx()];
-				//fprintf(stderr, "addr=0x%08llX, i=%u, n_type=0x%0X, r=%s\n", (long long)(fSymbols[i].n_value()), i,  fSymbols[i].n_type(), r);
-				return r;
-			}
-			else if ( offset != NULL ) {
-				if ( closestSymbol == NULL ) {
-					if ( fSymbols[i].n_value() < addr )
-						closestSymbol = &fSymbols[i];
-				}
-				else {
-					if ( (fSymbols[i].n_value() < addr) && (fSymbols[i].n_value() > closestSymbol->n_value()) )
-						closestSymbol = &fSymbols[i];
-				}
+	// symbol at addr, or a thumb symbol one before it, whichever comes first in the symbol table
+	const mach_o::address_index::Entry* match = NULL;
+	typename mach_o::address_index::AddressIndex<P>::Range range = fSymbolIndex.exact(addr);
+	if ( range.first != range.second )
+		match = range.first;
+	if ( (addr & 1) != 0 ) {
+		range = fSymbolIndex.exact(addr & ~1ULL);
+		for (const mach_o::address_index::Entry* e = range.first; e != range.second; ++e) {
+			if ( e->thumbDef && ((match == NULL) || (e->order < match->order)) ) {
+				match = e;
+				break;
 			}
 		}
 	}
-	if ( closestSymbol != NULL ) {
-		*offset = addr - closestSymbol->n_value();
-		return &fStrings[closestSymbol->n_strx()];
+	if ( match != NULL )
+		return match->name;
+	if ( (offset != NULL) && (addr != 0) ) {
+		const mach_o::address_index::Entry* closestSymbol = fSymbolIndex.closest(addr-1);
+		if ( closestSymbol != NULL ) {
+			*offset = addr - closestSymbol->address;
+			return closestSymbol->name;
+		}
 	}
 	return "--anonymous function--";
 }
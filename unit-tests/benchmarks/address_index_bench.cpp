@@ -0,0 +1,174 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mach-o/nlist.h>
+
+#include <string>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+#include "MachOAddressIndex.hpp"
+#include "bench.h"
+
+
+namespace {
+
+typedef Pointer64<LittleEndian>		P;
+
+//
+// Symbolicating addresses the way dyldinfo -rebase/-bind and unwinddump do, in a
+// synthetic image of a few sections with locals and globals in symbol table order.
+//
+class AddressIndexBench : public bench::Fixture {
+public:
+						AddressIndexBench() : bench::Fixture("address_index") { }
+	virtual void		run(const bench::Config& config);
+private:
+	static const uint64_t kStartAddress = 0x100001000ULL;
+
+	void				makeSymbols(uint32_t count);
+	void				makeQueries(uint32_t count, std::vector<uint64_t>& addrs);
+	static const char*	linearClosest(const macho_nlist<P>* start, const macho_nlist<P>* end,
+									  const char* strings, uint64_t addr);
+
+	std::vector<macho_nlist<P>>	_symbols;
+	std::string					_strings;
+	uint64_t					_endAddress;
+};
+
+
+void AddressIndexBench::makeSymbols(uint32_t count)
+{
+	srandom(1);
+	_symbols.clear();
+	_strings.assign(1, '\0');
+	_symbols.resize(count);
+	// symbols in the nlist are in no particular address order, like locals from many .o files
+	std::vector<uint64_t> addresses(count);
+	uint64_t address = kStartAddress;
+	for (uint32_t i=0; i < count; ++i) {
+		addresses[i] = address;
+		address += 16 + (random() % 32) * 4;
+	}
+	_endAddress = address;
+	for (uint32_t i=count-1; i > 0; --i)
+		std::swap(addresses[i], addresses[random() % (i+1)]);
+	for (uint32_t i=0; i < count; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "_func_%u", i);
+		macho_nlist<P>& sym = _symbols[i];
+		memset(&sym, 0, sizeof(sym));
+		sym.set_n_strx((uint32_t)_strings.size());
+		sym.set_n_type(N_SECT | ((i % 4) == 0 ? N_EXT : 0));
+		sym.set_n_sect(1 + (addresses[i] * 3 / _endAddress));
+		sym.set_n_value(addresses[i]);
+		_strings.append(name);
+		_strings.push_back('\0');
+	}
+}
+
+void AddressIndexBench::makeQueries(uint32_t count, std::vector<uint64_t>& addrs)
+{
+	addrs.resize(count);
+	for (uint32_t i=0; i < count; ++i)
+		addrs[i] = kStartAddress + (((uint64_t)random() << 16) ^ random()) % (_endAddress - kStartAddress);
+}
+
+// what dyldinfo did before, for comparison
+const char* AddressIndexBench::linearClosest(const macho_nlist<P>* start, const macho_nlist<P>* end,
+											 const char* strings, uint64_t addr)
+{
+	const macho_nlist<P>* bestSymbol = NULL;
+	for (const macho_nlist<P>* s = start; s < end; ++s) {
+		if ( ((s->n_type() & N_TYPE) == N_SECT) && ((s->n_type() & N_STAB) == 0) ) {
+			if ( (s->n_value() <= addr) && ((bestSymbol == NULL) || (bestSymbol->n_value() < s->n_value())) )
+				bestSymbol = s;
+		}
+	}
+	return (bestSymbol != NULL) ? &strings[bestSymbol->n_strx()] : NULL;
+}
+
+
+void AddressIndexBench::run(const bench::Config& config)
+{
+	// the linear scan is O(queries x symbols), so it only gets a small image
+	const uint32_t smallCount = 20000 * config.scale;
+	makeSymbols(smallCount);
+	std::vector<uint64_t> queries;
+	makeQueries(smallCount, queries);
+	const macho_nlist<P>* const start = &_symbols[0];
+	const macho_nlist<P>* const end = start + _symbols.size();
+	const char* strings = _strings.c_str();
+
+	uint64_t linearSum = 0;
+	std::vector<double> seconds = bench::measure(config, [&]() { linearSum = 0; }, [&]() {
+		for (uint64_t addr : queries) {
+			const char* name = linearClosest(start, end, strings, addr);
+			linearSum = bench::checksum((uint8_t*)name, strlen(name), linearSum);
+		}
+	});
+	bench::report(name(), "linear scan small", queries.size(), seconds, linearSum);
+
+	// same queries, so the checksums must match
+	uint64_t indexSum = 0;
+	seconds = bench::measure(config, [&]() { indexSum = 0; }, [&]() {
+		mach_o::address_index::AddressIndex<P> index;
+		index.addSymbols(start, end, strings);
+		index.finalize();
+		for (uint64_t addr : queries) {
+			const char* name = index.closest(addr)->name;
+			indexSum = bench::checksum((uint8_t*)name, strlen(name), indexSum);
+		}
+	});
+	if ( indexSum != linearSum )
+		throw "AddressIndex results differ from linear scan";
+	bench::report(name(), "AddressIndex small", queries.size(), seconds, indexSum);
+
+	// 1M symbols, like the images that made the linear scan take minutes
+	const uint32_t largeCount = 1000000 * config.scale;
+	makeSymbols(largeCount);
+	makeQueries(largeCount, queries);
+	const macho_nlist<P>* const largeStart = &_symbols[0];
+	const macho_nlist<P>* const largeEnd = largeStart + _symbols.size();
+	const char* largeStrings = _strings.c_str();
+	seconds = bench::measure(config, [&]() { indexSum = 0; }, [&]() {
+		mach_o::address_index::AddressIndex<P> index;
+		index.addSymbols(largeStart, largeEnd, largeStrings);
+		index.finalize();
+		for (uint64_t addr : queries) {
+			const mach_o::address_index::Entry* entry = index.closest(addr);
+			if ( entry != NULL )
+				indexSum = bench::checksum((uint8_t*)entry->name, strlen(entry->name), indexSum);
+		}
+	});
+	bench::report(name(), "AddressIndex large", queries.size(), seconds, indexSum);
+}
+
+AddressIndexBench sAddressIndexBench;
+
+} // anonymous namespace
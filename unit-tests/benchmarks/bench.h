@@ -0,0 +1,93 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __LD_BENCH_H__
+#define __LD_BENCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <chrono>
+#include <vector>
+
+//
+// ld-bench times linker internals on inputs synthesized in-process, so no
+// compiler, SDK, or otool is needed to run it.  Each Fixture registers itself
+// by being instantiated as a static object.  Every measurement is printed to
+// stdout as one JSON object per line, so results can be collected over time.
+//
+namespace bench {
+
+struct Config {
+	uint32_t		scale;			// multiplier on the default input sizes
+	unsigned		iterations;		// timed runs per measurement, best and median are reported
+	const char*		only;			// if non-NULL, only run fixtures whose name contains this string
+};
+
+
+class Fixture {
+public:
+							Fixture(const char* name);
+	virtual					~Fixture() {}
+	const char*				name() const	{ return _name; }
+	virtual void			run(const Config& config) = 0;
+
+	static std::vector<Fixture*>&	all();
+private:
+	const char*				_name;
+};
+
+
+// prints one measurement as a JSON object
+extern void report(const char* fixture, const char* measurement, uint64_t items,
+					const std::vector<double>& seconds, uint64_t checksum);
+
+// FNV-1a, used by fixtures to checksum generated bytes so output changes are visible next to timing changes
+inline uint64_t checksum(const uint8_t* bytes, size_t len, uint64_t hash=0xcbf29ce484222325ULL)
+{
+	for (size_t i=0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// runs setup+work config.iterations times, timing only work
+template <typename S, typename W>
+std::vector<double> measure(const Config& config, S setup, W work)
+{
+	std::vector<double> seconds;
+	for (unsigned i=0; i < config.iterations; ++i) {
+		setup();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		work();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		seconds.push_back(std::chrono::duration<double>(end - start).count());
+	}
+	return seconds;
+}
+
+} // namespace bench
+
+#endif // __LD_BENCH_H__
@@ -0,0 +1,140 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dispatch/dispatch.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "MachOFileAbstraction.hpp"
+#include "ChainedFixups.hpp"
+#include "bench.h"
+
+
+namespace {
+
+//
+// Linking the fixup chains of a data segment the way OutputFile does for images dyld
+// loads, with the fixup offsets of each page in the order atoms were walked.  The serial
+// way is what writeAtoms() did before.  Both must leave the same bytes in the segment
+// and build the same page_start table.
+//
+class ChainedFixupsBench : public bench::Fixture {
+public:
+						ChainedFixupsBench() : bench::Fixture("chained_fixups") { }
+	virtual void		run(const bench::Config& config);
+private:
+	static const uint32_t kPageSize = 0x4000;
+	static const uint32_t kFixupsPerPage = 1024;	// half of the 8-byte slots on a 16KB page
+
+	struct PageInfo {
+		std::vector<uint16_t>	fixupOffsets;
+	};
+
+	void				makeSegment(uint64_t fixupCount);
+	static uint64_t		checksum(const std::vector<uint8_t>& segment, const std::vector<uint16_t>& starts);
+
+	std::vector<uint8_t>	_original;		// segment content before chaining
+	std::vector<PageInfo>	_unsortedPages;
+};
+
+
+void ChainedFixupsBench::makeSegment(uint64_t fixupCount)
+{
+	srandom(1);
+	const uint32_t pageCount = (uint32_t)((fixupCount + kFixupsPerPage - 1) / kFixupsPerPage);
+	_original.resize((size_t)pageCount * kPageSize);
+	_unsortedPages.clear();
+	_unsortedPages.resize(pageCount);
+	std::vector<uint16_t> slots(kPageSize/8);
+	for (uint32_t i=0; i < slots.size(); ++i)
+		slots[i] = i * 8;
+	for (uint32_t p=0; p < pageCount; ++p) {
+		uint8_t* page = &_original[(size_t)p * kPageSize];
+		for (uint32_t i=0; i < kPageSize/4; ++i)
+			((uint32_t*)page)[i] = (uint32_t)random();
+		for (uint32_t i=(uint32_t)slots.size()-1; i > 0; --i)
+			std::swap(slots[i], slots[random() % (i+1)]);
+		std::vector<uint16_t>& offsets = _unsortedPages[p].fixupOffsets;
+		offsets.assign(slots.begin(), slots.begin() + kFixupsPerPage);
+		for (uint16_t offset : offsets) {
+			dyld_chained_ptr_64_rebase* loc = (dyld_chained_ptr_64_rebase*)&page[offset];
+			memset(loc, 0, sizeof(*loc));
+			loc->target = (((uint64_t)random() << 16) ^ random()) & 0xFFFFFFFFFULL;
+		}
+	}
+}
+
+uint64_t ChainedFixupsBench::checksum(const std::vector<uint8_t>& segment, const std::vector<uint16_t>& starts)
+{
+	uint64_t sum = bench::checksum(&segment[0], segment.size());
+	return bench::checksum((uint8_t*)&starts[0], starts.size()*sizeof(uint16_t), sum);
+}
+
+
+void ChainedFixupsBench::run(const bench::Config& config)
+{
+	const uint64_t fixupCount = 5000000ULL * config.scale;
+	makeSegment(fixupCount);
+
+	std::vector<uint8_t> segment;
+	std::vector<PageInfo> pages;
+	std::vector<uint16_t> starts(_unsortedPages.size());
+
+	// what OutputFile did before, one page after another
+	std::vector<double> seconds = bench::measure(config, [&]() { segment = _original; pages = _unsortedPages; }, [&]() {
+		for (PageInfo& page : pages)
+			std::sort(page.fixupOffsets.begin(), page.fixupOffsets.end());
+		for (size_t i=0; i < pages.size(); ++i)
+			ld::chained_fixups::chainPage(&segment[i * kPageSize], pages[i].fixupOffsets, DYLD_CHAINED_PTR_64_OFFSET);
+		for (size_t i=0; i < pages.size(); ++i)
+			starts[i] = pages[i].fixupOffsets.empty() ? DYLD_CHAINED_PTR_START_NONE : pages[i].fixupOffsets.front();
+	});
+	const uint64_t serialSum = checksum(segment, starts);
+	bench::report(name(), "serial pages", fixupCount, seconds, serialSum);
+
+	seconds = bench::measure(config, [&]() { segment = _original; pages = _unsortedPages; }, [&]() {
+		std::vector<PageInfo*> allPages;
+		for (PageInfo& page : pages)
+			allPages.push_back(&page);
+		ld::chained_fixups::sortPages(allPages);
+		uint8_t* segmentStart = &segment[0];
+		const PageInfo* pageArray = pages.data();
+		dispatch_apply(pages.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+			ld::chained_fixups::chainPage(&segmentStart[i * kPageSize], pageArray[i].fixupOffsets, DYLD_CHAINED_PTR_64_OFFSET);
+		});
+		ld::chained_fixups::pageStarts(pages, &starts[0]);
+	});
+	const uint64_t parallelSum = checksum(segment, starts);
+	if ( parallelSum != serialSum )
+		throw "parallel chains differ from serial chains";
+	bench::report(name(), "parallel pages", fixupCount, seconds, parallelSum);
+}
+
+ChainedFixupsBench sChainedFixupsBench;
+
+} // anonymous namespace
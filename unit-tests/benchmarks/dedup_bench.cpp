@@ -0,0 +1,196 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "options_stub.h"
+#include "ld.hpp"
+#include "passes/code_dedup.h"
+#include "bench.h"
+
+
+namespace {
+
+class FunctionAtom : public ld::Atom {
+public:
+								FunctionAtom(const char* nm, const std::vector<uint8_t>& content)
+									: ld::Atom(sTextSection, ld::Atom::definitionRegular, ld::Atom::combineNever,
+											ld::Atom::scopeLinkageUnit, ld::Atom::typeUnclassified,
+											ld::Atom::symbolTableIn, false, false, false, ld::Atom::Alignment(2)),
+									  _name(nm), _content(content) { setAutoHide(); }
+
+	virtual const ld::File*		file() const					{ return NULL; }
+	virtual const char*			name() const					{ return _name; }
+	virtual uint64_t			size() const					{ return _content.size(); }
+	virtual uint64_t			objectAddress() const			{ return 0; }
+	virtual const uint8_t*		rawContentPointer() const		{ return _content.data(); }
+	virtual void				copyRawContent(uint8_t buffer[]) const { memcpy(buffer, _content.data(), _content.size()); }
+	virtual ld::Fixup::iterator	fixupsBegin() const				{ return (ld::Fixup*)_fixups.data(); }
+	virtual ld::Fixup::iterator	fixupsEnd() const				{ return (ld::Fixup*)_fixups.data() + _fixups.size(); }
+
+	void						addCall(uint32_t offset, const ld::Atom* target) {
+									_fixups.push_back(ld::Fixup(offset, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressX86BranchPCRel32, target));
+								}
+
+	static ld::Section			sTextSection;
+private:
+	const char*					_name;
+	const std::vector<uint8_t>&	_content;
+	std::vector<ld::Fixup>		_fixups;
+};
+
+ld::Section FunctionAtom::sTextSection("__TEXT", "__text", ld::Section::typeCode);
+
+
+// just enough of the linker's state for a pass to walk sections and atoms
+class BenchState : public ld::Internal {
+public:
+	virtual uint64_t					assignFileOffsets()							{ return 0; }
+	virtual void						setSectionSizesAndAlignments()				{ }
+	virtual ld::Internal::FinalSection*	addAtom(const ld::Atom&)					{ return NULL; }
+	virtual ld::Internal::FinalSection*	getFinalSection(const ld::Section& sect)	{ return NULL; }
+};
+
+
+//
+// A C++ image where templates are instantiated in many translation units: each distinct
+// function body is emitted several times as an auto-hide function, and calls other bodies
+// through whichever copy its translation unit had.  So deciding two copies are duplicates
+// means comparing the copies they call, recursively, as in a real image.
+//
+class DedupBench : public bench::Fixture {
+public:
+						DedupBench() : bench::Fixture("dedup") { }
+	virtual void		run(const bench::Config& config);
+private:
+	struct Body {
+		std::vector<uint8_t>	content;
+		std::vector<uint32_t>	callees;		// indexes of lower numbered bodies
+		uint32_t				copies;
+	};
+
+	void				makeBodies(uint32_t count);
+	void				makeImage(BenchState& state);
+
+	std::vector<Body>						_bodies;
+	std::vector<std::string>				_names;
+	// dedup caches hashes by atom address for the life of the process, so atoms from earlier
+	// iterations are kept until the end of run() to stop later ones reusing their addresses
+	std::vector<std::unique_ptr<FunctionAtom>>	_atoms;
+	std::vector<std::unique_ptr<BenchState>>	_states;
+};
+
+
+void DedupBench::makeBodies(uint32_t count)
+{
+	srandom(1);
+	_bodies.clear();
+	_bodies.resize(count);
+	for (uint32_t b=0; b < count; ++b) {
+		Body& body = _bodies[b];
+		// a few sizes are very common, as with small accessors and wrappers
+		const uint32_t size = ((random() % 4) == 0) ? 16 + (random() % 8) * 8 : 64 + (random() % 48) * 4;
+		for (uint32_t i=0; i < size; ++i)
+			body.content.push_back((uint8_t)(((random() % 4) == 0) ? random() : b));
+		const uint32_t calls = (b == 0) ? 0 : (uint32_t)(random() % 4);
+		for (uint32_t c=0; c < calls; ++c)
+			body.callees.push_back((uint32_t)(random() % b));
+		// most templates are instantiated a few times, some in nearly every file
+		body.copies = ((random() % 16) == 0) ? 20 + (random() % 40) : 1 + (random() % 4);
+	}
+	_names.clear();
+	for (uint32_t b=0; b < count; ++b) {
+		for (uint32_t c=0; c < _bodies[b].copies; ++c) {
+			char name[64];
+			snprintf(name, sizeof(name), "__ZN7project8templateILi%uEE3runEv.%u", b, c);
+			_names.push_back(name);
+		}
+	}
+}
+
+void DedupBench::makeImage(BenchState& state)
+{
+	ld::Internal::FinalSection* text = new ld::Internal::FinalSection(FunctionAtom::sTextSection);
+	state.sections.push_back(text);
+	std::vector<std::vector<const FunctionAtom*>> copiesOfBody(_bodies.size());
+	size_t nameIndex = 0;
+	for (uint32_t b=0; b < _bodies.size(); ++b) {
+		const Body& body = _bodies[b];
+		for (uint32_t c=0; c < body.copies; ++c) {
+			FunctionAtom* atom = new FunctionAtom(_names[nameIndex++].c_str(), body.content);
+			_atoms.emplace_back(atom);
+			// each copy calls some copy of each callee, the call sites are at the same offsets in every copy
+			for (size_t i=0; i < body.callees.size(); ++i) {
+				const std::vector<const FunctionAtom*>& calleeCopies = copiesOfBody[body.callees[i]];
+				atom->addCall((uint32_t)(i * 8), calleeCopies[random() % calleeCopies.size()]);
+			}
+			copiesOfBody[b].push_back(atom);
+			text->atoms.push_back(atom);
+			state.atomToSection[atom] = text;
+		}
+	}
+}
+
+
+void DedupBench::run(const bench::Config& config)
+{
+	const uint32_t bodyCount = 10000 * config.scale;
+	makeBodies(bodyCount);
+	_atoms.clear();
+	_states.clear();
+
+	Options options;
+	options.fArchitecture = CPU_TYPE_X86_64;
+	BenchState* state = NULL;
+	size_t atomCount = 0;
+	std::vector<double> seconds = bench::measure(config,
+		[&]() {
+			srandom(2);
+			state = new BenchState();
+			_states.emplace_back(state);
+			makeImage(*state);
+			atomCount = state->sections[0]->atoms.size();
+		},
+		[&]() { ld::passes::dedup::doPass(options, *state); });
+	uint64_t sum = 0;
+	for (const ld::Atom* atom : state->sections[0]->atoms)
+		sum = bench::checksum((uint8_t*)atom->name(), strlen(atom->name()), sum);
+	bench::report(name(), "deduplicate template copies", atomCount, seconds, sum);
+
+	for (std::unique_ptr<BenchState>& s : _states)
+		delete s->sections[0];
+	_states.clear();
+	_atoms.clear();
+}
+
+DedupBench sDedupBench;
+
+} // anonymous namespace
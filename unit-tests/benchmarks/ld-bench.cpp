@@ -0,0 +1,145 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "bench.h"
+
+
+// ld-bench only links the parts of the linker it measures, so provide the diagnostics they use
+void throwf(const char* format, ...)
+{
+	va_list	list;
+	char*	p;
+	va_start(list, format);
+	vasprintf(&p, format, list);
+	va_end(list);
+
+	const char*	t = p;
+	throw t;
+}
+
+void warning(const char* format, ...)
+{
+	va_list	list;
+	fprintf(stderr, "ld-bench: warning: ");
+	va_start(list, format);
+	vfprintf(stderr, format, list);
+	va_end(list);
+	fprintf(stderr, "\n");
+}
+
+
+namespace bench {
+
+Fixture::Fixture(const char* name)
+	: _name(name)
+{
+	all().push_back(this);
+}
+
+std::vector<Fixture*>& Fixture::all()
+{
+	static std::vector<Fixture*> sFixtures;
+	return sFixtures;
+}
+
+
+void report(const char* fixture, const char* measurement, uint64_t items,
+			const std::vector<double>& seconds, uint64_t checksum)
+{
+	std::vector<double> sorted = seconds;
+	std::sort(sorted.begin(), sorted.end());
+	const double best = sorted.empty() ? 0.0 : sorted.front();
+	const double median = sorted.empty() ? 0.0 : sorted[sorted.size()/2];
+	printf("{\"fixture\":\"%s\", \"measurement\":\"%s\", \"items\":%llu, \"iterations\":%lu, "
+		   "\"best_ms\":%.3f, \"median_ms\":%.3f, \"items_per_sec\":%.0f, \"checksum\":\"0x%016llX\"}\n",
+		   fixture, measurement, (unsigned long long)items, sorted.size(),
+		   best*1000.0, median*1000.0, (best > 0.0) ? items/best : 0.0, (unsigned long long)checksum);
+	fflush(stdout);
+}
+
+} // namespace bench
+
+
+static void usage()
+{
+	fprintf(stderr, "usage: ld-bench [-scale N] [-iterations N] [-only substring] [-list]\n");
+}
+
+
+int main(int argc, const char* argv[])
+{
+	bench::Config config;
+	config.scale = 1;
+	config.iterations = 5;
+	config.only = NULL;
+	bool listOnly = false;
+
+	for (int i=1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if ( (strcmp(arg, "-scale") == 0) && (i+1 < argc) ) {
+			config.scale = atoi(argv[++i]);
+		}
+		else if ( (strcmp(arg, "-iterations") == 0) && (i+1 < argc) ) {
+			config.iterations = atoi(argv[++i]);
+		}
+		else if ( (strcmp(arg, "-only") == 0) && (i+1 < argc) ) {
+			config.only = argv[++i];
+		}
+		else if ( strcmp(arg, "-list") == 0 ) {
+			listOnly = true;
+		}
+		else {
+			usage();
+			return 1;
+		}
+	}
+	if ( (config.scale == 0) || (config.iterations == 0) ) {
+		usage();
+		return 1;
+	}
+
+	try {
+		for (bench::Fixture* fixture : bench::Fixture::all()) {
+			if ( (config.only != NULL) && (strstr(fixture->name(), config.only) == NULL) )
+				continue;
+			if ( listOnly )
+				printf("%s\n", fixture->name());
+			else
+				fixture->run(config);
+		}
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "ld-bench failed: %s\n", msg);
+		return 1;
+	}
+	return 0;
+}
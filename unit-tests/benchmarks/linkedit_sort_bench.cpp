@@ -0,0 +1,161 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "RadixSort.hpp"
+#include "bench.h"
+
+
+namespace {
+
+//
+// Sorting the binding info of a big app before encoding it, the way BindingInfoAtom
+// needs it: by library, symbol, type, flags (descending), then address.  The std::sort
+// is what the encoders did before, comparing names with strcmp().  Both sorts must put
+// the bindings in the same order.
+//
+class LinkEditSortBench : public bench::Fixture {
+public:
+						LinkEditSortBench() : bench::Fixture("linkedit_sort") { }
+	virtual void		run(const bench::Config& config);
+private:
+	// same fields and order as OutputFile::BindingInfo
+	struct BindingInfo {
+		uint8_t			_type;
+		uint8_t			_flags;
+		uint16_t		_threadedBindOrdinal;
+		int				_libraryOrdinal;
+		const char*		_symbolName;
+		uint64_t		_address;
+		int64_t			_addend;
+
+		bool operator<(const BindingInfo& rhs) const {
+			if ( this->_libraryOrdinal != rhs._libraryOrdinal )
+				return  (this->_libraryOrdinal < rhs._libraryOrdinal );
+			if ( this->_symbolName != rhs._symbolName )
+				return ( strcmp(this->_symbolName, rhs._symbolName) < 0 );
+			if ( this->_type != rhs._type )
+				return  (this->_type < rhs._type );
+			if ( this->_flags != rhs._flags )
+				return  (this->_flags >= rhs._flags );
+			return  (this->_address < rhs._address );
+		}
+	};
+
+	void						makeBindings(uint64_t bindCount, uint32_t symbolCount);
+	static uint64_t				checksum(const std::vector<BindingInfo>& info);
+
+	std::vector<std::string>	_symbols;
+	std::vector<BindingInfo>	_unsorted;
+};
+
+
+void LinkEditSortBench::makeBindings(uint64_t bindCount, uint32_t symbolCount)
+{
+	srandom(1);
+	_symbols.clear();
+	_symbols.reserve(symbolCount);
+	for (uint32_t i=0; i < symbolCount; ++i) {
+		char name[64];
+		snprintf(name, sizeof(name), "_$s10Foundation%uClassC%ldMethod", i % 97, random());
+		_symbols.push_back(name);
+	}
+	// every pointer slot in the data segments is bound at most once
+	std::vector<uint64_t> addresses(bindCount);
+	for (uint64_t i=0; i < bindCount; ++i)
+		addresses[i] = 0x100008000ULL + i*8;
+	for (uint64_t i=bindCount-1; i > 0; --i)
+		std::swap(addresses[i], addresses[random() % (i+1)]);
+	_unsorted.clear();
+	_unsorted.reserve(bindCount);
+	for (uint64_t i=0; i < bindCount; ++i) {
+		BindingInfo bind;
+		bind._type = 1 + (random() % 3);
+		bind._flags = ((random() % 8) == 0) ? 1 : 0;
+		bind._threadedBindOrdinal = 0;
+		bind._libraryOrdinal = (int)(random() % 200) - 3;	// includes the special (negative) ordinals
+		bind._symbolName = _symbols[random() % symbolCount].c_str();
+		bind._address = addresses[i];
+		bind._addend = 0;
+		_unsorted.push_back(bind);
+	}
+}
+
+uint64_t LinkEditSortBench::checksum(const std::vector<BindingInfo>& info)
+{
+	uint64_t sum = 0xcbf29ce484222325ULL;
+	for (const BindingInfo& bind : info) {
+		sum = bench::checksum((uint8_t*)&bind._address, sizeof(bind._address), sum);
+		sum = bench::checksum((uint8_t*)bind._symbolName, strlen(bind._symbolName), sum);
+	}
+	return sum;
+}
+
+
+void LinkEditSortBench::run(const bench::Config& config)
+{
+	const uint64_t bindCount = 10000000ULL * config.scale;
+	makeBindings(bindCount, 200000);
+
+	std::vector<BindingInfo> info;
+	std::vector<double> seconds = bench::measure(config, [&]() { info = _unsorted; }, [&]() {
+		std::sort(info.begin(), info.end());
+	});
+	const uint64_t stdSortSum = checksum(info);
+	bench::report(name(), "std::sort", bindCount, seconds, stdSortSum);
+
+	// same keys as OutputFile::sortBindingInfo()
+	seconds = bench::measure(config, [&]() { info = _unsorted; }, [&]() {
+		const BindingInfo* infoArray = info.data();
+		std::vector<uint32_t> symbolRanks;
+		const uint32_t rankCount = ld::radix_sort::rankNames(info.size(), [=](uint32_t i) { return infoArray[i]._symbolName; }, symbolRanks);
+		const uint32_t* ranks = symbolRanks.data();
+		const unsigned rankBits = (rankCount > 1) ? (32 - __builtin_clz(rankCount - 1)) : 0;
+		int minOrdinal = 0;
+		for (const BindingInfo& bind : info)
+			minOrdinal = std::min(minOrdinal, bind._libraryOrdinal);
+		ld::radix_sort::Sorter sorter(info.size());
+		sorter.sortBy([=](uint32_t i) { return infoArray[i]._address; });
+		sorter.sortBy([=](uint32_t i) { return ((uint64_t)infoArray[i]._type << 8) | (uint8_t)~infoArray[i]._flags; });
+		sorter.sortBy([=](uint32_t i) { return ((uint64_t)((int64_t)infoArray[i]._libraryOrdinal - minOrdinal) << rankBits) | ranks[i]; });
+		sorter.apply(info);
+	});
+	const uint64_t radixSum = checksum(info);
+	if ( radixSum != stdSortSum )
+		throw "radix sorted bindings differ from std::sort";
+	bench::report(name(), "radix sort", bindCount, seconds, radixSum);
+}
+
+LinkEditSortBench sLinkEditSortBench;
+
+} // anonymous namespace
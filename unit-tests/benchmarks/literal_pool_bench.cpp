@@ -0,0 +1,147 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dispatch/dispatch.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "ld.hpp"
+#include "LiteralPool.hpp"
+#include "bench.h"
+
+
+namespace {
+
+//
+// Coalescing the __cstring literals of many objects, where most strings (selector
+// names, type encodings, assertion messages) show up in several objects.  Slots are
+// handed out in object order either way, so both ways must produce the same slots.
+//
+class LiteralPoolBench : public bench::Fixture {
+public:
+						LiteralPoolBench() : bench::Fixture("literal_pool") { }
+	virtual void		run(const bench::Config& config);
+private:
+	struct Object {
+		std::string				strings;
+		std::vector<uint32_t>	offsets;
+	};
+
+	void				makeObjects(uint32_t objectCount, uint32_t stringsPerObject);
+
+	std::vector<Object>	_objects;
+};
+
+
+void LiteralPoolBench::makeObjects(uint32_t objectCount, uint32_t stringsPerObject)
+{
+	srandom(1);
+	_objects.clear();
+	_objects.resize(objectCount);
+	for (uint32_t o=0; o < objectCount; ++o) {
+		Object& obj = _objects[o];
+		obj.offsets.reserve(stringsPerObject);
+		for (uint32_t s=0; s < stringsPerObject; ++s) {
+			char str[128];
+			if ( (random() % 4) != 0 )
+				snprintf(str, sizeof(str), "initWithCoder:options:%ld", random() % 20000);
+			else
+				snprintf(str, sizeof(str), "/Sources/project/module%u/File%u.swift: unexpected value", o, s);
+			obj.offsets.push_back((uint32_t)obj.strings.size());
+			obj.strings.append(str);
+			obj.strings.push_back('\0');
+		}
+	}
+}
+
+
+void LiteralPoolBench::run(const bench::Config& config)
+{
+	const uint32_t objectCount = 2000 * config.scale;
+	const uint32_t stringsPerObject = 500;
+	makeObjects(objectCount, stringsPerObject);
+	const uint64_t stringCount = (uint64_t)objectCount * stringsPerObject;
+
+	// what the SymbolTable did before, one string at a time on the resolver thread
+	typedef std::unordered_map<const char*, uint32_t, ld::CStringHash, ld::CStringEquals> StringToSlot;
+	uint64_t tableSum = 0;
+	std::vector<double> seconds = bench::measure(config, [&]() { tableSum = 0; }, [&]() {
+		StringToSlot table(6151);
+		uint32_t nextSlot = 0;
+		for (const Object& obj : _objects) {
+			const char* strings = obj.strings.c_str();
+			for (uint32_t offset : obj.offsets) {
+				StringToSlot::iterator pos = table.find(&strings[offset]);
+				uint32_t slot;
+				if ( pos != table.end() ) {
+					slot = pos->second;
+				}
+				else {
+					slot = nextSlot++;
+					table[&strings[offset]] = slot;
+				}
+				tableSum = bench::checksum((uint8_t*)&slot, sizeof(slot), tableSum);
+			}
+		}
+	});
+	bench::report(name(), "serial cstring table", stringCount, seconds, tableSum);
+
+	// each object interned by its own "parser thread", then slots assigned in object order
+	uint64_t poolSum = 0;
+	seconds = bench::measure(config, [&]() { poolSum = 0; }, [&]() {
+		ld::LiteralPool pool;
+		std::vector<std::vector<uint32_t>> indexes(_objects.size());
+		const Object* objects = &_objects[0];
+		std::vector<uint32_t>* objectIndexes = &indexes[0];
+		ld::LiteralPool* sharedPool = &pool;
+		dispatch_apply(_objects.size(), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t o) {
+			const char* strings = objects[o].strings.c_str();
+			objectIndexes[o].reserve(objects[o].offsets.size());
+			for (uint32_t offset : objects[o].offsets)
+				objectIndexes[o].push_back(sharedPool->internCString(&strings[offset]));
+		});
+		std::vector<uint32_t> slots(pool.count(), UINT32_MAX);
+		uint32_t nextSlot = 0;
+		for (const std::vector<uint32_t>& objIndexes : indexes) {
+			for (uint32_t index : objIndexes) {
+				if ( slots[index] == UINT32_MAX )
+					slots[index] = nextSlot++;
+				poolSum = bench::checksum((uint8_t*)&slots[index], sizeof(uint32_t), poolSum);
+			}
+		}
+	});
+	if ( poolSum != tableSum )
+		throw "LiteralPool slots differ from cstring table";
+	bench::report(name(), "parallel LiteralPool", stringCount, seconds, poolSum);
+}
+
+LiteralPoolBench sLiteralPoolBench;
+
+} // anonymous namespace
@@ -0,0 +1,81 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#ifndef __LD_BENCH_OPTIONS_STUB_H__
+#define __LD_BENCH_OPTIONS_STUB_H__
+
+//
+// The real Options is built by Options.cpp from a command line, and pulls in tapi, libLTO
+// and the snapshot code.  Linker sources that only read a few settings (SymbolTable.cpp,
+// passes/code_dedup.cpp) are compiled into ld-bench with this header forced in first
+// (see the Makefile).  It claims the include guards of Options.h and InputFiles.h, so the
+// sources see this Options instead.  It lives in namespace bench so nothing it defines can
+// collide at link time with the real Options used by other objects in ld-bench.  Add to
+// it only what a benchmarked source calls.
+//
+
+#define __OPTIONS__
+#define __INPUT_FILES_H__
+
+#include <mach/machine.h>
+
+#include "ld.hpp"
+
+
+namespace bench {
+
+class Options
+{
+public:
+	enum OutputKind { kDynamicExecutable, kStaticExecutable, kDynamicLibrary, kDynamicBundle, kObjectFile, kDyld, kPreload, kKextBundle };
+	enum Treatment { kError, kWarning, kSuppress, kNULL, kInvalid };
+	enum CommonsMode { kCommonsIgnoreDylibs, kCommonsOverriddenByDylibs, kCommonsConflictsDylibsError };
+
+							Options() : fOutputKind(kDynamicLibrary), fArchitecture(CPU_TYPE_ARM64),
+										fCommonsMode(kCommonsIgnoreDylibs), fDeadStrip(false),
+										fWarnCommons(false), fDeDupe(true), fVerboseDeDupe(false) { }
+
+	OutputKind				outputKind() const				{ return fOutputKind; }
+	cpu_type_t				architecture() const			{ return fArchitecture; }
+	CommonsMode				commonsMode() const				{ return fCommonsMode; }
+	bool					deadCodeStrip() const			{ return fDeadStrip; }
+	bool					warnCommons() const				{ return fWarnCommons; }
+	bool					deduplicateFunctions() const	{ return fDeDupe; }
+	bool					verboseDeduplicate() const		{ return fVerboseDeDupe; }
+	const char*				demangleSymbol(const char* sym) const { return sym; }
+
+	OutputKind				fOutputKind;
+	cpu_type_t				fArchitecture;
+	CommonsMode				fCommonsMode;
+	bool					fDeadStrip;
+	bool					fWarnCommons;
+	bool					fDeDupe;
+	bool					fVerboseDeDupe;
+};
+
+} // namespace bench
+
+using bench::Options;
+
+#endif // __LD_BENCH_OPTIONS_STUB_H__
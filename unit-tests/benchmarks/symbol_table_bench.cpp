@@ -0,0 +1,181 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "options_stub.h"
+#include "ld.hpp"
+#include "SymbolTable.h"
+#include "bench.h"
+
+
+namespace {
+
+class NamedAtom : public ld::Atom {
+public:
+								NamedAtom(const char* nm)
+									: ld::Atom(sTextSection, ld::Atom::definitionRegular, ld::Atom::combineNever,
+											ld::Atom::scopeGlobal, ld::Atom::typeUnclassified,
+											ld::Atom::symbolTableIn, false, false, false, ld::Atom::Alignment(4)),
+									  _name(nm) { }
+
+	virtual const ld::File*		file() const					{ return NULL; }
+	virtual const char*			name() const					{ return _name; }
+	virtual uint64_t			size() const					{ return 16; }
+	virtual uint64_t			objectAddress() const			{ return 0; }
+	virtual void				copyRawContent(uint8_t buffer[]) const { }
+
+	static ld::Section			sTextSection;
+private:
+	const char*					_name;
+};
+
+ld::Section NamedAtom::sTextSection("__TEXT", "__text", ld::Section::typeCode);
+
+
+//
+// N objects of M atoms each.  Every atom has a global name, and a few fixups to names
+// defined in other objects or left undefined (to be found in dylibs).  Each object has
+// its own string pool, so the same name in two objects is two different pointers.
+// The atoms are added to, and the fixups looked up in, the linker's real SymbolTable.
+//
+class SymbolTableBench : public bench::Fixture {
+public:
+						SymbolTableBench() : bench::Fixture("symbol_table") { }
+	virtual void		run(const bench::Config& config);
+private:
+	struct Object {
+		std::string				strings;
+		std::vector<uint32_t>	defined;		// offsets into strings
+		std::vector<uint32_t>	referenced;
+	};
+
+	// what the Resolver owns around its SymbolTable
+	struct Table {
+							Table() : symbolTable(options, indirectBindingTable, literalPool) { }
+		Options							options;
+		std::vector<const ld::Atom*>	indirectBindingTable;
+		ld::LiteralPool					literalPool;
+		ld::tool::SymbolTable			symbolTable;
+	};
+
+	void				makeObjects(uint32_t objectCount, uint32_t atomsPerObject);
+	void				addAtoms(Table& table);
+
+	std::vector<Object>						_objects;
+	std::vector<std::unique_ptr<NamedAtom>>	_atoms;		// in the same order as the objects' defined names
+};
+
+
+void SymbolTableBench::makeObjects(uint32_t objectCount, uint32_t atomsPerObject)
+{
+	srandom(1);
+	_objects.clear();
+	_atoms.clear();
+	_objects.resize(objectCount);
+	for (uint32_t o=0; o < objectCount; ++o) {
+		Object& obj = _objects[o];
+		obj.defined.reserve(atomsPerObject);
+		obj.referenced.reserve(atomsPerObject*4);
+		for (uint32_t a=0; a < atomsPerObject; ++a) {
+			char name[128];
+			snprintf(name, sizeof(name), "__ZN7project6module%u8functionEi%u", o, a);
+			obj.defined.push_back((uint32_t)obj.strings.size());
+			obj.strings.append(name);
+			obj.strings.push_back('\0');
+			// about four fixups per atom, mostly to other objects, some to dylib functions
+			for (int f=0; f < 4; ++f) {
+				if ( (random() % 8) == 0 )
+					snprintf(name, sizeof(name), "_libsystem_function%ld", random() % 2000);
+				else
+					snprintf(name, sizeof(name), "__ZN7project6module%ld8functionEi%ld", random() % objectCount, random() % atomsPerObject);
+				obj.referenced.push_back((uint32_t)obj.strings.size());
+				obj.strings.append(name);
+				obj.strings.push_back('\0');
+			}
+		}
+		// the string pool is complete, so names can point into it
+		for (uint32_t offset : obj.defined)
+			_atoms.emplace_back(new NamedAtom(&obj.strings[offset]));
+	}
+}
+
+// adds each object's atoms, as the Resolver does when a file is loaded
+void SymbolTableBench::addAtoms(Table& table)
+{
+	for (const std::unique_ptr<NamedAtom>& atom : _atoms)
+		table.symbolTable.add(*atom, Options::kError);
+}
+
+
+void SymbolTableBench::run(const bench::Config& config)
+{
+	const uint32_t objectCount = 1000 * config.scale;
+	const uint32_t atomsPerObject = 200;
+	makeObjects(objectCount, atomsPerObject);
+	uint64_t definedCount = 0;
+	uint64_t referenceCount = 0;
+	for (const Object& obj : _objects) {
+		definedCount += obj.defined.size();
+		referenceCount += obj.referenced.size();
+	}
+
+	Table* table = NULL;
+	std::vector<double> seconds = bench::measure(config,
+		[&]() { delete table; table = new Table(); },
+		[&]() { addAtoms(*table); });
+	bench::report(name(), "add defined atoms", definedCount, seconds, table->indirectBindingTable.size());
+
+	// binding by-name fixups to slots, most names are already in the table
+	uint64_t sum = 0;
+	seconds = bench::measure(config,
+		[&]() {
+			delete table;
+			table = new Table();
+			addAtoms(*table);
+			sum = 0;
+		},
+		[&]() {
+			for (const Object& obj : _objects) {
+				const char* strings = obj.strings.c_str();
+				for (uint32_t offset : obj.referenced) {
+					uint32_t slot = table->symbolTable.findSlotForName(&strings[offset]);
+					sum = bench::checksum((uint8_t*)&slot, sizeof(slot), sum);
+				}
+			}
+		});
+	bench::report(name(), "lookup referenced names", referenceCount, seconds, sum);
+	delete table;
+}
+
+SymbolTableBench sSymbolTableBench;
+
+} // anonymous namespace
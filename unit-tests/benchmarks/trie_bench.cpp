@@ -0,0 +1,176 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mach-o/loader.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "MachOFileAbstraction.hpp"
+#include "MachOTrie.hpp"
+#include "bench.h"
+
+
+namespace {
+
+//
+// Builds and parses the export trie of a synthetic C++ dylib: namespaces of classes
+// with many methods each, so names share long mangled prefixes like real exports do.
+// A few exports are re-exports from another dylib or stub-and-resolver functions.
+//
+class TrieBench : public bench::Fixture {
+public:
+						TrieBench() : bench::Fixture("export_trie") { }
+	virtual void		run(const bench::Config& config);
+private:
+	void				makeExports(uint32_t count);
+	static uint64_t		checksumEntries(const std::vector<mach_o::trie::Entry>& entries);
+	static void			freeNames(std::vector<mach_o::trie::Entry>& entries);
+
+	std::vector<std::string>				_names;
+	std::vector<mach_o::trie::Entry>		_exports;
+};
+
+
+void TrieBench::makeExports(uint32_t count)
+{
+	srandom(1);
+	_names.clear();
+	_names.reserve(count);
+	_exports.clear();
+	_exports.reserve(count);
+	uint64_t address = 0x1000;
+	uint32_t ns = 0;
+	uint32_t cls = 0;
+	uint32_t method = 0;
+	for (uint32_t i=0; i < count; ++i) {
+		// about 40 methods per class, 50 classes per namespace, with some plain C functions mixed in
+		if ( (random() % 40) == 0 ) {
+			method = 0;
+			if ( (++cls % 50) == 0 )
+				++ns;
+		}
+		char name[128];
+		if ( (random() % 10) == 0 )
+			snprintf(name, sizeof(name), "_c_function_%u", i);
+		else
+			snprintf(name, sizeof(name), "__ZN9Framework%u5Class%u6method%uEv", ns, cls, method++);
+		_names.push_back(name);
+
+		mach_o::trie::Entry entry;
+		entry.name			= NULL;
+		entry.address		= address;
+		entry.flags			= EXPORT_SYMBOL_FLAGS_KIND_REGULAR;
+		entry.other			= 0;
+		entry.importName	= NULL;
+		const long kind = random() % 100;
+		if ( kind < 2 ) {
+			entry.flags		= EXPORT_SYMBOL_FLAGS_REEXPORT;
+			entry.address	= 0;
+			entry.other		= 1 + (random() % 4);	// dylib ordinal
+		}
+		else if ( kind < 3 ) {
+			entry.flags		|= EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER;
+			entry.other		= address + 8;			// resolver
+		}
+		else if ( kind < 10 ) {
+			entry.flags		|= EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION;
+		}
+		_exports.push_back(entry);
+		address += 16 + (random() % 64) * 4;
+	}
+	// names are stable now that the vector is done growing
+	for (uint32_t i=0; i < count; ++i) {
+		_exports[i].name = _names[i].c_str();
+		// re-exported under the same name in the other dylib
+		if ( _exports[i].flags & EXPORT_SYMBOL_FLAGS_REEXPORT )
+			_exports[i].importName = _exports[i].name;
+	}
+}
+
+uint64_t TrieBench::checksumEntries(const std::vector<mach_o::trie::Entry>& entries)
+{
+	uint64_t sum = 0;
+	for (const mach_o::trie::Entry& entry : entries) {
+		sum = bench::checksum((uint8_t*)entry.name, strlen(entry.name), sum);
+		uint64_t fields[3] = { entry.address, entry.flags, entry.other };
+		sum = bench::checksum((uint8_t*)fields, sizeof(fields), sum);
+	}
+	return sum;
+}
+
+void TrieBench::freeNames(std::vector<mach_o::trie::Entry>& entries)
+{
+	// parseTrie strdup()s each name
+	for (const mach_o::trie::Entry& entry : entries)
+		free((void*)entry.name);
+	entries.clear();
+}
+
+
+void TrieBench::run(const bench::Config& config)
+{
+	const uint32_t counts[] = { 10000, 500000 };
+	for (uint32_t count : counts) {
+		count *= config.scale;
+		const bool large = (count > 10000*config.scale);
+		makeExports(count);
+
+		std::vector<uint8_t> trieBytes;
+		std::vector<double> seconds = bench::measure(config,
+			[&]() { trieBytes.clear(); },
+			[&]() { mach_o::trie::makeTrie(_exports, trieBytes); });
+		bench::report(name(), large ? "makeTrie large" : "makeTrie small", count, seconds,
+					  bench::checksum(&trieBytes[0], trieBytes.size()));
+
+		std::vector<mach_o::trie::Entry> parsed;
+		seconds = bench::measure(config,
+			[&]() { freeNames(parsed); },
+			[&]() { mach_o::trie::parseTrie(&trieBytes[0], &trieBytes[trieBytes.size()], parsed); });
+
+		// parseTrie returns entries in trie layout order, so compare the sets of names
+		if ( parsed.size() != _exports.size() )
+			throw "parseTrie returned a different number of exports than makeTrie was given";
+		std::vector<std::string> parsedNames;
+		parsedNames.reserve(parsed.size());
+		for (const mach_o::trie::Entry& entry : parsed)
+			parsedNames.push_back(entry.name);
+		std::sort(parsedNames.begin(), parsedNames.end());
+		std::vector<std::string> exportNames = _names;
+		std::sort(exportNames.begin(), exportNames.end());
+		if ( parsedNames != exportNames )
+			throw "parseTrie did not return the names given to makeTrie";
+		bench::report(name(), large ? "parseTrie large" : "parseTrie small", count, seconds, checksumEntries(parsed));
+		freeNames(parsed);
+	}
+}
+
+TrieBench sTrieBench;
+
+} // anonymous namespace
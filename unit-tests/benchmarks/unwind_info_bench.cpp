@@ -0,0 +1,142 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 4 -*-
+ *
+ * Copyright (c) 2020 Apple Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <mach/machine.h>
+#include <mach-o/compact_unwind_encoding.h>
+
+#include <vector>
+
+#include "ld.hpp"
+#include "passes/compact_unwind.h"
+#include "bench.h"
+
+
+namespace {
+
+class SyntheticAtom : public ld::Atom {
+public:
+								SyntheticAtom(const ld::Section& sect, uint64_t sz)
+									: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+											ld::Atom::scopeTranslationUnit, ld::Atom::typeUnclassified,
+											ld::Atom::symbolTableNotIn, false, false, false, ld::Atom::Alignment(4)),
+									  _size(sz) { }
+
+	virtual const ld::File*		file() const					{ return NULL; }
+	virtual const char*			name() const					{ return "synthetic"; }
+	virtual uint64_t			size() const					{ return _size; }
+	virtual uint64_t			objectAddress() const			{ return 0; }
+	virtual void				copyRawContent(uint8_t buffer[]) const { }
+private:
+	uint64_t					_size;
+};
+
+ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+ld::Section sEHFrameSection("__TEXT", "__eh_frame", ld::Section::typeCFI);
+ld::Section sLSDASection("__TEXT", "__gcc_except_tab", ld::Section::typeLSDA);
+ld::Section sGOTSection("__DATA_CONST", "__got", ld::Section::typeNonLazyPointer);
+
+
+//
+// Mimics a large C++ image: most functions share a few frame layouts, a long
+// tail of frameless encodings, some functions needing dwarf, and some with LSDAs.
+//
+class UnwindInfoBench : public bench::Fixture {
+public:
+						UnwindInfoBench() : bench::Fixture("compact_unwind") { }
+	virtual void		run(const bench::Config& config);
+private:
+	void				makeEntries(uint32_t count, std::vector<ld::passes::compact_unwind::UnwindEntry>& entries);
+};
+
+
+void UnwindInfoBench::makeEntries(uint32_t count, std::vector<ld::passes::compact_unwind::UnwindEntry>& entries)
+{
+	srandom(1);
+	const ld::Atom* personalities[2] = { new SyntheticAtom(sGOTSection, 8), new SyntheticAtom(sGOTSection, 8) };
+	uint64_t address = 0;
+	entries.reserve(count);
+	for (uint32_t i=0; i < count; ++i) {
+		const uint64_t size = 16 + (random() % 64) * 4;
+		const ld::Atom* func = new SyntheticAtom(sTextSection, size);
+		const ld::Atom* fde = NULL;
+		const ld::Atom* lsda = NULL;
+		const ld::Atom* personality = NULL;
+		compact_unwind_encoding_t encoding;
+		const long kind = random() % 100;
+		if ( kind < 55 ) {
+			// common rbp frames with a few saved register sets
+			encoding = UNWIND_X86_64_MODE_RBP_FRAME | ((random() % 4) << 16) | (random() % 8);
+		}
+		else if ( kind < 90 ) {
+			// long tail of frameless functions
+			encoding = UNWIND_X86_64_MODE_STACK_IMMD | ((random() % 64) << 16) | ((random() % 8) << 10) | (random() % 32);
+		}
+		else if ( kind < 95 ) {
+			encoding = UNWIND_X86_64_MODE_DWARF;
+			fde = new SyntheticAtom(sEHFrameSection, 32);
+		}
+		else {
+			encoding = UNWIND_X86_64_MODE_RBP_FRAME;
+			lsda = new SyntheticAtom(sLSDASection, 16);
+			personality = personalities[random() % 2];
+		}
+		entries.push_back(ld::passes::compact_unwind::UnwindEntry(func, address, 0, fde, lsda, personality, encoding));
+		address += size;
+	}
+}
+
+
+void UnwindInfoBench::run(const bench::Config& config)
+{
+#if SUPPORT_ARCH_x86_64
+	const uint32_t counts[] = { 10000, 1000000 };
+	for (uint32_t count : counts) {
+		count *= config.scale;
+		std::vector<ld::passes::compact_unwind::UnwindEntry> entries;
+		makeEntries(count, entries);
+
+		ld::Atom* unwindInfo = NULL;
+		std::vector<double> seconds = bench::measure(config,
+			[&]() { delete unwindInfo; unwindInfo = NULL; },
+			[&]() { unwindInfo = ld::passes::compact_unwind::makeUnwindInfoAtom(CPU_TYPE_X86_64, entries, 0x1234); });
+
+		// checksum content and fixups, which together determine the final __unwind_info bytes
+		std::vector<uint8_t> content(unwindInfo->size());
+		unwindInfo->copyRawContent(&content[0]);
+		uint64_t sum = bench::checksum(&content[0], content.size());
+		for (ld::Fixup::iterator fit=unwindInfo->fixupsBegin(); fit != unwindInfo->fixupsEnd(); ++fit) {
+			uint32_t fields[3] = { fit->offsetInAtom, (uint32_t)fit->kind, (uint32_t)fit->clusterSize };
+			sum = bench::checksum((uint8_t*)fields, sizeof(fields), sum);
+		}
+		bench::report(name(), (count > 10000*config.scale) ? "UnwindInfoAtom large" : "UnwindInfoAtom small", count, seconds, sum);
+		delete unwindInfo;
+	}
+#endif
+}
+
+UnwindInfoBench sUnwindInfoBench;
+
+} // anonymous namespace
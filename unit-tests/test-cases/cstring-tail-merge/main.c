@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include <string.h>
+
+// "error", "or", and "ror" are all tails of "fatal error", "terror" is not
+const char* fatal = "fatal error";
+const char* error = "error";
+const char* or = "or";
+const char* terror = "terror";
+const char* ror = "ror";
+
+int main()
+{
+	printf("%s|%s|%s|%s\n", fatal, error, or, terror);
+	if ( strcmp(ror, "ror") != 0 )
+		return 1;
+	if ( (strcmp(fatal, "fatal error") != 0) || (strcmp(error, "error") != 0) || (strcmp(or, "or") != 0) )
+		return 1;
+	return 0;
+}
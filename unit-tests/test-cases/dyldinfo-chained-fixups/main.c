@@ -0,0 +1,12 @@
+extern int foo(void);
+
+int value = 32;
+
+// one pointer to bind and one to rebase
+int (*fooPointer)(void) = &foo;
+int* valuePointer = &value;
+
+int main()
+{
+	return (fooPointer() + *valuePointer == 42) ? 0 : 1;
+}
@@ -0,0 +1,4 @@
+int bar1(void)
+{
+	return 1;
+}
@@ -0,0 +1,4 @@
+int bar2(void)
+{
+	return 2;
+}
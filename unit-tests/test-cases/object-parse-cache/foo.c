@@ -0,0 +1,4 @@
+int foo(int x)
+{
+	return x*2 + 2;
+}
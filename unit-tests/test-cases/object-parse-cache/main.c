@@ -0,0 +1,6 @@
+extern int foo(int);
+
+int main()
+{
+	return (foo(20) == 42) ? 0 : 1;
+}